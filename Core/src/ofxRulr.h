@@ -14,6 +14,7 @@
 #include "ofxRulr/Utils/Gui.h"
 #include "ofxRulr/Utils/Initialiser.h"
 #include "ofxRulr/Utils/PolyFit.h"
+#include "ofxRulr/Utils/Profiler.h"
 #include "ofxRulr/Utils/ScopedProcess.h"
 #include "ofxRulr/Utils/Serializable.h"
 #include "ofxRulr/Utils/Set.h"
@@ -293,10 +293,16 @@ namespace ofxRulr {
 				json["NodeTypeName"] = node->getTypeName();
 				json["Name"] = node->getName();
 
+				//only serialize the node again if it's changed since the last time
 				{
-					auto & jsonContent = json["Content"];
-					jsonContent = nlohmann::json::object();
-					node->serialize(jsonContent);
+					auto revision = node->getRevision();
+					if (!this->contentCached || revision != this->contentRevision) {
+						this->content = nlohmann::json::object();
+						node->serialize(this->content);
+						this->contentRevision = revision;
+						this->contentCached = true;
+					}
+					json["Content"] = this->content;
 				}
 			}
 		}
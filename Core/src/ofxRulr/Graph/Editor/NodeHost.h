@@ -38,6 +38,11 @@ namespace ofxRulr {
 				ofxCvGui::PanelPtr nodeView;
 				ofxCvGui::ElementGroupPtr elements;
 				ofxCvGui::ElementGroupPtr inputPins;
+
+				//the node's content as last serialized, reused until the node is marked dirty
+				nlohmann::json content;
+				uint64_t contentRevision = 0;
+				bool contentCached = false;
 			};
 		}
 	}
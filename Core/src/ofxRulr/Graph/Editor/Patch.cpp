@@ -285,10 +285,12 @@ namespace ofxRulr {
 				Utils::ScopedProcess scopedProcess("Loading nodes", false, nodesJson.size());
 
 				//Deserialise nodes
+				vector<pair<string, float>> nodeLoadTimes;
 				for (const auto & nodeJson : nodesJson) {
 					std::string name;
 					nodeJson["Name"].get_to(name);
 					Utils::ScopedProcess scopedProcessNode(name, false);
+					auto loadStart = chrono::high_resolution_clock::now();
 
 					NodeHost::Index ID;
 					nodeJson["ID"].get_to(ID);
@@ -312,6 +314,24 @@ namespace ofxRulr {
 						ofLogError() << e.what() << endl;
 						cout << nodeJson;
 					})
+
+					chrono::duration<float, ratio<1, 1000>> loadDuration = chrono::high_resolution_clock::now() - loadStart;
+					nodeLoadTimes.emplace_back(name, loadDuration.count());
+				}
+
+				//Report where the time went (slowest first)
+				if (!nodeLoadTimes.empty()) {
+					sort(nodeLoadTimes.begin(), nodeLoadTimes.end(), [](const pair<string, float> & a, const pair<string, float> & b) {
+						return a.second > b.second;
+					});
+					float totalTime = 0.0f;
+					for (const auto & nodeLoadTime : nodeLoadTimes) {
+						totalTime += nodeLoadTime.second;
+					}
+					ofLogNotice("ofxRulr") << "Loaded " << nodeLoadTimes.size() << " nodes in " << totalTime << "ms";
+					for (const auto & nodeLoadTime : nodeLoadTimes) {
+						ofLogNotice("ofxRulr") << "\t" << nodeLoadTime.second << "ms\t" << nodeLoadTime.first;
+					}
 				}
 
 				//Deserialise links into the nodes
@@ -364,6 +384,12 @@ namespace ofxRulr {
 				scopedProcess.end();
 			}
 
+			//----------
+			vector<string> Patch::getParallelParsePath() const {
+				// Each node's content is independent, and is most of the file
+				return { "Nodes", "*", "Content" };
+			}
+
 			//----------
 			ofxCvGui::PanelPtr Patch::getPanel() {
 				return this->view;
@@ -376,10 +402,22 @@ namespace ofxRulr {
 				for (auto nodeHost : this->nodeHosts) {
 					if (ofxCvGui::isBeingInspected(nodeHost.second->getNodeInstance())) {
 						this->selection = nodeHost.second;
+
+						//the user may be changing anything while it's being inspected
+						nodeHost.second->getNodeInstance()->markDirty();
 					}
-					nodeHost.second->getNodeInstance()->update();
 				}
 
+				//update nodes in order of their connections
+				if (!this->updateScheduler.isBuilt()) {
+					vector<shared_ptr<Nodes::Base>> nodes;
+					for (auto nodeHost : this->nodeHosts) {
+						nodes.push_back(nodeHost.second->getNodeInstance());
+					}
+					this->updateScheduler.build(nodes);
+				}
+				this->updateScheduler.update(this->parameters.update.parallel.get());
+
 				//update parameters
 				{
 					if (this->cachedParameters.draw.enabled.get() != this->parameters.draw.enabled.get()) {
@@ -412,6 +450,7 @@ namespace ofxRulr {
 			//----------
 			void Patch::rebuildLinkHosts() {
 				this->linkHosts.clear();
+				this->updateScheduler.clear(); // the update order depends on the same connections
 				for (auto targetNodeHost : this->nodeHosts) {
 					auto targetNode = targetNodeHost.second->getNodeInstance();
 					for (auto targetPin : targetNode->getInputPins()) {
@@ -479,7 +518,15 @@ namespace ofxRulr {
 				nodeHost->getNodeInstance()->onAnyInputConnectionChanged += [this]() {
 					this->rebuildLinkHosts();
 				};
+				nodeHost->getNodeInstance()->onMarkDirty += [this]() {
+					this->markDirty();
+				};
+				nodeHost->onBoundsChange += [this](ofxCvGui::BoundsChangeArguments &) {
+					this->markDirty();
+				};
+				this->updateScheduler.clear();
 				this->view->markDirty();
+				this->markDirty();
 			}
 			
 			//----------
@@ -493,6 +540,7 @@ namespace ofxRulr {
 				for (auto nodeHost : this->nodeHosts) {
 					if (nodeHost.second == selection) {
 						this->nodeHosts.erase(nodeHost.first);
+						this->markDirty();
 
 						//this shouldn't be entirely necessary since the node should become outdated and disappear
 						//but this is much safer
@@ -578,6 +626,13 @@ namespace ofxRulr {
 			//----------
 			void Patch::populateInspector(ofxCvGui::InspectArguments & inspectArguments) {
 				auto inspector = inspectArguments.inspector;
+
+				inspector->addLiveValue<size_t>("Update levels", [this]() {
+					return this->updateScheduler.getLevelCount();
+				});
+				inspector->addLiveValue<size_t>("Thread-safe nodes", [this]() {
+					return this->updateScheduler.getThreadSafeNodeCount();
+				});
 				
 				inspector->addButton("Clear patch", [this]() {
 					this->nodeHosts.clear();
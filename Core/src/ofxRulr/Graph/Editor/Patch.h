@@ -6,6 +6,7 @@
 
 #include "ofxRulr/Nodes/Base.h"
 #include "ofxRulr/Graph/FactoryRegister.h"
+#include "ofxRulr/Graph/UpdateScheduler.h"
 #include "ofxCvGui/Panels/ElementCanvas.h"
 
 namespace ofxRulr {
@@ -76,12 +77,16 @@ namespace ofxRulr {
 
 				NodeHost::Index getNextFreeNodeHostIndex() const;
 				LinkHost::Index getNextFreeLinkHostIndex() const;
+
+				vector<string> getParallelParsePath() const override;
+
 				void callbackBeginMakeConnection(shared_ptr<NodeHost> targetNodeHost, shared_ptr<AbstractPin> targetPin);
 				void callbackReleaseMakeConnection(ofxCvGui::MouseArguments &);
 
 				NodeHostSet nodeHosts;
 				LinkHostSet linkHosts;
 				shared_ptr<View> view;
+				UpdateScheduler updateScheduler;
 
 				shared_ptr<TemporaryLinkHost> newLink;
 				weak_ptr<NodeHost> selection;
@@ -94,8 +99,13 @@ namespace ofxRulr {
 						ofParameter<bool> grid{ "Grid", true };
 						PARAM_DECLARE("Draw", enabled, nodes, links, grid);
 					} draw;
+
+					struct : ofParameterGroup {
+						ofParameter<bool> parallel{ "Parallel", true };
+						PARAM_DECLARE("Update", parallel);
+					} update;
 					
-					PARAM_DECLARE("Patch", draw);
+					PARAM_DECLARE("Patch", draw, update);
 				} parameters;
 
 				Parameters cachedParameters;
@@ -0,0 +1,164 @@
+#include "pch_RulrCore.h"
+#include "UpdateScheduler.h"
+
+namespace ofxRulr {
+	namespace Graph {
+		//----------
+		UpdateScheduler::UpdateScheduler() {
+			auto threadCount = std::thread::hardware_concurrency();
+			threadCount = threadCount > 1 ? threadCount - 1 : 1; // leave a core for the main thread
+			this->threadPool = make_unique<Utils::ThreadPool>(threadCount, 1024);
+		}
+
+		//----------
+		void UpdateScheduler::build(const vector<shared_ptr<Nodes::Base>> & nodes) {
+			this->clear();
+
+			// Count the inputs for each node that come from inside this set
+			map<Nodes::Base*, shared_ptr<Nodes::Base>> nodesByPointer;
+			for (const auto & node : nodes) {
+				nodesByPointer.emplace(node.get(), node);
+			}
+
+			map<Nodes::Base*, size_t> unresolvedInputCount;
+			map<Nodes::Base*, vector<Nodes::Base*>> outputs;
+			for (const auto & node : nodes) {
+				auto & inputCount = unresolvedInputCount[node.get()];
+				set<Nodes::Base*> sources; // a node may connect to several of our pins
+				for (const auto & inputPin : node->getInputPins()) {
+					auto source = inputPin->getConnectionUntyped();
+					if (source && source != node && nodesByPointer.find(source.get()) != nodesByPointer.end()) {
+						sources.insert(source.get());
+					}
+				}
+				for (auto source : sources) {
+					outputs[source].push_back(node.get());
+					inputCount++;
+				}
+			}
+
+			// Peel off levels of nodes whose inputs have all been resolved (Kahn's algorithm)
+			vector<Nodes::Base*> currentLevel;
+			for (const auto & node : nodes) {
+				if (unresolvedInputCount[node.get()] == 0) {
+					currentLevel.push_back(node.get());
+				}
+			}
+
+			set<Nodes::Base*> scheduled;
+			while (!currentLevel.empty()) {
+				Level level;
+				vector<Nodes::Base*> nextLevel;
+				for (auto node : currentLevel) {
+					scheduled.insert(node);
+
+					const auto & nodePtr = nodesByPointer[node];
+					if (nodePtr->getUpdateIsThreadSafe()) {
+						level.threadSafeNodes.push_back(nodePtr);
+					}
+					else {
+						level.mainThreadNodes.push_back(nodePtr);
+					}
+
+					for (auto output : outputs[node]) {
+						if (--unresolvedInputCount[output] == 0) {
+							nextLevel.push_back(output);
+						}
+					}
+				}
+				this->levels.push_back(move(level));
+				currentLevel = move(nextLevel);
+			}
+
+			// Anything left over is part of a loop. These are updated serially afterwards
+			for (const auto & node : nodes) {
+				if (scheduled.find(node.get()) == scheduled.end()) {
+					this->loopedNodes.push_back(node);
+				}
+			}
+
+			this->built = true;
+		}
+
+		//----------
+		void UpdateScheduler::clear() {
+			this->levels.clear();
+			this->loopedNodes.clear();
+			this->built = false;
+		}
+
+		//----------
+		bool UpdateScheduler::isBuilt() const {
+			return this->built;
+		}
+
+		//----------
+		void UpdateScheduler::update(bool allowParallel) {
+			for (const auto & level : this->levels) {
+				if (allowParallel && !level.threadSafeNodes.empty()) {
+					// Dispatch the thread-safe nodes first so they run alongside the main thread nodes
+					vector<future<void>> futures;
+					for (const auto & node : level.threadSafeNodes) {
+						// Its inputs are all in earlier levels (so already updated), and they may not be thread safe
+						futures.push_back(this->threadPool->performAsyncWithExceptionHandling<void>([node]() {
+							node->updateWithoutInputs();
+						}, Utils::ThreadPool::Priority::High));
+					}
+
+					exception_ptr mainThreadException;
+					try {
+						for (const auto & node : level.mainThreadNodes) {
+							node->update();
+						}
+					}
+					catch (...) {
+						mainThreadException = current_exception();
+					}
+
+					// Wait for the whole level before moving on to nodes which depend on it
+					for (auto & future : futures) {
+						try {
+							future.get();
+						}
+						RULR_CATCH_ALL_TO_ERROR;
+					}
+
+					if (mainThreadException) {
+						rethrow_exception(mainThreadException);
+					}
+				}
+				else {
+					for (const auto & node : level.threadSafeNodes) {
+						node->update();
+					}
+					for (const auto & node : level.mainThreadNodes) {
+						node->update();
+					}
+				}
+			}
+
+			for (const auto & node : this->loopedNodes) {
+				node->update();
+			}
+		}
+
+		//----------
+		size_t UpdateScheduler::getLevelCount() const {
+			return this->levels.size();
+		}
+
+		//----------
+		size_t UpdateScheduler::getThreadSafeNodeCount() const {
+			size_t count = 0;
+			for (const auto & level : this->levels) {
+				count += level.threadSafeNodes.size();
+			}
+			return count;
+		}
+
+		//----------
+		size_t UpdateScheduler::getLoopedNodeCount() const {
+			return this->loopedNodes.size();
+		}
+	}
+}
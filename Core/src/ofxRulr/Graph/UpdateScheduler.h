@@ -0,0 +1,37 @@
+#pragma once
+
+#include "../Nodes/Base.h"
+#include "../Utils/ThreadPool.h"
+
+namespace ofxRulr {
+	namespace Graph {
+		/// Updates a set of nodes in the order of their input connections.
+		/// Nodes are grouped into levels where each node's inputs are all in earlier levels.
+		/// Within a level, nodes which declare a thread-safe update are performed concurrently
+		/// on a thread pool, and all other nodes are performed on the calling (main) thread.
+		class OFXRULR_API_ENTRY UpdateScheduler {
+		public:
+			UpdateScheduler();
+
+			void build(const vector<shared_ptr<Nodes::Base>> &);
+			void clear();
+			bool isBuilt() const;
+
+			void update(bool allowParallel);
+
+			size_t getLevelCount() const;
+			size_t getThreadSafeNodeCount() const;
+			size_t getLoopedNodeCount() const;
+		protected:
+			struct Level {
+				vector<shared_ptr<Nodes::Base>> mainThreadNodes;
+				vector<shared_ptr<Nodes::Base>> threadSafeNodes;
+			};
+
+			vector<Level> levels;
+			vector<shared_ptr<Nodes::Base>> loopedNodes; // nodes inside (or downstream of) loopback connections
+			unique_ptr<Utils::ThreadPool> threadPool;
+			bool built = false;
+		};
+	}
+}
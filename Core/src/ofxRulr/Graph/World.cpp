@@ -4,6 +4,8 @@
 
 #include "ofxRulr/Exception.h"
 #include "ofxRulr/Utils/Initialiser.h"
+#include "ofxRulr/Utils/Profiler.h"
+#include "ofxRulr/Utils/ScopedProcess.h"
 #include "ofxRulr/Utils/Utils.h"
 #include "ofxRulr/Version.h"
 
@@ -27,7 +29,10 @@ namespace ofxRulr {
 
 		//-----------
 		World::~World() {
-
+			try {
+				this->waitForSaves();
+			}
+			RULR_CATCH_ALL_TO_ERROR;
 		}
 
 		//-----------
@@ -134,6 +139,21 @@ namespace ofxRulr {
 				});
 				inspector->addMemoryUsage();
 
+				inspector->addButton("Profile frames", [this]() {
+					try {
+						auto result = ofSystemTextBoxDialog("Number of frames to profile", "120");
+						if (!result.empty()) {
+							auto frameCount = ofToInt(result);
+							auto filename = "Profile-" + ofGetTimestampString("%Y-%m-%d--%H-%M-%S") + ".json";
+							Utils::Profiler::X().beginCapture((size_t) max(frameCount, 0), filename);
+						}
+					}
+					RULR_CATCH_ALL_TO_ALERT;
+				});
+				inspector->addIndicatorBool("Profiling", []() {
+					return Utils::Profiler::X().isCapturing();
+				});
+
 				auto saveAllButton = inspector->add(new Widgets::Button("Save all", [this]() {
 					try {
 						this->saveAll();
@@ -147,6 +167,23 @@ namespace ofxRulr {
 						ofxAssets::font(ofxCvGui::getDefaultTypeface(), 8).drawString(Utils::formatDuration(duration, true, true, false) + "[since last save]", 6, 27);
 					}
 				};
+				inspector->addIndicatorBool("Saving", [this]() {
+					return this->getPendingSaveCount() > 0;
+				});
+				{
+					auto widget = inspector->addMultipleChoice("Save format", { "JSON", "CBOR", "MessagePack" });
+					widget->setSelection((int) Utils::Serializable::getDefaultFormat() - 1);
+					widget->onValueChange += [this](int value) {
+						Utils::Serializable::setDefaultFormat((Utils::Serializable::Format) (value + 1));
+						this->saveSettings();
+					};
+				}
+				inspector->addButton("Benchmark save formats", [this]() {
+					try {
+						this->benchmarkSaveFormats();
+					}
+					RULR_CATCH_ALL_TO_ALERT;
+				});
 
 				/*
 				HACK
@@ -206,40 +243,310 @@ namespace ofxRulr {
 		}
 
 		//-----------
-		void World::saveAll() const {
+		void World::update() {
+			{
+				Utils::Profiler::Scope profile(this->frameProfileStatistics, this->frameProfileName, Utils::Profiler::Frame);
+				Utils::Set<Nodes::Base>::update();
+			}
+
+			//the user may be changing anything in the node that's being inspected
+			for (auto node : *this) {
+				if (node->isBeingInspected()) {
+					node->markDirty();
+				}
+			}
+
+			Utils::Profiler::X().update();
+		}
+
+		//-----------
+		void World::saveAll() {
+			if (!this->saveThread) {
+				// A single worker keeps the writes in order
+				this->saveThread = make_unique<Utils::ThreadPool>(1, 1024);
+			}
+
+			// Clear out any finished saves, reporting their errors
+			for (auto it = this->pendingSaves.begin(); it != this->pendingSaves.end(); ) {
+				if (it->wait_for(chrono::seconds(0)) == future_status::ready) {
+					try {
+						it->get();
+					}
+					RULR_CATCH_ALL_TO_ERROR;
+					it = this->pendingSaves.erase(it);
+				}
+				else {
+					it++;
+				}
+			}
+
+			this->saveSettings();
+
+			auto format = Utils::Serializable::getDefaultFormat();
 			for(auto node : * this) {
-				auto filename = node->getDefaultFilename() + ".json";
+				auto filename = ofToDataPath(node->getDefaultFilename() + Utils::Serializable::getFileExtension(format), true);
+
+				// Skip nodes which haven't been marked dirty since we last saved (or loaded) this file
+				auto revision = node->getRevision();
+				auto findSavedRevision = this->savedRevisions.find(filename);
+				if (findSavedRevision != this->savedRevisions.end()
+					&& findSavedRevision->second == revision
+					&& ofFile::doesFileExist(filename, false)) {
+					continue;
+				}
 
-				// Check if file already exists (if overwriting)
-				if (ofFile::doesFileExist(filename)) {
+				// Nodes must be serialized on the main thread
+				auto json = make_shared<nlohmann::json>();
+				node->serialize(*json);
+				if (json->empty()) {
+					throw(ofxRulr::Exception("Serialization failed for " + node->getName()));
+				}
+				this->savedRevisions[filename] = revision;
 
-					// Find an available filename to copy the backup into
-					for (size_t backupIndex = 0; true; backupIndex++) {
-						auto backupFilename = node->getDefaultFilename() + "-" + ofToString(backupIndex) + ".json";
-						if (!ofFile::doesFileExist(backupFilename)) {
-							ofFile::copyFromTo(filename, backupFilename);
-							break;
-						}
+				this->pendingSaves.push_back(this->saveThread->performAsyncWithExceptionHandling<void>([this, filename, json, format]() {
+					this->writeSave(filename, *json, format);
+				}));
+			}
+			this->lastSaveOrLoad = chrono::system_clock::now();
+		}
+
+		//-----------
+		void World::waitForSaves() const {
+			auto pendingSaves = move(this->pendingSaves);
+			this->pendingSaves.clear();
+			for (auto & pendingSave : pendingSaves) {
+				try {
+					pendingSave.get();
+				}
+				RULR_CATCH_ALL_TO_ERROR;
+			}
+		}
+
+		//-----------
+		size_t World::getPendingSaveCount() const {
+			return this->saveThread
+				? this->saveThread->getQueueSize() + this->saveThread->getStatistics().activeWorkers
+				: 0;
+		}
+
+		//-----------
+		void World::benchmarkSaveFormats() const {
+			typedef chrono::high_resolution_clock Clock;
+			typedef chrono::duration<float, ratio<1, 1000>> Milliseconds;
+			typedef Utils::Serializable::Format Format;
+
+			Utils::ScopedProcess scopedProcess("Benchmark save formats", false, this->size());
+
+			for (auto node : *this) {
+				Utils::ScopedProcess scopedProcessNode(node->getName(), false);
+
+				auto serializeStart = Clock::now();
+				nlohmann::json json;
+				node->serialize(json);
+				auto serializeTime = Milliseconds(Clock::now() - serializeStart).count();
+				ofLogNotice("ofxRulr") << "Benchmark [" << node->getName() << "] : serialize " << serializeTime << "ms";
+
+				for (auto format : { Format::JSON, Format::CBOR, Format::MessagePack }) {
+					auto filename = ofToDataPath(node->getDefaultFilename() + "-benchmark" + Utils::Serializable::getFileExtension(format), true);
+
+					auto saveStart = Clock::now();
+					auto contents = Utils::Serializable::encode(json, format);
+					Utils::Serializable::writeFileAtomically(filename, contents);
+					auto saveTime = Milliseconds(Clock::now() - saveStart).count();
+
+					auto loadStart = Clock::now();
+					auto loadedJson = Utils::Serializable::readJsonFile(filename);
+					auto loadTime = Milliseconds(Clock::now() - loadStart).count();
+
+					filesystem::remove(filename);
+
+					if (loadedJson != json) {
+						ofLogWarning("ofxRulr") << "Benchmark [" << node->getName() << "] : " << Utils::Serializable::getFormatName(format) << " didn't round-trip";
+					}
+
+					ofLogNotice("ofxRulr") << "\t" << Utils::Serializable::getFormatName(format)
+						<< "\tsave " << saveTime << "ms"
+						<< "\tload " << loadTime << "ms"
+						<< "\tsize " << contents.size() << " bytes";
+				}
+			}
+
+			scopedProcess.end();
+		}
+
+		//-----------
+		void World::saveSettings() const {
+			nlohmann::json json;
+			json["DefaultSaveFormat"] = Utils::Serializable::getFormatName(Utils::Serializable::getDefaultFormat());
+			json["BackupsPerFile"] = this->backupsPerFile.get();
+
+			try {
+				Utils::Serializable::writeFileAtomically(ofToDataPath(this->settingsFilename, true), json.dump(4));
+			}
+			RULR_CATCH_ALL_TO_ERROR;
+		}
+
+		//-----------
+		void World::loadSettings() {
+			typedef Utils::Serializable::Format Format;
+
+			auto filename = ofToDataPath(this->settingsFilename, true);
+			if (!ofFile::doesFileExist(filename, false)) {
+				return;
+			}
+
+			auto formatFromName = [](const nlohmann::json & json) {
+				auto name = json.get<string>();
+				for (auto format : { Format::JSON, Format::CBOR, Format::MessagePack }) {
+					if (name == Utils::Serializable::getFormatName(format)) {
+						return format;
 					}
 				}
+				return Format::Default;
+			};
+
+			try {
+				auto json = Utils::Serializable::readJsonFile(filename);
+				if (json.contains("DefaultSaveFormat")) {
+					Utils::Serializable::setDefaultFormat(formatFromName(json["DefaultSaveFormat"]));
+				}
+				if (json.contains("BackupsPerFile")) {
+					this->backupsPerFile.set(json["BackupsPerFile"].get<int>());
+				}
+			}
+			RULR_CATCH_ALL_TO_ERROR;
+		}
+
+		//-----------
+		void World::writeSave(const string & filename, const nlohmann::json & json, Utils::Serializable::Format format) {
+			typedef Utils::Serializable::Format Format;
+
+			auto contents = Utils::Serializable::encode(json, format);
+			auto contentHash = std::hash<string>()(contents);
+
+			// Check against what's already on disk. Our record is only trusted if the file hasn't been
+			// deleted or touched since we wrote it, otherwise we hash what's there now
+			auto fileExists = ofFile::doesFileExist(filename, false);
+			if (fileExists) {
+				auto writeTime = filesystem::last_write_time(filename);
+				auto findSavedFile = this->savedFiles.find(filename);
+				if (findSavedFile == this->savedFiles.end() || findSavedFile->second.writeTime != writeTime) {
+					ifstream existingFile(filename, ios::binary);
+					auto existingContents = string(istreambuf_iterator<char>(existingFile), istreambuf_iterator<char>());
+					findSavedFile = this->savedFiles.insert_or_assign(filename, SavedFile{ std::hash<string>()(existingContents), writeTime }).first;
+				}
+				if (findSavedFile->second.contentHash == contentHash) {
+					return;
+				}
+
+				this->rotateBackups(filename);
+			}
+
+			Utils::Serializable::writeFileAtomically(filename, contents);
+			this->savedFiles[filename] = SavedFile{ contentHash, filesystem::last_write_time(filename) };
+
+			// Move any copy of this file in another format into the backups, so it can't be loaded in place of this one
+			for (auto otherFormat : { Format::JSON, Format::CBOR, Format::MessagePack }) {
+				if (otherFormat == format) {
+					continue;
+				}
+				auto otherFilename = filesystem::path(filename).replace_extension(Utils::Serializable::getFileExtension(otherFormat)).string();
+				if (ofFile::doesFileExist(otherFilename, false)) {
+					this->rotateBackups(otherFilename);
+					filesystem::remove(otherFilename);
+					this->savedFiles.erase(otherFilename);
+				}
+			}
+		}
+
+		//-----------
+		void World::rotateBackups(const string & filename) {
+			// Backups of "<name>.json" are named "Backups/<name>-<index>.json", with the newest having the highest index.
+			// Only the Backups folder is searched, so files of the user's with similar names are never touched
+			auto path = filesystem::path(filename);
+			auto backupFolder = path.parent_path() / "Backups";
+			auto prefix = path.stem().string() + "-";
+			auto extension = path.extension().string();
+
+			filesystem::create_directories(backupFolder);
+
+			vector<size_t> backupIndices;
+			for (const auto & directoryEntry : filesystem::directory_iterator(backupFolder)) {
+				auto backupFilename = directoryEntry.path().filename().string();
+				if (backupFilename.size() <= prefix.size() + extension.size()
+					|| backupFilename.compare(0, prefix.size(), prefix) != 0
+					|| backupFilename.compare(backupFilename.size() - extension.size(), extension.size(), extension) != 0) {
+					continue;
+				}
+				auto indexString = backupFilename.substr(prefix.size(), backupFilename.size() - prefix.size() - extension.size());
+				if (!all_of(indexString.begin(), indexString.end(), ::isdigit)) {
+					continue;
+				}
+				backupIndices.push_back((size_t) stoull(indexString));
+			}
+			sort(backupIndices.begin(), backupIndices.end());
+
+			auto backupPath = [&](size_t index) {
+				return backupFolder / (prefix + ofToString(index) + extension);
+			};
 
-				// Save the file
-				node->save(filename);
+			auto backupsPerFile = (size_t) max(this->backupsPerFile.get(), 0);
+			if (backupsPerFile > 0) {
+				auto newIndex = backupIndices.empty() ? 0 : backupIndices.back() + 1;
+				filesystem::copy_file(path, backupPath(newIndex), filesystem::copy_options::overwrite_existing);
+				backupIndices.push_back(newIndex);
+			}
+
+			// Delete the oldest backups beyond the limit
+			while (backupIndices.size() > backupsPerFile) {
+				filesystem::remove(backupPath(backupIndices.front()));
+				backupIndices.erase(backupIndices.begin());
 			}
-			const_cast<World*>(this)->lastSaveOrLoad = chrono::system_clock::now();
 		}
 
 		//-----------
 		void World::loadAll(bool printDebug) {
+			this->loadSettings();
+
 			for(auto node : * this) {
 				if (printDebug) {
 					ofLogNotice("ofxRulr") << "Loading node [" << node->getName() << "]";
 				}
-				node->load(node->getDefaultFilename() + ".json");
+				auto filename = this->findSaveFile(*node);
+				if (filename.empty()) {
+					continue;
+				}
+
+				auto loadStart = chrono::high_resolution_clock::now();
+				node->load(filename);
+				this->savedRevisions[filename] = node->getRevision();
+				chrono::duration<float, ratio<1, 1000>> loadDuration = chrono::high_resolution_clock::now() - loadStart;
+				ofLogNotice("ofxRulr") << "Loaded [" << node->getName() << "] in " << loadDuration.count() << "ms (including parsing)";
 			}
 			this->lastSaveOrLoad = chrono::system_clock::now();
 		}
 
+		//-----------
+		string World::findSaveFile(const Nodes::Base & node) const {
+			typedef Utils::Serializable::Format Format;
+
+			// Normally only one exists, but if there are several then take the newest
+			string newestFilename;
+			filesystem::file_time_type newestWriteTime;
+			for (auto format : { Format::JSON, Format::CBOR, Format::MessagePack }) {
+				auto filename = ofToDataPath(node.getDefaultFilename() + Utils::Serializable::getFileExtension(format), true);
+				if (!ofFile::doesFileExist(filename, false)) {
+					continue;
+				}
+				auto writeTime = filesystem::last_write_time(filename);
+				if (newestFilename.empty() || writeTime > newestWriteTime) {
+					newestFilename = filename;
+					newestWriteTime = writeTime;
+				}
+			}
+			return newestFilename;
+		}
+
 		//-----------
 		ofxCvGui::Controller & World::getGuiController() {
 			if (World::gui) {
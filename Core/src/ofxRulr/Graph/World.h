@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../Utils/Set.h"
+#include "../Utils/ThreadPool.h"
 #include "../Nodes/Base.h"
 #include "Editor/Patch.h"
 
@@ -17,8 +18,27 @@ namespace ofxRulr {
 			World();
 			virtual ~World();
 			void init(ofxCvGui::Controller &, bool enableWorldStageView = true);
+			void update();
 			void loadAll(bool printDebug = false);
-			void saveAll() const;
+
+			/// Serializes the nodes which have been marked dirty since they were last saved on this thread, then formats
+			/// and writes the files on a background thread. Files are named after the format (e.g. Camera.cbor).
+			/// Files whose contents haven't changed are left untouched (and aren't backed up).
+			void saveAll();
+
+			/// Block until all files queued by saveAll have been written
+			void waitForSaves() const;
+			size_t getPendingSaveCount() const;
+
+			/// Time saving and loading every node in each of the Serializable formats, and log the results
+			void benchmarkSaveFormats() const;
+
+			/// App settings (save format, backups per file), kept as JSON in
+			/// settingsFilename beside the node files. Saved with saveAll, loaded with loadAll
+			void saveSettings() const;
+			void loadSettings();
+			const string settingsFilename = "Settings.json";
+
 			static ofxCvGui::Controller & getGuiController();
 			ofxCvGui::PanelGroupPtr getGuiGrid() const;
 			shared_ptr<Editor::Patch> getPatch() const;
@@ -28,12 +48,32 @@ namespace ofxRulr {
 			void drawWorldAdvanced(DrawWorldAdvancedArgs&) const;
 
 			ofParameter<bool> lockSelection{ "Lock selection", false };
+			ofParameter<int> backupsPerFile{ "Backups per file", 10 }; ///< Kept in a 'Backups' folder beside the files. Oldest backups beyond this are deleted
 		protected:
+			void writeSave(const string & filename, const nlohmann::json &, Utils::Serializable::Format);
+			void rotateBackups(const string & filename);
+			/// The node's saved file in whichever format it was saved, or an empty string if there isn't one
+			string findSaveFile(const Nodes::Base &) const;
 			static ofxCvGui::Controller * gui; ///< Why is this static? Needs comment.  I presume it's so we can grid multiple worlds?
 			ofxCvGui::PanelGroupPtr guiGrid;
 			chrono::system_clock::time_point lastSaveOrLoad = chrono::system_clock::now();
 
 			shared_ptr<WorldStage> worldStage;
+
+			Utils::Profiler::Statistics frameProfileStatistics;
+			const string frameProfileName = "World::update";
+
+			unique_ptr<Utils::ThreadPool> saveThread;
+			mutable vector<future<void>> pendingSaves;
+			// What we last knew to be on disk for each file (only accessed on the save thread)
+			struct SavedFile {
+				size_t contentHash;
+				filesystem::file_time_type writeTime;
+			};
+			map<string, SavedFile> savedFiles;
+
+			// The node's revision when each file was last saved or loaded (only accessed on the main thread)
+			map<string, uint64_t> savedRevisions;
 		};
 	}
 }
\ No newline at end of file
@@ -15,6 +15,7 @@ namespace ofxRulr {
 			this->initialized = false;
 			this->lastFrameUpdate = 0;
 			this->updateAllInputsFirst = true;
+			this->updateIsThreadSafe = false;
 			this->whenDrawOnWorldStage = WhenActive::Always;
 		}
 
@@ -45,6 +46,24 @@ namespace ofxRulr {
 			this->onPopulateInspector.addListener([this](ofxCvGui::InspectArguments & args) {
 				this->populateInspector(args);
 			}, this, 99999); // populate the inspector with this at the top. We call notify in reverse for inheritance
+
+			//bracket all the other inspector listeners to time them (whichever end is notified first starts the timer)
+			{
+				auto bracket = [this](ofxCvGui::InspectArguments &) {
+					auto now = Utils::Profiler::Clock::now();
+					if (this->populateInspectorStart == Utils::Profiler::Clock::time_point()) {
+						this->populateInspectorStart = now;
+					}
+					else {
+						chrono::duration<float, ratio<1, 1000>> duration = now - this->populateInspectorStart;
+						this->profileStatistics[Utils::Profiler::PopulateInspector].add(duration.count());
+						Utils::Profiler::X().record(this->name, Utils::Profiler::PopulateInspector, this->populateInspectorStart, now);
+						this->populateInspectorStart = Utils::Profiler::Clock::time_point();
+					}
+				};
+				this->onPopulateInspector.addListener(bracket, this, 100000);
+				this->onPopulateInspector.addListener(bracket, this, -100000);
+			}
 			this->onSerialize.addListener([this](nlohmann::json & json) {
 				json["whenDrawOnWorldStage"] = (int) this->whenDrawOnWorldStage;
 			}, this);
@@ -53,6 +72,7 @@ namespace ofxRulr {
 				if (Utils::deserialize(json, "whenDrawOnWorldStage", whenDrawOnWorldStageInt)) {
 					this->whenDrawOnWorldStage = (WhenActive::Options) whenDrawOnWorldStageInt;
 				}
+				this->markDirty();
 			}, this);
 			
 			//notify the subclasses to init
@@ -68,10 +88,23 @@ namespace ofxRulr {
 
 		//----------
 		void Base::update() {
+			this->update(this->updateAllInputsFirst);
+		}
+
+		//----------
+		void Base::updateWithoutInputs() {
+			this->update(false);
+		}
+
+		//----------
+		void Base::update(bool updateInputs) {
+			// Nodes may be updated from several threads at once (by the UpdateScheduler and via updateAllInputsFirst)
+			lock_guard<recursive_mutex> lock(this->updateMutex);
+
 			auto currentFrameIndex = ofGetFrameNum() + 1; // otherwise confusions at 0th frame
 			if (currentFrameIndex > this->lastFrameUpdate) {
 				this->lastFrameUpdate = currentFrameIndex;
-				if (this->updateAllInputsFirst) {
+				if (updateInputs) {
 					for (auto inputPin : this->inputPins) {
 						auto inputNode = inputPin->getConnectionUntyped();
 						if (inputNode) {
@@ -79,6 +112,7 @@ namespace ofxRulr {
 						}
 					}
 				}
+				Utils::Profiler::Scope profile(this->profileStatistics[Utils::Profiler::Update], this->name, Utils::Profiler::Update);
 				this->onUpdate.notifyListeners();
 			}
 
@@ -212,12 +246,24 @@ namespace ofxRulr {
 				}));
 			}
 
+			//profile
+			for (auto stage : { Utils::Profiler::Update, Utils::Profiler::DrawWorldStage, Utils::Profiler::DrawWorldAdvanced, Utils::Profiler::PopulateInspector }) {
+				inspector->addLiveValue<string>(string(Utils::Profiler::getStageName(stage)) + " [ms]", [this, stage]() {
+					const auto & statistics = this->profileStatistics[stage];
+					if (statistics.count == 0) {
+						return string("-");
+					}
+					return ofToString(statistics.mean.load(), 2) + " (max " + ofToString(statistics.max.load(), 2) + ")";
+				});
+			}
+
 			//node parameters
 			inspector->add(new Widgets::Spacer());
 		}
 
 		//----------
 		void Base::drawWorldStage() {
+			Utils::Profiler::Scope profile(this->profileStatistics[Utils::Profiler::DrawWorldStage], this->name, Utils::Profiler::DrawWorldStage);
 			this->onDrawWorldStage.notifyListeners();
 		}
 
@@ -229,6 +275,7 @@ namespace ofxRulr {
 				}
 			}
 			else {
+				Utils::Profiler::Scope profile(this->profileStatistics[Utils::Profiler::DrawWorldAdvanced], this->name, Utils::Profiler::DrawWorldAdvanced);
 				this->onDrawWorldAdvanced.notifyListeners(args);
 			}
 		}
@@ -243,6 +290,16 @@ namespace ofxRulr {
 			this->onRemoteControl.notifyListeners(args);
 		}
 
+		//----------
+		bool Base::getUpdateIsThreadSafe() const {
+			return this->updateIsThreadSafe;
+		}
+
+		//----------
+		const Utils::Profiler::Statistics & Base::getProfileStatistics(Utils::Profiler::Stage stage) const {
+			return this->profileStatistics[stage];
+		}
+
 		//----------
 		void Base::throwIfMissingAnyConnection() const {
 			const auto inputPins = this->getInputPins();
@@ -255,6 +312,17 @@ namespace ofxRulr {
 			}
 		}
 
+		//----------
+		void Base::markDirty() {
+			this->revision++;
+			this->onMarkDirty.notifyListeners();
+		}
+
+		//----------
+		uint64_t Base::getRevision() const {
+			return this->revision.load();
+		}
+
 		//----------
 		void Base::manageParameters(ofParameterGroup & parameters, bool addToInspector) {
 			this->onSerialize += [&parameters](nlohmann::json & json) {
@@ -263,6 +331,9 @@ namespace ofxRulr {
 			this->onDeserialize += [&parameters](const nlohmann::json & json) {
 				Utils::deserialize(json, parameters);
 			};
+			this->parameterChangeListeners.push_back(parameters.parameterChangedE().newListener([this](ofAbstractParameter &) {
+				this->markDirty();
+			}));
 			if (addToInspector) {
 				this->onPopulateInspector += [&parameters](ofxCvGui::InspectArguments & args) {
 					args.inspector->addParameterGroup(parameters);
@@ -280,6 +351,7 @@ namespace ofxRulr {
 					this->onConnect(pin);
 				}
 				this->onAnyInputConnectionChanged.notifyListeners();
+				this->markDirty();
 			};
 			pin->onDeleteConnectionUntyped += [this, pinWeak](shared_ptr<Base> &) {
 				auto pin = pinWeak.lock();
@@ -287,6 +359,7 @@ namespace ofxRulr {
 					this->onDisconnect(pin);
 				}
 				this->onAnyInputConnectionChanged.notifyListeners();
+				this->markDirty();
 			};
 
 			this->inputPins.add(pin);
@@ -311,5 +384,10 @@ namespace ofxRulr {
 		bool Base::getUpdateAllInputsFirst() const {
 			return this->updateAllInputsFirst;
 		}
+
+		//----------
+		void Base::setUpdateIsThreadSafe(bool updateIsThreadSafe) {
+			this->updateIsThreadSafe = updateIsThreadSafe;
+		}
 	}
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "ofxRulr/Utils/Constants.h"
 #include "ofxRulr/Utils/Serializable.h"
 #include "ofxRulr/Utils/LambdaDrawable.h"
+#include "ofxRulr/Utils/Profiler.h"
 #include "ofxRulr/Exception.h"
 #include "ofxRulr/Version.h"
 
@@ -14,7 +15,9 @@
 #include "ofxAssets.h"
 
 #include <string>
+#include <atomic>
 #include <memory>
+#include <mutex>
 
 #define RULR_NODE_INIT_LISTENER \
 	this->onInit += [this]() { \
@@ -90,6 +93,9 @@ namespace ofxRulr {
 
 			///Note : manually calling update more than once per frame will have no effect
 			void update();
+			///As update, but never updates the inputs first. The UpdateScheduler uses this on worker threads, where
+			///the inputs have already been updated and may not be safe to update from that thread.
+			void updateWithoutInputs();
 
 			string getName() const override;
 			void setName(const string &);
@@ -118,6 +124,19 @@ namespace ofxRulr {
 
 			void remoteControl(RemoteControllerArgs&);
 
+			///Nodes whose update makes no GL / GUI calls and doesn't modify any other node may be updated from a worker thread.
+			///This is off by default, each node type has to opt in with setUpdateIsThreadSafe(true).
+			bool getUpdateIsThreadSafe() const;
+
+			const Utils::Profiler::Statistics & getProfileStatistics(Utils::Profiler::Stage) const;
+
+			///Saving only serializes nodes which have been marked dirty since they were last serialized.
+			///Changes to managed parameters or input connections, loading and being inspected all mark the node dirty.
+			///Call this when the node's saved state changes in any other way (e.g. from its update or its panel).
+			void markDirty();
+			///Increases every time the node is marked dirty
+			uint64_t getRevision() const;
+
 			template<typename NodeType>
 			void connect(shared_ptr<NodeType> node) {
 				auto inputPin = this->getInputPins().get<typename Graph::Pin<NodeType>>();
@@ -190,6 +209,7 @@ namespace ofxRulr {
 			ofxLiquidEvent<shared_ptr<Graph::AbstractPin>> onConnect;
 			ofxLiquidEvent<shared_ptr<Graph::AbstractPin>> onDisconnect;
 			ofxLiquidEvent<void> onAnyInputConnectionChanged;
+			ofxLiquidEvent<void> onMarkDirty;
 		protected:
 			void addInput(shared_ptr<Graph::AbstractPin>);
 
@@ -213,7 +233,11 @@ namespace ofxRulr {
 			void setUpdateAllInputsFirst(bool);
 			bool getUpdateAllInputsFirst() const;
 
+			void setUpdateIsThreadSafe(bool);
+
 		private:
+			void update(bool updateInputs);
+
 			Graph::Editor::NodeHost * nodeHost;
 			Graph::PinSet inputPins;
 			shared_ptr<Utils::LambdaDrawable> icon;
@@ -222,10 +246,18 @@ namespace ofxRulr {
 			string name;
 			bool initialized;
 			uint64_t lastFrameUpdate;
+			std::recursive_mutex updateMutex; ///< Guards lastFrameUpdate and the update of inputs (recursive for loopbacks)
 			bool updateAllInputsFirst;
+			bool updateIsThreadSafe;
 
 			WhenActive::Options whenDrawOnWorldStage;
 
+			Utils::Profiler::Statistics profileStatistics[Utils::Profiler::StageCount];
+			Utils::Profiler::Clock::time_point populateInspectorStart;
+
+			std::atomic<uint64_t> revision{ 0 };
+			vector<ofEventListener> parameterChangeListeners;
+
 			//we'd love to have parameters for drawWorldEnabled, etc
 			//but adding ofParameters here seems to cause crashes
 		};
@@ -0,0 +1,121 @@
+#include "pch_RulrCore.h"
+#include "BatchImport.h"
+
+#include "ofxRulr/Utils/ScopedProcess.h"
+#include "ofxRulr/Utils/ThreadPool.h"
+#include "ofxRulr/Utils/Utils.h"
+
+namespace ofxRulr {
+	namespace Utils {
+		namespace BatchImport {
+			//----------
+			bool isImageFile(const filesystem::path & path) {
+				auto extension = ofToLower(path.extension().string());
+				return extension == ".png"
+					|| extension == ".bmp"
+					|| extension == ".jpg"
+					|| extension == ".jpeg"
+					|| extension == ".tif"
+					|| extension == ".tiff";
+			}
+
+			//----------
+			vector<filesystem::path> listImages(const filesystem::path & folder) {
+				vector<filesystem::path> files;
+				for (filesystem::directory_iterator it(folder)
+					; it != filesystem::directory_iterator()
+					; ++it) {
+					if (filesystem::is_regular_file(it->status()) && isImageFile(it->path())) {
+						files.push_back(it->path());
+					}
+				}
+
+				// Directory listing order isn't guaranteed
+				sort(files.begin(), files.end());
+				return files;
+			}
+
+			//----------
+			Summary process(const vector<filesystem::path> & files
+				, const ProcessFunction & processFunction
+				, const Settings & settings) {
+				Summary summary;
+				if (files.empty()) {
+					return summary;
+				}
+
+				const auto threadCount = settings.threads > 0
+					? settings.threads
+					: max<size_t>(thread::hardware_concurrency(), 1);
+				const auto prefetch = max(settings.prefetch, threadCount);
+
+				Utils::ScopedProcess scopedProcess("Importing " + ofToString(files.size()) + " images", false, files.size());
+				scopedProcess.setCancellable(true);
+				const auto startTime = chrono::high_resolution_clock::now();
+
+				// Declared after everything the workers use, so that it joins them before those go away
+				Utils::ThreadPool threadPool(threadCount, prefetch);
+
+				// The window of files in flight, oldest first. We never queue more than the pool can hold
+				deque<future<function<void()>>> inFlight;
+				size_t nextToQueue = 0;
+				size_t nextToCommit = 0;
+				auto fillWindow = [&]() {
+					while (nextToQueue < files.size() && inFlight.size() < prefetch && !scopedProcess.isCancelled()) {
+						const auto path = files[nextToQueue++];
+						inFlight.push_back(threadPool.performAsyncWithExceptionHandling<function<void()>>([&scopedProcess, &processFunction, &settings, path]() {
+							if (scopedProcess.isCancelled()) {
+								return function<void()>();
+							}
+							auto image = cv::imread(path.string(), settings.imreadFlags);
+							if (image.empty()) {
+								throw(ofxRulr::Exception("Couldn't load image"));
+							}
+							return processFunction(image, path);
+						}));
+					}
+				};
+
+				fillWindow();
+				while (!inFlight.empty()) {
+					auto result = move(inFlight.front());
+					inFlight.pop_front();
+					const auto & path = files[nextToCommit++];
+
+					ScopedProcess::ActiveProcesses::X().pollCancelKey();
+					if (scopedProcess.isCancelled()) {
+						// Let anything still running finish, but don't use it
+						result.wait();
+						continue;
+					}
+
+					fillWindow();
+
+					try {
+						Utils::ScopedProcess fileScopedProcess(path.filename().string(), false);
+						auto action = result.get();
+						if (action) {
+							action();
+						}
+						summary.imported++;
+					}
+					RULR_CATCH_ALL_TO({
+						summary.failed++;
+						RULR_WARNING << path.filename().string() << " : " << e.what();
+					});
+				}
+
+				summary.cancelled = scopedProcess.isCancelled();
+
+				const auto duration = chrono::high_resolution_clock::now() - startTime;
+				ofLogNotice("BatchImport") << summary.imported << " imported, " << summary.failed << " failed"
+					<< (summary.cancelled ? " (cancelled)" : "")
+					<< " in " << Utils::formatDuration(duration, false, true, true, true)
+					<< " on " << threadCount << " threads";
+
+				scopedProcess.end();
+				return summary;
+			}
+		}
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "ofxRulr/Utils/Constants.h"
+
+#include <functional>
+#include <vector>
+
+namespace ofxRulr {
+	namespace Utils {
+		/// Imports a folder's worth of images : decoding and processing (e.g. finding markers) run in parallel
+		/// on a pool of threads, whilst the results are handed back on the calling thread in file order, so the
+		/// captures come out the same however the work was scheduled. Only a bounded number of images are in
+		/// flight at once, so memory use doesn't grow with the size of the folder.
+		/// The workers already keep the cores busy, so the process function shouldn't parallelise its own work.
+		namespace BatchImport {
+			struct Settings {
+				size_t threads = 0; ///< 0 : one per core
+				size_t prefetch = 0; ///< Images being decoded / processed / waiting for their turn (at least threads). 0 : one per thread
+				int imreadFlags = cv::IMREAD_COLOR;
+			};
+
+			struct Summary {
+				size_t imported = 0;
+				size_t failed = 0;
+				bool cancelled = false;
+			};
+
+			/// Called on a worker thread with the decoded image. Throw to skip the image, otherwise return the
+			/// action to perform on the calling thread (e.g. adding the capture). The action may be empty.
+			typedef std::function<std::function<void()>(const cv::Mat & image, const std::filesystem::path &)> ProcessFunction;
+
+			OFXRULR_API_ENTRY bool isImageFile(const std::filesystem::path &);
+
+			/// Image files in the folder, sorted by name
+			OFXRULR_API_ENTRY std::vector<std::filesystem::path> listImages(const std::filesystem::path & folder);
+
+			/// Runs inside a ScopedProcess which shows progress and can be cancelled with [ESC] (on Windows).
+			/// Failures are logged and counted, they don't stop the rest of the batch.
+			OFXRULR_API_ENTRY Summary process(const std::vector<std::filesystem::path> & files
+				, const ProcessFunction &
+				, const Settings & = Settings());
+		}
+	}
+}
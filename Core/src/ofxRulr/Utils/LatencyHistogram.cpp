@@ -0,0 +1,96 @@
+#include "pch_RulrCore.h"
+#include "LatencyHistogram.h"
+
+namespace ofxRulr {
+	namespace Utils {
+		const float minimumLatency = 0.01f; // [ms]
+		const float bucketsPerOctave = 4.0f;
+
+		//----------
+		LatencyHistogram::LatencyHistogram() {
+			this->clear();
+		}
+
+		//----------
+		void LatencyHistogram::add(float milliseconds) {
+			this->buckets[LatencyHistogram::getBucketIndex(milliseconds)]++;
+
+			auto currentMax = this->max.load();
+			while (milliseconds > currentMax && !this->max.compare_exchange_weak(currentMax, milliseconds)) { }
+		}
+
+		//----------
+		void LatencyHistogram::clear() {
+			for (auto & bucket : this->buckets) {
+				bucket.store(0);
+			}
+			this->max.store(0.0f);
+		}
+
+		//----------
+		uint64_t LatencyHistogram::getCount() const {
+			uint64_t count = 0;
+			for (const auto & bucket : this->buckets) {
+				count += bucket.load();
+			}
+			return count;
+		}
+
+		//----------
+		float LatencyHistogram::getMax() const {
+			return this->max.load();
+		}
+
+		//----------
+		float LatencyHistogram::getPercentile(float fraction) const {
+			uint64_t counts[BucketCount];
+			uint64_t total = 0;
+			for (size_t i = 0; i < BucketCount; i++) {
+				counts[i] = this->buckets[i].load();
+				total += counts[i];
+			}
+			if (total == 0) {
+				return 0.0f;
+			}
+
+			const auto target = (uint64_t) ceil(fraction * (float) total);
+			uint64_t runningCount = 0;
+			for (size_t i = 0; i < BucketCount; i++) {
+				runningCount += counts[i];
+				if (runningCount >= target && counts[i] > 0) {
+					return min(LatencyHistogram::getBucketUpperEdge(i), this->max.load());
+				}
+			}
+			return this->max.load();
+		}
+
+		//----------
+		std::string LatencyHistogram::toString() const {
+			if (this->getCount() == 0) {
+				return "-";
+			}
+
+			stringstream ss;
+			ss << std::fixed << std::setprecision(2);
+			ss << "p50 " << this->getPercentile(0.5f)
+				<< "  p90 " << this->getPercentile(0.9f)
+				<< "  p99 " << this->getPercentile(0.99f)
+				<< "  max " << this->getMax();
+			return ss.str();
+		}
+
+		//----------
+		size_t LatencyHistogram::getBucketIndex(float milliseconds) {
+			if (!(milliseconds > minimumLatency)) {
+				return 0;
+			}
+			auto index = (size_t) (log2(milliseconds / minimumLatency) * bucketsPerOctave);
+			return min(index, BucketCount - 1);
+		}
+
+		//----------
+		float LatencyHistogram::getBucketUpperEdge(size_t bucketIndex) {
+			return minimumLatency * pow(2.0f, (float) (bucketIndex + 1) / bucketsPerOctave);
+		}
+	}
+}
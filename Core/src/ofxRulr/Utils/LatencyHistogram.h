@@ -0,0 +1,37 @@
+#pragma once
+
+#include "ofxRulr/Utils/Constants.h"
+
+#include <atomic>
+#include <string>
+
+namespace ofxRulr {
+	namespace Utils {
+		/// Counts durations into logarithmic buckets (4 per octave, from 10us to ~10s) so that
+		/// percentiles can be read out cheaply. add() is lock free and can be called from any thread.
+		class OFXRULR_API_ENTRY LatencyHistogram {
+		public:
+			static const size_t BucketCount = 80;
+
+			LatencyHistogram();
+
+			void add(float milliseconds);
+			void clear();
+
+			uint64_t getCount() const;
+			float getMax() const;
+
+			/// Upper edge of the bucket containing the given fraction of samples [ms]
+			float getPercentile(float fraction) const;
+
+			/// e.g. "p50 1.19  p90 2.83  p99 4.76  max 5.02" (in ms)
+			std::string toString() const;
+		protected:
+			static size_t getBucketIndex(float milliseconds);
+			static float getBucketUpperEdge(size_t bucketIndex);
+
+			std::atomic<uint64_t> buckets[BucketCount];
+			std::atomic<float> max{ 0.0f };
+		};
+	}
+}
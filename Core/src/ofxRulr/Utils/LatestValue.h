@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace ofxRulr {
+	namespace Utils {
+		/// Lock-free 'latest value' handoff to one consumer thread (a triple buffer).
+		/// Producers overwrite, the consumer only ever sees the newest complete value and never waits.
+		/// Any number of producer threads may call set, but they must hold a shared producer-side mutex while doing so
+		/// (set is not safe to call concurrently with itself). The consumer never takes that mutex.
+		template<typename T>
+		class LatestValue {
+		public:
+			//producer (serialise with other producers)
+			void set(T value) {
+				this->buffers[this->backIndex] = std::move(value);
+				auto previous = this->middle.exchange(this->backIndex | NewFlag, std::memory_order_acq_rel);
+				this->backIndex = previous & IndexMask;
+			}
+
+			//consumer : returns false (and leaves value alone) if nothing new has been set since the last call
+			bool tryGet(T & value) {
+				if (!(this->middle.load(std::memory_order_relaxed) & NewFlag)) {
+					return false;
+				}
+				auto previous = this->middle.exchange(this->frontIndex, std::memory_order_acq_rel);
+				this->frontIndex = previous & IndexMask;
+
+				auto & buffer = this->buffers[this->frontIndex];
+				value = std::move(buffer);
+				buffer = T(); // don't keep the value alive in the buffer
+				return true;
+			}
+
+			//consumer : drop anything waiting
+			void clear() {
+				T discard;
+				this->tryGet(discard);
+			}
+		protected:
+			static const uint8_t IndexMask = 0x3;
+			static const uint8_t NewFlag = 0x4;
+
+			T buffers[3];
+			alignas(64) std::atomic<uint8_t> middle{ 1 };
+			alignas(64) uint8_t backIndex = 0; // producers only (under their mutex)
+			alignas(64) uint8_t frontIndex = 2; // consumer only
+		};
+	}
+}
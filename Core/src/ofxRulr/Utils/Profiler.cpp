@@ -0,0 +1,200 @@
+#include "pch_RulrCore.h"
+#include "Profiler.h"
+
+OFXSINGLETON_DEFINE(ofxRulr::Utils::Profiler);
+
+namespace ofxRulr {
+	namespace Utils {
+#pragma mark Statistics
+		//----------
+		void Profiler::Statistics::add(float duration) {
+			lock_guard<mutex> lock(this->addMutex);
+			this->last = duration;
+			this->mean = this->count == 0
+				? duration
+				: ofLerp(this->mean.load(), duration, 0.05f);
+			this->max = MAX(this->max.load() * 0.99f, duration);
+			this->count++;
+		}
+
+#pragma mark Scope
+		//----------
+		Profiler::Scope::Scope(Statistics & statistics, const string & name, Stage stage)
+			: statistics(statistics)
+			, name(name)
+			, stage(stage)
+			, start(Clock::now()) {
+
+		}
+
+		//----------
+		Profiler::Scope::~Scope() {
+			auto end = Clock::now();
+			chrono::duration<float, ratio<1, 1000>> duration = end - this->start;
+			this->statistics.add(duration.count());
+
+			auto & profiler = Profiler::X();
+			if (profiler.isCapturing()) {
+				profiler.record(this->name, this->stage, this->start, end);
+			}
+		}
+
+#pragma mark Profiler
+		//----------
+		const char * Profiler::getStageName(Stage stage) {
+			switch (stage) {
+			case Update:
+				return "Update";
+			case DrawWorldStage:
+				return "DrawWorldStage";
+			case DrawWorldAdvanced:
+				return "DrawWorldAdvanced";
+			case PopulateInspector:
+				return "PopulateInspector";
+			case Frame:
+				return "Frame";
+			default:
+				return "Unknown";
+			}
+		}
+
+		//----------
+		Profiler::Profiler() {
+
+		}
+
+		//----------
+		void Profiler::update() {
+			if (!this->capturing) {
+				return;
+			}
+
+			bool finished = false;
+			{
+				unique_lock<mutex> lock(this->eventsMutex);
+				if (this->captureFramesRemaining > 0) {
+					this->captureFramesRemaining--;
+				}
+				finished = this->captureFramesRemaining == 0;
+			}
+
+			if (finished) {
+				this->endCapture();
+			}
+		}
+
+		//----------
+		void Profiler::record(const string & name, Stage stage, const Clock::time_point & start, const Clock::time_point & end) {
+			if (!this->capturing) {
+				return;
+			}
+
+			unique_lock<mutex> lock(this->eventsMutex);
+			this->events.push_back({
+				name
+				, stage
+				, this_thread::get_id()
+				, start
+				, end
+			});
+		}
+
+		//----------
+		void Profiler::beginCapture(size_t frameCount, const string & filename) {
+			if (frameCount == 0) {
+				throw(ofxRulr::Exception("Profiler capture needs at least 1 frame"));
+			}
+
+			unique_lock<mutex> lock(this->eventsMutex);
+			this->events.clear();
+			this->captureFramesRemaining = frameCount;
+			this->captureFilename = filename;
+			this->captureStart = Clock::now();
+			this->capturing = true;
+		}
+
+		//----------
+		void Profiler::endCapture() {
+			if (!this->capturing) {
+				return;
+			}
+			this->capturing = false;
+
+			try {
+				this->writeCapture();
+			}
+			RULR_CATCH_ALL_TO_ERROR;
+		}
+
+		//----------
+		bool Profiler::isCapturing() const {
+			return this->capturing;
+		}
+
+		//----------
+		size_t Profiler::getCaptureFramesRemaining() const {
+			unique_lock<mutex> lock(this->eventsMutex);
+			return this->captureFramesRemaining;
+		}
+
+		//----------
+		void Profiler::writeCapture() {
+			vector<Event> events;
+			{
+				unique_lock<mutex> lock(this->eventsMutex);
+				swap(events, this->events);
+			}
+
+			// Chrome trace format (complete events, timestamps in microseconds)
+			nlohmann::json json;
+			auto & traceEventsJson = json["traceEvents"];
+			traceEventsJson = nlohmann::json::array();
+
+			map<thread::id, int> threadIndices;
+			auto mainThreadID = this_thread::get_id(); // we're called from World::update
+			threadIndices[mainThreadID] = 0;
+
+			for (const auto & event : events) {
+				auto findThread = threadIndices.find(event.threadID);
+				int threadIndex;
+				if (findThread == threadIndices.end()) {
+					threadIndex = (int) threadIndices.size();
+					threadIndices.emplace(event.threadID, threadIndex);
+				}
+				else {
+					threadIndex = findThread->second;
+				}
+
+				nlohmann::json eventJson;
+				eventJson["name"] = event.name;
+				eventJson["cat"] = getStageName(event.stage);
+				eventJson["ph"] = "X";
+				eventJson["ts"] = chrono::duration_cast<chrono::microseconds>(event.start - this->captureStart).count();
+				eventJson["dur"] = chrono::duration_cast<chrono::microseconds>(event.end - event.start).count();
+				eventJson["pid"] = 0;
+				eventJson["tid"] = threadIndex;
+				traceEventsJson.push_back(eventJson);
+			}
+
+			// Name the threads
+			for (const auto & threadIndex : threadIndices) {
+				nlohmann::json metaJson;
+				metaJson["name"] = "thread_name";
+				metaJson["ph"] = "M";
+				metaJson["pid"] = 0;
+				metaJson["tid"] = threadIndex.second;
+				metaJson["args"]["name"] = threadIndex.second == 0
+					? string("Main")
+					: "Worker " + ofToString(threadIndex.second);
+				traceEventsJson.push_back(metaJson);
+			}
+
+			ofFile output;
+			output.open(this->captureFilename, ofFile::WriteOnly, false);
+			output << json.dump();
+			output.close();
+
+			ofLogNotice("ofxRulr") << "Profile of " << events.size() << " events saved to " << ofToDataPath(this->captureFilename, true);
+		}
+	}
+}
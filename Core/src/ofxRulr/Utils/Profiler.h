@@ -0,0 +1,87 @@
+#pragma once
+
+#include "ofxRulr/Utils/Constants.h"
+#include "ofxSingleton.h"
+
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <map>
+
+namespace ofxRulr {
+	namespace Utils {
+		/// Collects timings of node stages. Rolling statistics are always kept per node,
+		/// and a capture of a number of app frames can be written as a Chrome trace
+		/// (open with chrome://tracing or ui.perfetto.dev).
+		class OFXRULR_API_ENTRY Profiler : public ofxSingleton::Singleton<Profiler> {
+		public:
+			typedef chrono::high_resolution_clock Clock;
+
+			enum Stage {
+				Update = 0,
+				DrawWorldStage,
+				DrawWorldAdvanced,
+				PopulateInspector,
+				Frame,
+				StageCount
+			};
+
+			static const char * getStageName(Stage);
+
+			/// Rolling statistics for one stage of one node. May be added to from worker threads whilst the gui reads it
+			struct Statistics {
+				void add(float duration);
+				atomic<float> mean{ 0.0f }; ///< Smoothed duration [ms]
+				atomic<float> max{ 0.0f }; ///< Decaying peak duration [ms]
+				atomic<float> last{ 0.0f }; ///< Most recent duration [ms]
+				atomic<uint64_t> count{ 0 };
+			protected:
+				mutex addMutex;
+			};
+
+			/// Times its own lifetime, adding it to the statistics and to any active capture.
+			/// The name must outlive the Scope.
+			class OFXRULR_API_ENTRY Scope {
+			public:
+				Scope(Statistics &, const string & name, Stage);
+				~Scope();
+			protected:
+				Statistics & statistics;
+				const string & name;
+				Stage stage;
+				Clock::time_point start;
+			};
+
+			Profiler();
+
+			/// Call once per app frame (World::update does this)
+			void update();
+
+			void record(const string & name, Stage, const Clock::time_point & start, const Clock::time_point & end);
+
+			void beginCapture(size_t frameCount, const string & filename);
+			void endCapture();
+			bool isCapturing() const;
+			size_t getCaptureFramesRemaining() const;
+		protected:
+			struct Event {
+				string name;
+				Stage stage;
+				thread::id threadID;
+				Clock::time_point start;
+				Clock::time_point end;
+			};
+
+			void writeCapture();
+
+			mutable mutex eventsMutex;
+			vector<Event> events;
+
+			atomic<bool> capturing{ false };
+			size_t captureFramesRemaining = 0;
+			string captureFilename;
+			Clock::time_point captureStart;
+		};
+	}
+}
@@ -62,8 +62,10 @@ namespace ofxRulr {
 			//print to screen
 			{
 				stringstream message;
+				bool anyCancellable = false;
 				for (const auto process : this->activeProcesses) {
 					message << process->getActivityName() << endl;
+					anyCancellable |= process->getCancellable();
 					if (process->hasCountedChildProcesses()) {
 						message << "[" << process->getChildProcessActiveIndex() << "/" << process->getChildProcessCount() << "] ";
 						
@@ -84,6 +86,11 @@ namespace ofxRulr {
 						message << endl;
 					}
 				}
+#ifdef TARGET_WIN32
+				if (anyCancellable) {
+					message << "Press [ESC] to cancel" << endl;
+				}
+#endif
 				ofxCvGui::Utils::drawProcessingNotice(message.str());
 			}
 
@@ -215,6 +222,25 @@ namespace ofxRulr {
 			return this->waitForStartSound;
 		}
 
+		//----------
+		void ScopedProcess::ActiveProcesses::pollCancelKey() {
+			// The main thread is busy inside the process so the app isn't receiving key events. Ask the OS directly.
+			// Other platforms have no equivalent which works without pumping the window's events, so there
+			// processes can only be cancelled from code (ScopedProcess::cancel)
+#ifdef TARGET_WIN32
+			bool cancelKeyPressed = (GetAsyncKeyState(VK_ESCAPE) & 0x8000) && GetForegroundWindow() == ofGetWin32Window();
+			if (!cancelKeyPressed) {
+				return;
+			}
+
+			for (auto process : this->activeProcesses) {
+				if (process->getCancellable() && !process->isCancelled()) {
+					process->cancel();
+				}
+			}
+#endif
+		}
+
 #pragma mark ScopedProcess
 		//----------
 		ScopedProcess::ScopedProcess(const string & activityName, bool hasSuccessOrFail) {
@@ -293,5 +319,32 @@ namespace ofxRulr {
 		size_t ScopedProcess::getChildProcessActiveIndex() const {
 			return this->childProcessActiveIndex;
 		}
+
+		//----------
+		void ScopedProcess::setCancellable(bool cancellable) {
+			this->cancellable = cancellable;
+		}
+
+		//----------
+		bool ScopedProcess::getCancellable() const {
+			return this->cancellable;
+		}
+
+		//----------
+		void ScopedProcess::cancel() {
+			this->cancelled.store(true);
+		}
+
+		//----------
+		bool ScopedProcess::isCancelled() const {
+			return this->cancelled.load();
+		}
+
+		//----------
+		void ScopedProcess::throwIfCancelled() const {
+			if (this->isCancelled()) {
+				throw(ofxRulr::Exception("Cancelled : " + this->activityName));
+			}
+		}
 	}
 }
@@ -15,6 +15,10 @@ namespace ofxRulr {
 				void pushProcess(ScopedProcess *);
 				void popProcess(ScopedProcess *);
 				bool waitingForStartSound() const;
+
+				/// Cancel all active processes if the user is pressing [ESC]. Call from the main thread.
+				/// Windows only (elsewhere this does nothing, since key events aren't delivered whilst the main thread is busy).
+				void pollCancelKey();
 			protected:
 				vector<ScopedProcess *> activeProcesses;
 				bool active;
@@ -44,12 +48,23 @@ namespace ofxRulr {
 
 			size_t getChildProcessCount() const;
 			size_t getChildProcessActiveIndex() const;
+
+			/// Processes which check isCancelled() should say so here, so that the notice tells the user how to cancel
+			void setCancellable(bool);
+			bool getCancellable() const;
+
+			/// Safe to call from any thread
+			void cancel();
+			bool isCancelled() const;
+			void throwIfCancelled() const;
 		protected:
 			bool active = false;
 			bool success = false;
 			bool hasSuccessOrFail = true;
 			size_t childProcessCount = 0;
 			size_t childProcessActiveIndex = 0;
+			bool cancellable = false;
+			atomic<bool> cancelled{ false };
 			string activityName;
 			chrono::system_clock::time_point startTime;
 			chrono::system_clock::duration duration;
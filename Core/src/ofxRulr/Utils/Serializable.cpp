@@ -2,11 +2,235 @@
 #include "Serializable.h"
 
 #include "../Exception.h"
+#include "ThreadPool.h"
 
 using namespace std;
 
 namespace ofxRulr {
 	namespace Utils {
+		//----------
+		Serializable::Format Serializable::defaultFormat = Serializable::Format::JSON;
+
+		//----------
+		// Finds the values at a path of object keys in JSON text, without building them
+		class JsonScanner {
+		public:
+			struct Value {
+				vector<string> keys;
+				size_t begin;
+				size_t end;
+			};
+
+			JsonScanner(const string & text)
+				: text(text) { }
+
+			void find(const vector<string> & path, vector<Value> & values) {
+				this->position = 0;
+				vector<string> keys;
+				this->skipWhitespace();
+				this->findInValue(path, keys, values);
+			}
+		protected:
+			void findInValue(const vector<string> & path, vector<string> & keys, vector<Value> & values) {
+				if (keys.size() == path.size()) {
+					auto begin = this->position;
+					this->skipValue();
+					values.push_back({ keys, begin, this->position });
+					return;
+				}
+
+				if (this->peek() != '{') {
+					this->skipValue();
+					return;
+				}
+
+				this->position++;
+				this->skipWhitespace();
+				if (this->peek() == '}') {
+					this->position++;
+					return;
+				}
+
+				while (true) {
+					auto key = this->readString();
+					this->skipWhitespace();
+					this->expect(':');
+					this->skipWhitespace();
+
+					const auto & pathKey = path[keys.size()];
+					if (pathKey == "*" || pathKey == key) {
+						keys.push_back(key);
+						this->findInValue(path, keys, values);
+						keys.pop_back();
+					}
+					else {
+						this->skipValue();
+					}
+
+					this->skipWhitespace();
+					if (this->peek() == ',') {
+						this->position++;
+						this->skipWhitespace();
+					}
+					else {
+						this->expect('}');
+						return;
+					}
+				}
+			}
+
+			void skipValue() {
+				switch (this->peek()) {
+				case '"':
+					this->skipString();
+					break;
+				case '{':
+				case '[':
+				{
+					// Only brackets and strings matter when skipping a container
+					const auto * data = this->text.data();
+					const auto size = this->text.size();
+					auto position = this->position;
+					size_t depth = 0;
+					do {
+						if (position >= size) {
+							throw(ofxRulr::Exception("Unexpected end of JSON"));
+						}
+						switch (data[position++]) {
+						case '"':
+							while (position < size && data[position] != '"') {
+								position += data[position] == '\\' ? 2 : 1;
+							}
+							position++;
+							break;
+						case '{':
+						case '[':
+							depth++;
+							break;
+						case '}':
+						case ']':
+							depth--;
+							break;
+						default:
+							break;
+						}
+					} while (depth > 0);
+					this->position = position;
+					break;
+				}
+				default:
+					// Number, true, false or null
+					while (this->position < this->text.size()) {
+						auto character = this->text[this->position];
+						if (character == ',' || character == '}' || character == ']' || isspace((unsigned char) character)) {
+							break;
+						}
+						this->position++;
+					}
+					break;
+				}
+			}
+
+			void skipString() {
+				this->expect('"');
+				while (true) {
+					auto character = this->peek();
+					this->position++;
+					if (character == '\\') {
+						this->position++;
+					}
+					else if (character == '"') {
+						return;
+					}
+				}
+			}
+
+			string readString() {
+				auto begin = this->position;
+				this->skipString();
+				auto raw = this->text.substr(begin, this->position - begin);
+				if (raw.find('\\') == string::npos) {
+					return raw.substr(1, raw.size() - 2);
+				}
+				else {
+					return nlohmann::json::parse(raw).get<string>();
+				}
+			}
+
+			char peek() const {
+				if (this->position >= this->text.size()) {
+					throw(ofxRulr::Exception("Unexpected end of JSON"));
+				}
+				return this->text[this->position];
+			}
+
+			void expect(char character) {
+				if (this->peek() != character) {
+					throw(ofxRulr::Exception("Malformed JSON at byte " + ofToString(this->position)));
+				}
+				this->position++;
+			}
+
+			void skipWhitespace() {
+				while (this->position < this->text.size() && isspace((unsigned char) this->text[this->position])) {
+					this->position++;
+				}
+			}
+
+			const string & text;
+			size_t position = 0;
+		};
+
+		//----------
+		// Parse the values at the path on the shared pool and the rest of the document on this thread
+		static nlohmann::json parseJsonInParallel(const string & text, const vector<string> & path) {
+			if (Utils::ThreadPool::X().getPoolSize() < 2) {
+				return nlohmann::json::parse(text);
+			}
+
+			vector<JsonScanner::Value> values;
+			JsonScanner(text).find(path, values);
+			if (values.size() < 2) {
+				return nlohmann::json::parse(text);
+			}
+
+			// The document with each of those values replaced by null
+			string outline;
+			{
+				size_t position = 0;
+				for (const auto & value : values) {
+					outline.append(text, position, value.begin - position);
+					outline.append("null");
+					position = value.end;
+				}
+				outline.append(text, position, string::npos);
+			}
+
+			vector<nlohmann::json> parsedValues(values.size());
+			vector<function<void()>> actions;
+			for (size_t i = 0; i < values.size(); i++) {
+				actions.push_back([&text, &values, &parsedValues, i]() {
+					const auto & value = values[i];
+					parsedValues[i] = nlohmann::json::parse(text.begin() + value.begin, text.begin() + value.end);
+				});
+			}
+			nlohmann::json json;
+			actions.push_back([&outline, &json]() {
+				json = nlohmann::json::parse(outline);
+			});
+			Utils::ThreadPool::X().performBatch(actions);
+
+			for (size_t i = 0; i < values.size(); i++) {
+				auto * target = &json;
+				for (const auto & key : values[i].keys) {
+					target = &(*target)[key];
+				}
+				*target = move(parsedValues[i]);
+			}
+
+			return json;
+		}
+
 		//----------
 		string Serializable::getName() const {
 			return this->getTypeName();
@@ -25,41 +249,21 @@ namespace ofxRulr {
 		//----------
 		void Serializable::save(string filename) {
 			if (filename == "") {
-				auto result = ofSystemSaveDialog(this->getDefaultFilename() + ".json", "Save " + this->getTypeName());
+				auto result = ofSystemSaveDialog(this->getDefaultFilename() + Serializable::getFileExtension(Serializable::defaultFormat), "Save " + this->getTypeName());
 				if (result.bSuccess) {
 					filename = result.fileName;
 				}
 			}
 
 			if (filename != "") {
-				// We write to a temporary file first and then copy across
-				// This avoids emptying the output file and not saving anything (e.g. in case of exception whlilst serialising)
-
-				auto tempFilename = filename + "-temp";
-
 				nlohmann::json json;
 				this->serialize(json);
 
-				{
-					ofFile output;
-					output.open(tempFilename, ofFile::WriteOnly, false);
-					output << json.dump(4);
-					output.close();
-				}
-
-				if (ofFile::doesFileExist(filename)) {
-					// delete the old file
-					ofFile::removeFile(filename);
-				}
-
-				// Copy the temp file to the correct file
-				if (ofFile::copyFromTo(tempFilename, filename, true)) {
-					ofFile::removeFile(tempFilename);
-				}
-
 				if (json.empty()) {
 					throw(ofxRulr::Exception("Serialization failed"));
 				}
+
+				Serializable::writeFileAtomically(filename, Serializable::encode(json, Serializable::getFormatOfFile(filename)));
 			}
 		}
 
@@ -75,11 +279,7 @@ namespace ofxRulr {
 			if (filename != "") {
 				try {
 					if (ofFile::doesFileExist(filename)) {
-						ofFile input;
-						input.open(ofToDataPath(filename, true), ofFile::ReadOnly, false);
-						string jsonRaw = input.readToBuffer().getText();
-
-						auto json = nlohmann::json::parse(jsonRaw);
+						auto json = Serializable::readJsonFile(filename, this->getParallelParsePath());
 						this->deserialize(json);
 					}
 				}
@@ -87,6 +287,142 @@ namespace ofxRulr {
 			}
 		}
 
+		//----------
+		void Serializable::writeFileAtomically(const string & filename, const string & contents) {
+			auto path = filesystem::path(ofToDataPath(filename, true));
+			auto tempPath = path;
+			tempPath += "-temp";
+
+			{
+				ofstream output(tempPath, ios::binary);
+				if (!output.is_open()) {
+					throw(ofxRulr::Exception("Couldn't open " + tempPath.string() + " for writing"));
+				}
+				output << contents;
+				output.close();
+				if (output.fail()) {
+					throw(ofxRulr::Exception("Failed to write " + tempPath.string()));
+				}
+			}
+
+			// Replaces any existing file in one step
+			filesystem::rename(tempPath, path);
+		}
+
+		//----------
+		nlohmann::json Serializable::readJsonFile(const string & filename, const vector<string> & parallelParsePath) {
+			ifstream input(filesystem::path(ofToDataPath(filename, true)), ios::binary);
+			if (!input.is_open()) {
+				throw(ofxRulr::Exception("Couldn't open " + filename + " for reading"));
+			}
+			auto contents = string(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+			return Serializable::decode(contents, Serializable::getFormatOfFile(filename), parallelParsePath);
+		}
+
+		//----------
+		void Serializable::setDefaultFormat(Format format) {
+			Serializable::defaultFormat = format == Format::Default
+				? Format::JSON
+				: format;
+		}
+
+		//----------
+		Serializable::Format Serializable::getDefaultFormat() {
+			return Serializable::defaultFormat;
+		}
+
+		//----------
+		const char * Serializable::getFormatName(Format format) {
+			switch (format) {
+			case Format::Default:
+				return "Default";
+			case Format::JSON:
+				return "JSON";
+			case Format::CBOR:
+				return "CBOR";
+			case Format::MessagePack:
+				return "MessagePack";
+			default:
+				return "Unknown";
+			}
+		}
+
+		//----------
+		const char * Serializable::getFileExtension(Format format) {
+			switch (format) {
+			case Format::Default:
+				return Serializable::getFileExtension(Serializable::defaultFormat);
+			case Format::CBOR:
+				return ".cbor";
+			case Format::MessagePack:
+				return ".msgpack";
+			case Format::JSON:
+			default:
+				return ".json";
+			}
+		}
+
+		//----------
+		Serializable::Format Serializable::getFormatOfFile(const string & filename) {
+			auto extension = ofToLower(ofFilePath::getFileExt(filename));
+			for (auto format : { Format::CBOR, Format::MessagePack }) {
+				if ("." + extension == Serializable::getFileExtension(format)) {
+					return format;
+				}
+			}
+			return Format::JSON;
+		}
+
+		//----------
+		string Serializable::encode(const nlohmann::json & json, Format format) {
+			if (format == Format::Default) {
+				format = Serializable::defaultFormat;
+			}
+
+			switch (format) {
+			case Format::CBOR:
+			{
+				auto bytes = nlohmann::json::to_cbor(json);
+				return string(bytes.begin(), bytes.end());
+			}
+			case Format::MessagePack:
+			{
+				auto bytes = nlohmann::json::to_msgpack(json);
+				return string(bytes.begin(), bytes.end());
+			}
+			case Format::JSON:
+			default:
+				return json.dump(4);
+			}
+		}
+
+		//----------
+		nlohmann::json Serializable::decode(const string & contents, Format format, const vector<string> & parallelParsePath) {
+			if (format == Format::Default) {
+				format = Serializable::defaultFormat;
+			}
+
+			switch (format) {
+			case Format::CBOR:
+				return nlohmann::json::from_cbor(contents.begin(), contents.end());
+			case Format::MessagePack:
+				return nlohmann::json::from_msgpack(contents.begin(), contents.end());
+			case Format::JSON:
+			default:
+				if (parallelParsePath.empty()) {
+					return nlohmann::json::parse(contents);
+				}
+				else {
+					return parseJsonInParallel(contents, parallelParsePath);
+				}
+			}
+		}
+
+		//----------
+		vector<string> Serializable::getParallelParsePath() const {
+			return vector<string>();
+		}
+
 		//----------
 		string Serializable::getDefaultFilename() const {
 			auto name = this->getName();
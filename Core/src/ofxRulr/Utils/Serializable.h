@@ -6,6 +6,7 @@
 #include <nlohmann/json.hpp>
 #include <string>
 #include <type_traits>
+#include <vector>
 
 #include "ofxRulr/Utils/Constants.h"
 #include "ofxRulr/Exception.h"
@@ -26,6 +27,14 @@ namespace ofxRulr {
 	namespace Utils {
 		class OFXRULR_API_ENTRY Serializable {
 		public:
+			/// Encoding of saved files. Each format has its own file extension (see getFileExtension)
+			enum class Format : uint8_t {
+				Default = 0, ///< Use the global default format
+				JSON,
+				CBOR,
+				MessagePack
+			};
+
 			virtual std::string getTypeName() const = 0;
 			virtual std::string getName() const;
 
@@ -37,6 +46,33 @@ namespace ofxRulr {
 			void save(std::string filename = "");
 			void load(std::string filename = "");
 			std::string getDefaultFilename() const;
+
+			/// The format used for all saved files (set from the World's settings)
+			static void setDefaultFormat(Format);
+			static Format getDefaultFormat();
+			static const char * getFormatName(Format);
+			/// Including the dot, e.g. ".cbor"
+			static const char * getFileExtension(Format);
+			/// The format a file was saved in, from its extension. Unknown extensions are read as JSON
+			static Format getFormatOfFile(const std::string & filename);
+
+			static std::string encode(const nlohmann::json &, Format);
+
+			/// parallelParsePath is a path of object keys ("*" matches any key), e.g. { "Nodes", "*", "Content" }.
+			/// In a text JSON document, the values found there are parsed concurrently on the shared thread pool
+			static nlohmann::json decode(const std::string & contents, Format, const std::vector<std::string> & parallelParsePath = {});
+
+			/// Write to a temporary file and then rename it over the target, so that the
+			/// target is never left half-written (e.g. on exception or crash)
+			static void writeFileAtomically(const std::string & filename, const std::string & contents);
+
+			/// Read and parse a file in the format given by its extension. Safe to call from any thread
+			static nlohmann::json readJsonFile(const std::string & filename, const std::vector<std::string> & parallelParsePath = {});
+		protected:
+			/// Used by load. Override this to have large independent parts of the file parsed in parallel (see decode)
+			virtual std::vector<std::string> getParallelParsePath() const;
+
+			static Format defaultFormat;
 		};
 	}
 }
@@ -5,50 +5,256 @@
 
 namespace ofxRulr {
 	namespace Utils {
+		// Which pool (and which worker of that pool) the current thread belongs to.
+		// Actions queued from inside a worker go onto that worker's own queue.
+		static thread_local ThreadPool * currentPool = nullptr;
+		static thread_local size_t currentWorkerIndex = 0;
+
 		//----------
 		ThreadPool::ThreadPool(size_t poolSize, size_t maxQueueSize)
 		: maxQueueSize(maxQueueSize) {
+			if (poolSize == 0) {
+				poolSize = 1;
+			}
+
+			// Create all the workers before starting any threads, since threads steal from each other
 			for (size_t i = 0; i < poolSize; i++) {
-				auto thread = make_unique<std::thread>([this]() {
-					std::function<void()> action;
-					while (!this->joining) {
-						if (this->actionQueue.tryReceive(action, 1000)) {
-							try {
-								action();
-							}
-							RULR_CATCH_ALL_TO_ERROR;
-						}
-					}
+				this->workers.emplace_back(make_unique<Worker>());
+			}
+			for (size_t i = 0; i < poolSize; i++) {
+				this->workers[i]->thread = std::thread([this, i]() {
+					this->workerLoop(i);
 				});
-				this->threads.insert(move(thread));
 			}
 		}
 
 		//----------
 		ThreadPool::~ThreadPool() {
-			this->actionQueue.close();
+			{
+				unique_lock<mutex> lock(this->sleepMutex);
+				this->joining = true;
+			}
+			this->sleepCondition.notify_all();
 
-			this->joining = true;
-			for (auto & thread : this->threads) {
-				if (thread->joinable()) {
-					thread->join();
+			for (auto & worker : this->workers) {
+				if (worker->thread.joinable()) {
+					worker->thread.join();
 				}
 			}
 		}
 
 		//----------
-		bool ThreadPool::performAsync(function<void()> function) {
-			if (this->actionQueue.size() >= this->maxQueueSize) {
-				return false;
+		ThreadPool & ThreadPool::X() {
+			static ThreadPool threadPool(max(std::thread::hardware_concurrency(), 1u), 4096);
+			return threadPool;
+		}
+
+		//----------
+		bool ThreadPool::performAsync(function<void()> function, Priority priority) {
+			// Reserve our slot in the queue, so that concurrent callers can't take us past maxQueueSize
+			{
+				auto queueSize = this->queueSize.load();
+				do {
+					if (queueSize >= this->maxQueueSize) {
+						this->droppedCount++;
+						return false;
+					}
+				} while (!this->queueSize.compare_exchange_weak(queueSize, queueSize + 1));
+			}
+
+			// Pick the queue
+			size_t workerIndex;
+			if (currentPool == this) {
+				workerIndex = currentWorkerIndex;
+			}
+			else {
+				workerIndex = this->nextWorker++ % this->workers.size();
 			}
 
-			this->actionQueue.send(move(function));
+			{
+				auto & worker = * this->workers[workerIndex];
+				unique_lock<mutex> lock(worker.lock);
+				worker.queues[(size_t) priority].push_back({
+					move(function)
+					, chrono::high_resolution_clock::now()
+				});
+			}
+
+			// Taking the lock here ensures a worker can't miss the notify between checking and sleeping
+			{
+				unique_lock<mutex> lock(this->sleepMutex);
+			}
+			this->sleepCondition.notify_one();
+
 			return true;
 		}
 
+		//----------
+		void ThreadPool::performBatch(const vector<function<void()>> & actions, Priority priority) {
+			if (actions.empty()) {
+				return;
+			}
+
+			// Helpers which start after the batch is finished find nothing to do and leave,
+			// so they only ever touch this shared state (never the caller's stack)
+			struct Batch {
+				const vector<function<void()>> * actions;
+				size_t count;
+				atomic<size_t> nextIndex{ 0 };
+
+				mutex lock;
+				condition_variable finished;
+				size_t completedCount = 0;
+				exception_ptr exception;
+			};
+			auto batch = make_shared<Batch>();
+			batch->actions = &actions;
+			batch->count = actions.size();
+
+			auto work = [batch]() {
+				while (true) {
+					const auto index = batch->nextIndex++;
+					if (index >= batch->count) {
+						return;
+					}
+
+					exception_ptr exception;
+					try {
+						(*batch->actions)[index]();
+					}
+					catch (...) {
+						exception = current_exception();
+					}
+
+					unique_lock<mutex> lock(batch->lock);
+					if (exception && !batch->exception) {
+						batch->exception = exception;
+					}
+					if (++batch->completedCount == batch->count) {
+						batch->finished.notify_all();
+					}
+				}
+			};
+
+			// If the queue is full we just do more of the work ourselves
+			const auto helperCount = min(batch->count - 1, this->workers.size());
+			for (size_t i = 0; i < helperCount; i++) {
+				if (!this->performAsync(work, priority)) {
+					break;
+				}
+			}
+
+			work();
+
+			unique_lock<mutex> lock(batch->lock);
+			batch->finished.wait(lock, [&batch]() {
+				return batch->completedCount == batch->count;
+			});
+			if (batch->exception) {
+				rethrow_exception(batch->exception);
+			}
+		}
+
+		//----------
+		size_t ThreadPool::getPoolSize() const {
+			return this->workers.size();
+		}
+
 		//----------
 		size_t ThreadPool::getQueueSize() const {
-			return this->actionQueue.size();
+			return this->queueSize.load();
+		}
+
+		//----------
+		ThreadPool::Statistics ThreadPool::getStatistics() const {
+			Statistics statistics;
+			statistics.poolSize = this->workers.size();
+			statistics.queueSize = this->queueSize.load();
+			statistics.activeWorkers = this->activeWorkers.load();
+			statistics.executed = this->executedCount.load();
+			statistics.steals = this->stealCount.load();
+			statistics.dropped = this->droppedCount.load();
+			statistics.waitTime = this->waitTime.load();
+			statistics.maxWaitTime = this->maxWaitTime.load();
+			return statistics;
+		}
+
+		//----------
+		void ThreadPool::workerLoop(size_t workerIndex) {
+			currentPool = this;
+			currentWorkerIndex = workerIndex;
+
+			Action action;
+			while (!this->joining) {
+				if (!this->tryTakeAction(workerIndex, action)) {
+					unique_lock<mutex> lock(this->sleepMutex);
+					this->sleepCondition.wait(lock, [this]() {
+						return this->joining.load() || this->queueSize.load() > 0;
+					});
+					continue;
+				}
+
+				// Record how long the action waited
+				{
+					chrono::duration<float, ratio<1, 1000>> waited = chrono::high_resolution_clock::now() - action.queueTime;
+					auto waitTime = waited.count();
+					this->waitTime.store(ofLerp(this->waitTime.load(), waitTime, 0.1f));
+					if (waitTime > this->maxWaitTime.load()) {
+						this->maxWaitTime.store(waitTime);
+					}
+				}
+
+				this->activeWorkers++;
+				try {
+					action.action();
+				}
+				RULR_CATCH_ALL_TO_ERROR;
+				this->activeWorkers--;
+				this->executedCount++;
+
+				// Release anything captured by the action before we sleep
+				action.action = nullptr;
+			}
+		}
+
+		//----------
+		bool ThreadPool::tryTakeAction(size_t workerIndex, Action & action) {
+			const auto workerCount = this->workers.size();
+
+			// Higher priorities are always served first, whether they are in our queue or another worker's
+			for (size_t priorityIndex = 0; priorityIndex < 3; priorityIndex++) {
+				// Our own queue (oldest first)
+				{
+					auto & worker = * this->workers[workerIndex];
+					unique_lock<mutex> lock(worker.lock);
+					auto & queue = worker.queues[priorityIndex];
+					if (!queue.empty()) {
+						action = move(queue.front());
+						queue.pop_front();
+						this->queueSize--;
+						return true;
+					}
+				}
+
+				// Steal from the back of other workers' queues
+				for (size_t offset = 1; offset < workerCount; offset++) {
+					auto & victim = * this->workers[(workerIndex + offset) % workerCount];
+					unique_lock<mutex> lock(victim.lock, try_to_lock);
+					if (!lock.owns_lock()) {
+						continue;
+					}
+					auto & queue = victim.queues[priorityIndex];
+					if (!queue.empty()) {
+						action = move(queue.back());
+						queue.pop_back();
+						this->queueSize--;
+						this->stealCount++;
+						return true;
+					}
+				}
+			}
+
+			return false;
 		}
 	}
-}
\ No newline at end of file
+}
@@ -1,53 +1,121 @@
 #pragma once
 
-#include "ofThreadChannel.h"
 #include "ofxRulr/Utils/Constants.h"
+#include "ofxRulr/Exception.h"
 #include <thread>
-#include <set>
+#include <deque>
 #include <future>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 using namespace std;
 
 namespace ofxRulr {
 	namespace Utils {
+		/// A pool of worker threads, each with its own queue of actions.
+		/// Idle workers steal from the back of other workers' queues, and
+		/// sleep on a condition variable when the whole pool is empty.
 		class ThreadPool {
 		public:
+			enum class Priority : uint8_t {
+				High = 0,
+				Normal,
+				Low
+			};
+
+			struct Statistics {
+				size_t poolSize = 0;
+				size_t queueSize = 0;
+				size_t activeWorkers = 0;
+				uint64_t executed = 0;
+				uint64_t steals = 0;
+				uint64_t dropped = 0;
+				float waitTime = 0.0f; ///< Smoothed time an action waits in the queue [ms]
+				float maxWaitTime = 0.0f; ///< Longest time any action waited in the queue [ms]
+			};
+
 			ThreadPool(size_t poolSize, size_t maxQueueSize);
 			virtual ~ThreadPool();
 
-			bool performAsync(function<void()>);
+			/// Shared pool with one worker per core. Use this for compute work (e.g. splitting an image into tiles)
+			/// rather than making a private pool, so that the total number of busy threads stays bounded.
+			/// Prefer performBatch here, since waiting on a future from inside one of its workers can deadlock.
+			static ThreadPool & X();
+
+			/// Returns false (and drops the action) if the queue is full
+			bool performAsync(function<void()>, Priority = Priority::Normal);
 
-			//consider using std::async(std::launch::async, ...) instead
+			/// The future carries either the result of the action or any exception that it threw
+			/// (including the case where the queue was full)
 			template<typename ReturnType>
-			future<exception_ptr> performAsyncWithExceptionHandling(function<void()>) {
-				promise<ReturnType> promise;
-				auto future = promise.get_future();
-				auto wrappedFunction = [function, &promise]() {
+			future<ReturnType> performAsyncWithExceptionHandling(function<ReturnType()> action, Priority priority = Priority::Normal) {
+				auto promise = make_shared<std::promise<ReturnType>>();
+				auto future = promise->get_future();
+				auto wrappedAction = [action, promise]() {
 					try {
-						promise.set_value(function());
+						ThreadPool::fulfil(*promise, action);
 					}
 					catch (...) {
-						promise.set_exception(std::current_exception());
+						promise->set_exception(std::current_exception());
 					}
 				};
-				if (!this->performAsync(function)) {
-					try {
-						throw(ofxRulr::Exception("Thread pool action queue is full"));
-					}
-					catch (...) {
-						promise.set_exception(std::current_exception());
-					}
+				if (!this->performAsync(wrappedAction, priority)) {
+					promise->set_exception(make_exception_ptr(ofxRulr::Exception("Thread pool action queue is full")));
 				}
 				return future;
 			}
 
+			/// Runs all the actions, on the pool's workers and on the calling thread, and returns when they
+			/// have all finished. Rethrows the first exception thrown by any action. The calling thread
+			/// keeps working through the batch itself, so this is safe to call from inside one of our
+			/// own workers (it never waits on a worker which might be waiting on it).
+			void performBatch(const vector<function<void()>> & actions, Priority = Priority::Normal);
+
+			size_t getPoolSize() const;
 			size_t getQueueSize() const;
+			Statistics getStatistics() const;
 		protected:
-			set<unique_ptr<thread>> threads;
-			ofThreadChannel<std::function<void()>> actionQueue;
+			struct Action {
+				function<void()> action;
+				chrono::high_resolution_clock::time_point queueTime;
+			};
+
+			struct Worker {
+				mutex lock;
+				deque<Action> queues[3]; // one per Priority
+				std::thread thread;
+			};
+
+			template<typename ReturnType>
+			static void fulfil(promise<ReturnType> & result, const function<ReturnType()> & action) {
+				result.set_value(action());
+			}
+
+			static void fulfil(promise<void> & result, const function<void()> & action) {
+				action();
+				result.set_value();
+			}
+
+			void workerLoop(size_t workerIndex);
+			bool tryTakeAction(size_t workerIndex, Action &);
+
+			vector<unique_ptr<Worker>> workers;
 			size_t maxQueueSize;
 
-			bool joining = false;
+			mutex sleepMutex;
+			condition_variable sleepCondition;
+
+			atomic<size_t> queueSize{ 0 };
+			atomic<size_t> nextWorker{ 0 };
+			atomic<size_t> activeWorkers{ 0 };
+			atomic<uint64_t> executedCount{ 0 };
+			atomic<uint64_t> stealCount{ 0 };
+			atomic<uint64_t> droppedCount{ 0 };
+			atomic<float> waitTime{ 0.0f };
+			atomic<float> maxWaitTime{ 0.0f };
+
+			atomic<bool> joining{ false };
 		};
 	}
-}
\ No newline at end of file
+}
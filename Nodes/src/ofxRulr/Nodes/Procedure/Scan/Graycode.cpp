@@ -115,6 +115,8 @@ namespace ofxRulr {
 						// Invalidate previews
 						if ((int) this->suite->decoder.getThreshold() != this->parameters.processing.threshold) {
 							this->suite->decoder.setThreshold((int) this->parameters.processing.threshold);
+							this->suite->cameraIndex.clear();
+							this->dataSetNeedsSave = true;
 							this->previewDirty = true;
 						}
 					}
@@ -128,34 +130,64 @@ namespace ofxRulr {
 				void Graycode::serialize(nlohmann::json & json) {
 					Utils::serialize(json, this->parameters);
 					
-					if (this->suite) {
+					if (this->shouldLoadWhenReady) {
+						//the DataSet was never loaded, so the file we loaded from is still current
+						json["hasData"] = true;
+						json["filename"] = this->deferredDataSetFilename;
+					}
+					else if (this->suite) {
 						json["hasData"] = true;
-
-						auto & jsonPayload = json["payload"];
-						jsonPayload["width"] = (int) this->suite->payload->getWidth();
-						jsonPayload["height"] = (int) this->suite->payload->getHeight();
 
 						auto filename = this->getDefaultFilename() + ".sl";
-						this->suite->decoder.saveDataSet(filename);
+						if (this->dataSetNeedsSave || !ofFile::doesFileExist(filename)) {
+							this->suite->decoder.saveDataSet(filename);
+							this->dataSetNeedsSave = false;
+						}
 						json["filename"] = filename;
 					}
 					else {
 						json["hasData"] = false;
 					}
+
+					if (json["hasData"].get<bool>()) {
+						auto dataSetInfo = this->getDataSetInfo();
+
+						auto & jsonPayload = json["payload"];
+						jsonPayload["width"] = (int) dataSetInfo.payloadWidth;
+						jsonPayload["height"] = (int) dataSetInfo.payloadHeight;
+
+						auto & jsonCamera = json["camera"];
+						jsonCamera["width"] = (int) dataSetInfo.cameraWidth;
+						jsonCamera["height"] = (int) dataSetInfo.cameraHeight;
+					}
 				}
 
 				//----------
 				void Graycode::deserialize(const nlohmann::json & json) {
 					Utils::deserialize(json, this->parameters);
 
-					//load dataset
+					//defer loading the dataset until something needs it (see loadDeferredDataSet)
+					this->shouldLoadWhenReady = false;
+					this->deferredDataSetFilename.clear();
+					this->deferredDataSetInfo = DataSetInfo();
+					this->deferredDataSetError.clear();
 					if(json.contains("hasData")) {
 						auto hasData = json["hasData"].get<bool>();
 						if (hasData) {
-							{
-								std::string filename;
-								if (Utils::deserialize(json, "filename", filename)) {
-									this->importDataSet(filename);
+							std::string filename;
+							if (Utils::deserialize(json, "filename", filename)) {
+								this->deferredDataSetFilename = filename;
+								this->shouldLoadWhenReady = true;
+
+								if (json.contains("payload")) {
+									const auto & jsonPayload = json["payload"];
+									this->deferredDataSetInfo.payloadWidth = jsonPayload.value("width", 0);
+									this->deferredDataSetInfo.payloadHeight = jsonPayload.value("height", 0);
+								}
+								if (json.contains("camera")) {
+									const auto & jsonCamera = json["camera"];
+									this->deferredDataSetInfo.cameraWidth = jsonCamera.value("width", 0);
+									this->deferredDataSetInfo.cameraHeight = jsonCamera.value("height", 0);
 								}
 							}
 						}
@@ -164,6 +196,7 @@ namespace ofxRulr {
 					//deal with parameters
 					if (this->suite) {
 						this->suite->decoder.setThreshold(this->parameters.processing.threshold);
+						this->suite->cameraIndex.clear();
 					}
 					
 					this->previewDirty = true;
@@ -194,12 +227,26 @@ namespace ofxRulr {
 
 					//rebuild suite
 					this->rebuildSuite();
+					this->shouldLoadWhenReady = false;
 
 					//clear the output
 					this->message.clear();
 
 					ofHideCursor();
 
+					ScanTimings timings;
+					typedef chrono::high_resolution_clock Clock;
+					typedef chrono::duration<float, ratio<1, 1000>> Milliseconds;
+					auto scanStart = Clock::now();
+
+					// When streaming, frames are decoded in order on a single worker whilst the next pattern is projected
+					unique_ptr<Utils::ThreadPool> decodeThread;
+					vector<future<void>> decodeFutures;
+					atomic<float> decodeTime{ 0.0f };
+					if (this->parameters.scan.streamingDecode) {
+						decodeThread = make_unique<Utils::ThreadPool>(1, this->suite->payload->getFrameCount() + 1);
+					}
+
 					try {
 						Utils::ScopedProcess scopedProcess("Scanning graycode", true, this->suite->payload->getFrameCount());
 
@@ -220,6 +267,7 @@ namespace ofxRulr {
 							 */
 							for (int i = 0; i < 2; i++) {
 #endif
+								auto projectStart = Clock::now();
 								for (int i = 0; i < this->parameters.scan.flushOutputFrames + 1; i++) {
 									videoOutput->clearFbo(false);
 									videoOutput->begin();
@@ -235,7 +283,9 @@ namespace ofxRulr {
 									videoOutput->end();
 									videoOutput->presentFbo();
 								}
+								timings.project += Milliseconds(Clock::now() - projectStart).count();
 
+								auto waitStart = Clock::now();
 								auto startWait = ofGetElapsedTimeMillis();
 								while (ofGetElapsedTimeMillis() - startWait < this->parameters.scan.captureDelay) {
 									ofSleepMillis(1);
@@ -245,33 +295,86 @@ namespace ofxRulr {
 								for (int i = 0; i < this->parameters.scan.flushInputFrames; i++) {
 									grabber->getFreshFrame();
 								}
+								timings.wait += Milliseconds(Clock::now() - waitStart).count();
 #ifdef TARGET_OSX
 							}
 #endif
+							auto captureStart = Clock::now();
 							auto frame = grabber->getFreshFrame();
 							if (!frame) {
 								throw(ofxRulr::Exception("Couldn't get fresh frame from camera"));
 							}
-							this->suite->decoder << frame->getPixels();
+							timings.capture += Milliseconds(Clock::now() - captureStart).count();
+
+							if (decodeThread) {
+								// The grabber only recycles a frame once nobody holds it, so the worker reads the
+								// frame's own pixels rather than us copying them here
+								decodeFutures.push_back(decodeThread->performAsyncWithExceptionHandling<void>([this, frame, &decodeTime]() {
+									auto decodeStart = Clock::now();
+									this->suite->decoder << frame->getPixels();
+									decodeTime.store(decodeTime.load() + Milliseconds(Clock::now() - decodeStart).count());
+								}));
+							}
+							else {
+								auto decodeStart = Clock::now();
+								this->suite->decoder << frame->getPixels();
+								decodeTime.store(decodeTime.load() + Milliseconds(Clock::now() - decodeStart).count());
+							}
+						}
+
+						// Wait for the remaining frames to be decoded
+						{
+							auto drainStart = Clock::now();
+							for (auto & decodeFuture : decodeFutures) {
+								decodeFuture.get();
+							}
+							decodeFutures.clear();
+							timings.drain = Milliseconds(Clock::now() - drainStart).count();
 						}
 						scopedProcess.end();
 					}
 					RULR_CATCH_ALL_TO_ALERT
 					catch (...) {
 					}
+
+					// Make sure the decoder is no longer in use (e.g. if we exited early)
+					for (auto & decodeFuture : decodeFutures) {
+						if (decodeFuture.valid()) {
+							decodeFuture.wait();
+						}
+					}
+					decodeThread.reset();
 					ofShowCursor();
 
+					timings.decode = decodeTime.load();
+					timings.total = Milliseconds(Clock::now() - scanStart).count();
+					this->lastScanTimings = timings;
+					ofLogNotice("Graycode") << "Scan timings [ms] : project " << timings.project
+						<< ", wait " << timings.wait
+						<< ", capture " << timings.capture
+						<< ", decode " << timings.decode
+						<< ", drain " << timings.drain
+						<< ", total " << timings.total;
+
+					this->suite->cameraIndex.clear();
+					this->dataSetNeedsSave = true;
 					this->previewDirty = true;
 				}
 				
 				//----------
 				void Graycode::clear() {
+					this->shouldLoadWhenReady = false;
+					this->deferredDataSetFilename.clear();
+					this->deferredDataSetError.clear();
 					this->invalidateSuite();
 				}
 
 				//----------
 				bool Graycode::hasData() const {
-					if (this->suite) {
+					if (this->shouldLoadWhenReady) {
+						return true;
+					}
+					else if (this->suite) {
 						return this->suite->decoder.hasData();
 					}
 					else {
@@ -279,6 +382,27 @@ namespace ofxRulr {
 					}
 				}
 
+				//----------
+				bool Graycode::isDataSetLoaded() const {
+					return !this->shouldLoadWhenReady && this->hasData();
+				}
+
+				//----------
+				Graycode::DataSetInfo Graycode::getDataSetInfo() const {
+					if (this->shouldLoadWhenReady) {
+						return this->deferredDataSetInfo;
+					}
+
+					DataSetInfo dataSetInfo;
+					if (this->suite) {
+						dataSetInfo.payloadWidth = this->suite->payload->getWidth();
+						dataSetInfo.payloadHeight = this->suite->payload->getHeight();
+						dataSetInfo.cameraWidth = (uint32_t) this->suite->decoder.getWidth();
+						dataSetInfo.cameraHeight = (uint32_t) this->suite->decoder.getHeight();
+					}
+					return dataSetInfo;
+				}
+
 				//----------
 				bool Graycode::hasScanSuite() const {
 					if (this->suite) {
@@ -290,7 +414,9 @@ namespace ofxRulr {
 				}
 
 				//----------
-				ofxGraycode::Decoder & Graycode::getDecoder() const {
+				ofxGraycode::Decoder & Graycode::getDecoder() {
+					this->loadDeferredDataSet();
+
 					if (this->suite) {
 						return this->suite->decoder;
 					}
@@ -300,7 +426,7 @@ namespace ofxRulr {
 				}
 
 				//----------
-				const ofxGraycode::DataSet & Graycode::getDataSet() const {
+				const ofxGraycode::DataSet & Graycode::getDataSet() {
 					//will throw if needs be
 					return this->getDecoder().getDataSet();
 				}
@@ -308,11 +434,31 @@ namespace ofxRulr {
 
 				//----------
 				void Graycode::setDataSet(const ofxGraycode::DataSet & dataSet) {
+					//no need to load the deferred DataSet since we're replacing it
+					this->shouldLoadWhenReady = false;
+
 					//will throw if needs be
 					this->getDecoder().setDataSet(dataSet);
+					this->suite->cameraIndex.clear();
+					this->dataSetNeedsSave = true;
 					this->previewDirty = true;
 				}
 
+				//----------
+				const Utils::GraycodeCameraIndex & Graycode::getCameraIndex() {
+					this->loadDeferredDataSet();
+
+					if (!this->suite) {
+						throw(ofxRulr::Exception("Decoder has not been allocated."));
+					}
+
+					auto & cameraIndex = this->suite->cameraIndex;
+					if (!cameraIndex.isBuilt()) {
+						cameraIndex.build(this->getDataSet());
+					}
+					return cameraIndex;
+				}
+
 				//----------
 				void Graycode::importDataSet(const string & filename) {
 					this->rebuildSuite();
@@ -322,11 +468,15 @@ namespace ofxRulr {
 					this->suite->encoder.init(suite->payload);
 					this->parameters.processing.threshold = this->suite->decoder.getThreshold();
 
+					this->shouldLoadWhenReady = false;
+					this->dataSetNeedsSave = true;
 					this->previewDirty = true;
 				}
 
 				//----------
 				void Graycode::exportDataSet(const string & filename) {
+					this->loadDeferredDataSet();
+
 					if (this->suite) {
 						this->suite->decoder.saveDataSet(filename);
 						this->suite->decoder.savePreviews();
@@ -336,6 +486,33 @@ namespace ofxRulr {
 					}
 				}
 
+				//----------
+				void Graycode::loadDeferredDataSet() {
+					if (!this->shouldLoadWhenReady) {
+						return;
+					}
+
+					if (!this->deferredDataSetError.empty()) {
+						throw(ofxRulr::Exception(this->deferredDataSetError));
+					}
+
+					auto filename = this->deferredDataSetFilename;
+
+					Utils::ScopedProcess scopedProcess("Loading graycode DataSet " + filename, false);
+					try {
+						this->importDataSet(filename);
+					}
+					RULR_CATCH_ALL_TO({
+						// Keep the filename (so that saving doesn't lose it), but don't try again until asked to
+						this->deferredDataSetError = "Couldn't load DataSet " + filename + " : " + e.what();
+						throw(ofxRulr::Exception(this->deferredDataSetError));
+					});
+
+					// Loaded from our own file, so nothing to save until the data changes
+					this->dataSetNeedsSave = filename != this->getDefaultFilename() + ".sl";
+					scopedProcess.end();
+				}
+
 				//----------
 				void Graycode::invalidateSuite() {
 					this->suite.reset();
@@ -386,7 +563,10 @@ namespace ofxRulr {
 							this->clear();
 						}));
 						inspector->add(new Widgets::Button("Export ofxGraycode::DataSet...", [this]() {
-							this->exportDataSet();
+							try {
+								this->exportDataSet();
+							}
+							RULR_CATCH_ALL_TO_ALERT;
 						}));
 						inspector->add(new Widgets::Button("Import ofxGraycode::DataSet...", [this]() {
 							try {
@@ -395,55 +575,79 @@ namespace ofxRulr {
 							RULR_CATCH_ALL_TO_ALERT;
 						}));
 						
+						inspector->add(new Widgets::Title("Last scan timings [ms]", Widgets::Title::Level::H3));
+						inspector->addLiveValue<float>("Project", [this]() {
+							return this->lastScanTimings.project;
+						});
+						inspector->addLiveValue<float>("Wait", [this]() {
+							return this->lastScanTimings.wait;
+						});
+						inspector->addLiveValue<float>("Capture", [this]() {
+							return this->lastScanTimings.capture;
+						});
+						inspector->addLiveValue<float>("Decode", [this]() {
+							return this->lastScanTimings.decode;
+						});
+						inspector->addLiveValue<float>("Drain", [this]() {
+							return this->lastScanTimings.drain;
+						});
+						inspector->addLiveValue<float>("Total", [this]() {
+							return this->lastScanTimings.total;
+						});
+
 						inspector->add(new Widgets::Title("Decoder", Widgets::Title::Level::H2));
 						inspector->add(new Widgets::LiveValue<string>("Has data", [this]() {
 							return this->hasData() ? "True" : "False";
 						}));
+						inspector->add(new Widgets::LiveValue<string>("Loaded", [this]() {
+							return this->isDataSetLoaded() ? "True" : "False";
+						}));
+						inspector->add(new Widgets::LiveValue<string>("Load error", [this]() {
+							return this->deferredDataSetError;
+						}));
+						{
+							auto button = inspector->addButton("Load DataSet now", [this]() {
+								try {
+									//try again even if it failed before
+									this->deferredDataSetError.clear();
+									this->loadDeferredDataSet();
+								}
+								RULR_CATCH_ALL_TO_ALERT;
+							});
+							button->onUpdate += [this, button](ofxCvGui::UpdateArguments &) {
+								button->setEnabled(this->shouldLoadWhenReady);
+							};
+						}
 					}
 
 					inspector->add(new Widgets::Title("Payload", Widgets::Title::Level::H2));
 					{
 						inspector->add(new Widgets::LiveValue<unsigned int>("Width", [this]() {
-							if (this->suite) {
-								return this->suite->payload->getWidth();
-							}
-							else {
-								return (uint32_t)0;
-							}
+							return this->getDataSetInfo().payloadWidth;
 						}));
 						inspector->add(new Widgets::LiveValue<unsigned int>("Height", [this]() {
-							if (this->suite) {
-								return this->suite->payload->getHeight();
-							}
-							else {
-								return (uint32_t)0;
-							}
+							return this->getDataSetInfo().payloadHeight;
 						}));
 					}
 
 					inspector->add(new Widgets::Title("Scan camera", Widgets::Title::Level::H2));
 					{
 						inspector->add(new Widgets::LiveValue<unsigned int>("Width", [this]() {
-							if (this->suite) {
-								return (uint32_t) this->suite->decoder.getWidth();
-							}
-							else {
-								return (uint32_t) 0;
-							}
+							return this->getDataSetInfo().cameraWidth;
 						}));
 						inspector->add(new Widgets::LiveValue<unsigned int>("Height", [this]() {
-							if (this->suite) {
-								return (uint32_t) this->suite->decoder.getHeight();
-							}
-							else {
-								return (uint32_t) 0;
-							}
+							return this->getDataSetInfo().cameraHeight;
 						}));
 					}
 				}
 				
 				//----------
 				void Graycode::updatePreview() {
+					//don't force a deferred DataSet to load just for the preview
+					if (this->shouldLoadWhenReady) {
+						return;
+					}
+
 					this->preview.clear();
 					
 					try {
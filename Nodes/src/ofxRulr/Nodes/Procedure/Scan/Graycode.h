@@ -5,6 +5,8 @@
 #include "ofxGraycode.h"
 #include "ofxCvGui/Panels/Image.h"
 #include "ofxRulr/Utils/VideoOutputListener.h"
+#include "ofxRulr/Utils/GraycodeCameraIndex.h"
+#include "ofxRulr/Utils/ThreadPool.h"
 
 namespace ofxRulr {
 	namespace Nodes {
@@ -24,6 +26,14 @@ namespace ofxRulr {
 						, (Balanced, Unbalanced)
 						, ("Balanced", "Unbalanced"));
 
+					///Dimensions of the DataSet, available without loading it
+					struct DataSetInfo {
+						uint32_t payloadWidth = 0;
+						uint32_t payloadHeight = 0;
+						uint32_t cameraWidth = 0;
+						uint32_t cameraHeight = 0;
+					};
+
 					Graycode();
 					void init();
 					string getTypeName() const override;
@@ -37,19 +47,39 @@ namespace ofxRulr {
 					void runScan();
 					void clear();
 					bool hasData() const;
+					bool isDataSetLoaded() const;
+					DataSetInfo getDataSetInfo() const;
 
 					bool hasScanSuite() const;
-					ofxGraycode::Decoder & getDecoder() const;
-					const ofxGraycode::DataSet & getDataSet() const;
+					ofxGraycode::Decoder & getDecoder();
+					const ofxGraycode::DataSet & getDataSet();
 					void setDataSet(const ofxGraycode::DataSet &);
 
+					///Camera-space index of the DataSet. Built on first use and invalidated whenever the DataSet changes
+					const Utils::GraycodeCameraIndex & getCameraIndex();
+
 					void importDataSet(const string & filename = "");
 					void exportDataSet(const string & filename = "");
+
+					///Load a DataSet which was deferred by deserialize. Called automatically when the data is first needed.
+					///If the load fails, the error is thrown again on later calls without retrying (see 'Load DataSet now')
+					void loadDeferredDataSet();
 				protected:
+					///Time spent in each stage of the last scan [ms]
+					struct ScanTimings {
+						float project = 0.0f;
+						float wait = 0.0f;
+						float capture = 0.0f;
+						float decode = 0.0f; // summed over frames (overlaps the other stages when streaming)
+						float drain = 0.0f; // waiting for the decode to finish after the last capture
+						float total = 0.0f;
+					};
+
 					struct Suite {
 						shared_ptr<ofxGraycode::Payload::Base> payload;
 						ofxGraycode::Encoder encoder;
 						ofxGraycode::Decoder decoder;
+						Utils::GraycodeCameraIndex cameraIndex;
 					};
 
 					void invalidateSuite();
@@ -73,8 +103,9 @@ namespace ofxRulr {
 							ofParameter<int> flushOutputFrames{ "Flush output frames", 2 };
 							ofParameter<int> flushInputFrames{ "Flush input frames", 0 };
 							ofParameter<float> brightness{ "Brightness [/255]", 255, 0, 255 };
+							ofParameter<bool> streamingDecode{ "Streaming decode", true };
 
-							PARAM_DECLARE("Scan", scanMode, captureDelay, flushOutputFrames, flushInputFrames, brightness);
+							PARAM_DECLARE("Scan", scanMode, captureDelay, flushOutputFrames, flushInputFrames, brightness, streamingDecode);
 						} scan;
 
 						struct : ofParameterGroup {
@@ -97,11 +128,21 @@ namespace ofxRulr {
 					ofTexture preview;
 					uint8_t testPatternBrightness = 0;
 					bool previewDirty = true;
+
+					// The DataSet file is only loaded when something needs its contents
 					bool shouldLoadWhenReady = false;
+					string deferredDataSetFilename;
+					DataSetInfo deferredDataSetInfo;
+					string deferredDataSetError; // set if the load failed, so that we don't retry every time the data is asked for
+
+					// Skip rewriting the (large) DataSet file on save if it hasn't changed
+					bool dataSetNeedsSave = false;
 
 					void callbackChangePreviewMode(PreviewMode &);
 
 					unique_ptr<Utils::VideoOutputListener> videoOutputListener;
+
+					ScanTimings lastScanTimings;
 				};
 			}
 		}
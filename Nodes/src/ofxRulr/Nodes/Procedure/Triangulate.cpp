@@ -5,6 +5,8 @@
 #include "../Item/Projector.h"
 #include "./Scan/Graycode.h"
 
+#include "ofxRulr/Utils/ThreadPool.h"
+
 #include "ofxTriangulate.h"
 #include "ofxCvGui.h"
 
@@ -37,6 +39,7 @@ namespace ofxRulr {
 				this->giveColor.set("Give color", true);
 				this->giveTexCoords.set("Give texture coordinates", true);
 				this->drawPointSize.set("Point size for draw", 1.0f, 1.0f, 10.0f);
+				this->useNative.set("Native parallel triangulation", true);
 			}
 
 			//----------
@@ -66,19 +69,205 @@ namespace ofxRulr {
 
 				Utils::ScopedProcess scopedProcess("Triangulating");
 
-				ofxTriangulate::Triangulate(dataSet
-					, camera->getViewInWorldSpace()
-					, projector->getViewInWorldSpace()
-					, this->mesh
-					, this->maxLength
-					, this->giveColor
-					, this->giveTexCoords);
+				auto start = chrono::high_resolution_clock::now();
+
+				if (this->useNative) {
+					this->triangulateNative(dataSet
+						, camera->getViewInWorldSpace()
+						, projector->getViewInWorldSpace());
+				}
+				else {
+					ofxTriangulate::Triangulate(dataSet
+						, camera->getViewInWorldSpace()
+						, projector->getViewInWorldSpace()
+						, this->mesh
+						, this->maxLength
+						, this->giveColor
+						, this->giveTexCoords);
+
+					this->lastTriangulation.rayCount = 0;
+					for (const auto & pixel : dataSet) {
+						if (pixel.active) {
+							this->lastTriangulation.rayCount++;
+						}
+					}
+				}
+
+				chrono::duration<float> duration = chrono::high_resolution_clock::now() - start;
+				this->lastTriangulation.duration = duration.count();
+				this->lastTriangulation.raysPerSecond = duration.count() > 0.0f
+					? (float) this->lastTriangulation.rayCount / duration.count()
+					: 0.0f;
 
 				if (this->mesh.getNumVertices() > 0) {
 					scopedProcess.end();
 				}
 			}
 
+			//----------
+			void Triangulate::triangulateNative(const ofxGraycode::DataSet & dataSet
+				, const ofxRay::Camera & cameraView
+				, const ofxRay::Camera & projectorView) {
+				const auto cameraWidth = (uint32_t) dataSet.getWidth();
+				const auto cameraHeight = (uint32_t) dataSet.getHeight();
+				const auto payloadWidth = (uint32_t) dataSet.getPayloadWidth();
+				const auto maxLength = this->maxLength.get();
+				const auto giveColor = this->giveColor.get();
+				const auto giveTexCoords = this->giveTexCoords.get();
+
+				const auto projectorIndices = dataSet.getData().getData(); // projector pixel index per camera pixel
+				const auto active = dataSet.getActive().getData();
+				const auto median = dataSet.getMedian().getData();
+
+				// Each tile is a band of camera rows with its own structure-of-arrays output
+				struct Tile {
+					uint32_t rowStart;
+					uint32_t rowEnd;
+					size_t rayCount = 0;
+					vector<glm::vec3> vertices;
+					vector<ofFloatColor> colors;
+					vector<glm::vec2> texCoords;
+				};
+
+				const uint32_t rowsPerTile = 16;
+				vector<Tile> tiles;
+				for (uint32_t rowStart = 0; rowStart < cameraHeight; rowStart += rowsPerTile) {
+					Tile tile;
+					tile.rowStart = rowStart;
+					tile.rowEnd = min(rowStart + rowsPerTile, cameraHeight);
+					tiles.push_back(move(tile));
+				}
+
+				auto triangulateTile = [&](Tile & tile) {
+					// Gather the active pixels of this tile
+					vector<glm::vec2> cameraPoints;
+					vector<glm::vec2> projectorPoints;
+					vector<uint8_t> brightness;
+					for (uint32_t y = tile.rowStart; y < tile.rowEnd; y++) {
+						auto cameraIndex = y * cameraWidth;
+						for (uint32_t x = 0; x < cameraWidth; x++, cameraIndex++) {
+							if (!active[cameraIndex]) {
+								continue;
+							}
+							const auto projectorIndex = projectorIndices[cameraIndex];
+							cameraPoints.emplace_back(x, y);
+							projectorPoints.emplace_back(projectorIndex % payloadWidth, projectorIndex / payloadWidth);
+							brightness.push_back(median[cameraIndex]);
+						}
+					}
+					tile.rayCount = cameraPoints.size();
+
+					// Cast the rays in batches (camera pixels are raw, projector pixels have no distortion)
+					vector<ofxRay::Ray> cameraRays;
+					vector<ofxRay::Ray> projectorRays;
+					cameraView.castPixels(cameraPoints, cameraRays, true);
+					projectorView.castPixels(projectorPoints, projectorRays, false);
+
+					tile.vertices.reserve(tile.rayCount);
+					if (giveColor) {
+						tile.colors.reserve(tile.rayCount);
+					}
+					if (giveTexCoords) {
+						tile.texCoords.reserve(tile.rayCount);
+					}
+
+					// Closest approach of each pair of rays
+					for (size_t i = 0; i < tile.rayCount; i++) {
+						const auto & s1 = cameraRays[i].s;
+						const auto & t1 = cameraRays[i].t;
+						const auto & s2 = projectorRays[i].s;
+						const auto & t2 = projectorRays[i].t;
+
+						const auto w0 = s1 - s2;
+						const auto a = glm::dot(t1, t1);
+						const auto b = glm::dot(t1, t2);
+						const auto c = glm::dot(t2, t2);
+						const auto d = glm::dot(t1, w0);
+						const auto e = glm::dot(t2, w0);
+						const auto denominator = a * c - b * b;
+						if (denominator <= std::numeric_limits<float>::epsilon() * a * c) {
+							continue; // parallel rays
+						}
+
+						const auto pointOnCameraRay = s1 + t1 * ((b * e - c * d) / denominator);
+						const auto pointOnProjectorRay = s2 + t2 * ((a * e - b * d) / denominator);
+						if (glm::distance(pointOnCameraRay, pointOnProjectorRay) > maxLength) {
+							continue;
+						}
+
+						tile.vertices.push_back((pointOnCameraRay + pointOnProjectorRay) * 0.5f);
+						if (giveColor) {
+							tile.colors.emplace_back((float) brightness[i] / 255.0f);
+						}
+						if (giveTexCoords) {
+							tile.texCoords.push_back(cameraPoints[i]);
+						}
+					}
+				};
+
+				// Process the tiles across all cores
+				{
+					auto threadCount = std::thread::hardware_concurrency();
+					Utils::ThreadPool threadPool(threadCount > 0 ? threadCount : 1, tiles.size() + 1);
+
+					vector<future<void>> futures;
+					for (auto & tile : tiles) {
+						futures.push_back(threadPool.performAsyncWithExceptionHandling<void>([&triangulateTile, &tile]() {
+							triangulateTile(tile);
+						}));
+					}
+
+					exception_ptr exception;
+					for (auto & future : futures) {
+						try {
+							future.get();
+						}
+						catch (...) {
+							exception = current_exception();
+						}
+					}
+					if (exception) {
+						rethrow_exception(exception);
+					}
+				}
+
+				// Concatenate the tiles into preallocated mesh buffers
+				size_t rayCount = 0;
+				size_t vertexCount = 0;
+				for (const auto & tile : tiles) {
+					rayCount += tile.rayCount;
+					vertexCount += tile.vertices.size();
+				}
+
+				this->mesh.clear();
+				this->mesh.setMode(OF_PRIMITIVE_POINTS);
+
+				auto & vertices = this->mesh.getVertices();
+				auto & colors = this->mesh.getColors();
+				auto & texCoords = this->mesh.getTexCoords();
+				vertices.resize(vertexCount);
+				if (giveColor) {
+					colors.resize(vertexCount);
+				}
+				if (giveTexCoords) {
+					texCoords.resize(vertexCount);
+				}
+
+				size_t offset = 0;
+				for (const auto & tile : tiles) {
+					copy(tile.vertices.begin(), tile.vertices.end(), vertices.begin() + offset);
+					if (giveColor) {
+						copy(tile.colors.begin(), tile.colors.end(), colors.begin() + offset);
+					}
+					if (giveTexCoords) {
+						copy(tile.texCoords.begin(), tile.texCoords.end(), texCoords.begin() + offset);
+					}
+					offset += tile.vertices.size();
+				}
+
+				this->lastTriangulation.rayCount = rayCount;
+			}
+
 			//----------
 			const ofMesh & Triangulate::getMesh() const {
 				return this->mesh;
@@ -102,10 +291,20 @@ namespace ofxRulr {
 				inspector->addLiveValue<size_t>("Point count", [this]() {
 					return this->mesh.getNumVertices();
 				});
+				inspector->addLiveValue<size_t>("Rays", [this]() {
+					return this->lastTriangulation.rayCount;
+				});
+				inspector->addLiveValue<float>("Duration [s]", [this]() {
+					return this->lastTriangulation.duration;
+				});
+				inspector->addLiveValue<float>("Rays per second", [this]() {
+					return this->lastTriangulation.raysPerSecond;
+				});
 
 				inspector->add(new Widgets::Slider(this->maxLength));
 				inspector->add(new Widgets::Toggle(this->giveColor));
 				inspector->add(new Widgets::Toggle(this->giveTexCoords));
+				inspector->add(new Widgets::Toggle(this->useNative));
 				inspector->add(new Widgets::Slider(this->drawPointSize));
 				inspector->add(new Widgets::Button("Save ofMesh...", [this]() {
 					auto result = ofSystemSaveDialog("mesh.ply", "Save mesh as PLY");
@@ -150,13 +349,13 @@ namespace ofxRulr {
 
 				auto camera = this->getInput<Item::Camera>();
 				if (camera) {
-					if (graycode && graycode->hasData()) {
+					if (graycode && graycode->isDataSetLoaded()) {
 						camera->getViewInWorldSpace().drawOnNearPlane(graycode->getDecoder().getProjectorInCamera());
 					}
 				}
 				auto projector = this->getInput<Item::Projector>();
 				if (projector) {
-					if (graycode && graycode->hasData()) {
+					if (graycode && graycode->isDataSetLoaded()) {
 						projector->getViewInWorldSpace().drawOnNearPlane(graycode->getDecoder().getCameraInProjector());
 					}
 				}
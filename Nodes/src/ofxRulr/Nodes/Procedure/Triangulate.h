@@ -5,6 +5,7 @@
 #include "ofxCvGui/Panels/World.h"
 
 #include "ofxRay.h"
+#include "ofxGraycode.h"
 
 namespace ofxRulr {
 	namespace Nodes {
@@ -25,12 +26,24 @@ namespace ofxRulr {
 				void populateInspector(ofxCvGui::InspectArguments &);
 				void drawWorldStage();
 
+				///Triangulate bands of camera rows across all cores, writing straight into the mesh buffers
+				void triangulateNative(const ofxGraycode::DataSet &
+					, const ofxRay::Camera & cameraView
+					, const ofxRay::Camera & projectorView);
+
 				ofMesh mesh;
 
 				ofParameter<float> maxLength;
 				ofParameter<bool> giveColor;
 				ofParameter<bool> giveTexCoords;
 				ofParameter<float> drawPointSize;
+				ofParameter<bool> useNative;
+
+				struct {
+					size_t rayCount = 0; // active camera pixels considered
+					float duration = 0.0f; // [s]
+					float raysPerSecond = 0.0f;
+				} lastTriangulation;
 			};
 		}
 	}
@@ -0,0 +1,103 @@
+#include "pch_RulrNodes.h"
+#include "GraycodeCameraIndex.h"
+
+namespace ofxRulr {
+	namespace Utils {
+		//----------
+		void GraycodeCameraIndex::build(const ofxGraycode::DataSet & dataSet, float cellSize) {
+			this->clear();
+
+			if (cellSize <= 0.0f) {
+				throw(ofxRulr::Exception("GraycodeCameraIndex cell size must be positive"));
+			}
+			this->cellSize = cellSize;
+
+			// Gather the entries (the same pixels a linear 'for (pixel : dataSet)' would visit)
+			vector<Entry> unsortedEntries;
+			glm::vec2 minimum(std::numeric_limits<float>::max());
+			glm::vec2 maximum(std::numeric_limits<float>::lowest());
+			for (const auto & pixel : dataSet) {
+				Entry entry{
+					pixel.getCameraXY()
+					, pixel.getProjectorXY()
+				};
+				minimum = glm::min(minimum, entry.cameraXY);
+				maximum = glm::max(maximum, entry.cameraXY);
+				unsortedEntries.push_back(entry);
+			}
+
+			if (unsortedEntries.empty()) {
+				this->built = true;
+				return;
+			}
+
+			this->origin = minimum;
+			this->columns = (int) ((maximum.x - minimum.x) / cellSize) + 1;
+			this->rows = (int) ((maximum.y - minimum.y) / cellSize) + 1;
+			const auto cellCount = (size_t) this->columns * (size_t) this->rows;
+
+			// Count the entries per cell
+			vector<uint32_t> cellIndices;
+			cellIndices.reserve(unsortedEntries.size());
+			this->cellStarts.assign(cellCount + 1, 0);
+			for (const auto & entry : unsortedEntries) {
+				const auto cell = this->getCell(entry.cameraXY);
+				const auto cellIndex = (uint32_t) (cell.y * this->columns + cell.x);
+				cellIndices.push_back(cellIndex);
+				this->cellStarts[cellIndex + 1]++;
+			}
+
+			// Prefix sum into offsets
+			for (size_t i = 0; i < cellCount; i++) {
+				this->cellStarts[i + 1] += this->cellStarts[i];
+			}
+
+			// Scatter the entries into their cells
+			this->entries.resize(unsortedEntries.size());
+			{
+				auto cursors = this->cellStarts;
+				for (size_t i = 0; i < unsortedEntries.size(); i++) {
+					this->entries[cursors[cellIndices[i]]++] = unsortedEntries[i];
+				}
+			}
+
+			this->built = true;
+		}
+
+		//----------
+		void GraycodeCameraIndex::clear() {
+			this->entries.clear();
+			this->cellStarts.clear();
+			this->columns = 0;
+			this->rows = 0;
+			this->built = false;
+		}
+
+		//----------
+		bool GraycodeCameraIndex::isBuilt() const {
+			return this->built;
+		}
+
+		//----------
+		size_t GraycodeCameraIndex::size() const {
+			return this->entries.size();
+		}
+
+		//----------
+		void GraycodeCameraIndex::findWithinRadius(const glm::vec2 & cameraXY
+			, float radius
+			, vector<cv::Point2f> & cameraSpace
+			, vector<cv::Point2f> & projectorSpace) const {
+			this->forEachWithinRadius(cameraXY, radius, [&](const Entry & entry) {
+				cameraSpace.emplace_back(entry.cameraXY.x, entry.cameraXY.y);
+				projectorSpace.emplace_back(entry.projectorXY.x, entry.projectorXY.y);
+			});
+		}
+
+		//----------
+		glm::ivec2 GraycodeCameraIndex::getCell(const glm::vec2 & cameraXY) const {
+			auto cell = glm::ivec2(glm::floor((cameraXY - this->origin) / this->cellSize));
+			return glm::clamp(cell, glm::ivec2(0, 0), glm::ivec2(this->columns - 1, this->rows - 1));
+		}
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "ofxGraycode.h"
+#include "ofxRulr/Utils/Constants.h"
+
+namespace ofxRulr {
+	namespace Utils {
+		/// A uniform grid over the camera-space positions of a decoded ofxGraycode::DataSet,
+		/// for finding the graycode pixels near a camera image point without scanning the whole set.
+		/// Entries are stored contiguously per cell (counting sort), so a query touches only the cells
+		/// which overlap its search radius.
+		class GraycodeCameraIndex {
+		public:
+			struct Entry {
+				glm::vec2 cameraXY;
+				glm::vec2 projectorXY;
+			};
+
+			void build(const ofxGraycode::DataSet &, float cellSize = 8.0f);
+			void clear();
+			bool isBuilt() const;
+			size_t size() const;
+
+			/// Calls action(const Entry &) for every entry strictly within radius of cameraXY
+			template<typename Action>
+			void forEachWithinRadius(const glm::vec2 & cameraXY, float radius, Action && action) const {
+				if (this->entries.empty()) {
+					return;
+				}
+
+				const auto radiusSquared = radius * radius;
+
+				const auto minCell = this->getCell(cameraXY - glm::vec2(radius, radius));
+				const auto maxCell = this->getCell(cameraXY + glm::vec2(radius, radius));
+
+				for (int j = minCell.y; j <= maxCell.y; j++) {
+					for (int i = minCell.x; i <= maxCell.x; i++) {
+						const auto cellIndex = j * this->columns + i;
+						const auto end = this->entries.data() + this->cellStarts[cellIndex + 1];
+						for (auto entry = this->entries.data() + this->cellStarts[cellIndex]; entry != end; entry++) {
+							const auto delta = entry->cameraXY - cameraXY;
+							if (delta.x * delta.x + delta.y * delta.y < radiusSquared) {
+								action(*entry);
+							}
+						}
+					}
+				}
+			}
+
+			/// Fills the camera and projector coordinates of all entries within radius of cameraXY
+			void findWithinRadius(const glm::vec2 & cameraXY
+				, float radius
+				, vector<cv::Point2f> & cameraSpace
+				, vector<cv::Point2f> & projectorSpace) const;
+		protected:
+			glm::ivec2 getCell(const glm::vec2 & cameraXY) const;
+
+			float cellSize = 8.0f;
+			glm::vec2 origin;
+			int columns = 0;
+			int rows = 0;
+
+			vector<Entry> entries; // sorted by cell
+			vector<uint32_t> cellStarts; // columns * rows + 1 offsets into entries
+			bool built = false;
+		};
+	}
+}
@@ -3,15 +3,17 @@
 #include "Detector.h"
 #include "ofxRulr/Nodes/GraphicsManager.h"
 
-struct MarkerDetectorClone {
-	aruco::MarkerDetector markerDetector;
-	aruco::Dictionary dictionary;
-	aruco::Dictionary::DICT_TYPES dictionaryType;
-};
-
 namespace ofxRulr {
 	namespace Nodes {
 		namespace ArUco {
+			//----------
+			struct Detector::DetectorClone {
+				aruco::MarkerDetector markerDetector;
+				aruco::Dictionary dictionary;
+				aruco::Dictionary::DICT_TYPES dictionaryType;
+				size_t parametersHash = 0;
+			};
+
 			//----------
 			Detector::Detector() {
 				RULR_NODE_INIT_LISTENER;
@@ -119,6 +121,12 @@ namespace ofxRulr {
 					this->findMarkers(this->lastDetection.rawImage, false);
 					cout << this->foundMarkers.size() << " markers found." << endl;
 				}, ' ');
+				inspector->addButton("Benchmark strategies", [this]() {
+					try {
+						this->benchmarkStrategies();
+					}
+					RULR_CATCH_ALL_TO_ALERT;
+				});
 			}
 
 			//----------
@@ -168,21 +176,49 @@ namespace ofxRulr {
 			}
 
 			//----------
-			std::vector<aruco::Marker>Detector::findMarkers(const cv::Mat & image, bool fromAnotherThread) {
+			std::vector<aruco::Marker>Detector::findMarkers(const cv::Mat & image, bool fromAnotherThread, bool singleThreaded) {
 				Frame frame;
 
 				if (image.empty()) {
 					throw(ofxRulr::Exception("Can't find markers in empty image"));
 				}
 
-				frame.rawImage = image.clone();
-
-				if (frame.rawImage.channels() == 3) {
-					cv::cvtColor(frame.rawImage
+				if (image.channels() == 3) {
+					cv::cvtColor(image
 						, frame.rawImage
 						, cv::COLOR_RGB2GRAY);
 				}
+				else {
+					// We only read from the image, so no need to copy it unless we keep it (below)
+					frame.rawImage = image;
+				}
+
+				auto strategies = this->getStrategies();
+				strategies.singleThreaded = singleThreaded;
+				auto foundMarkers = this->findMarkers(frame, strategies);
 
+				//speak the count
+				if (this->parameters.debug.speakCount && !fromAnotherThread) {
+					ofxRulr::Utils::speakCount(foundMarkers.size());
+				}
+
+				// Store if on main thread and build preview
+				if(!fromAnotherThread) {
+					if (frame.rawImage.data == image.data) {
+						frame.rawImage = frame.rawImage.clone();
+					}
+					this->lastDetection = frame;
+					this->foundMarkers = foundMarkers;
+					this->cachedPreviewType = Preview::None;
+					this->preview.clear();
+					return foundMarkers;
+				}
+				
+				return foundMarkers;
+			}
+
+			//----------
+			std::vector<aruco::Marker> Detector::findMarkers(Frame & frame, const Strategies & strategySettings) {
 				// Merge function
 				vector<aruco::Marker> foundMarkers;
 
@@ -207,37 +243,33 @@ namespace ofxRulr {
 					lockFoundMarkers.unlock();
 				};
 
-				// Detector clone function
-				auto getDetecterClone = [&]() {
-					auto markerDetectorClone = make_shared<MarkerDetectorClone>();
-					stringstream ss;
-
-					this->markerDetector.toStream(ss);
-					markerDetectorClone->markerDetector.fromStream(ss);
-					this->buildDetector(markerDetectorClone->markerDetector
-						, markerDetectorClone->dictionary
-						, markerDetectorClone->dictionaryType);
-
-					return markerDetectorClone;
+				// Detect using a clone from the pool (or coarse to fine through a pyramid)
+				auto detect = [this, &strategySettings](const cv::Mat & image) {
+					if (strategySettings.pyramid) {
+						return this->findMarkersPyramid(image, strategySettings);
+					}
+					auto detectorClone = this->acquireDetectorClone();
+					auto markers = detectorClone->markerDetector.detect(image);
+					this->releaseDetectorClone(move(detectorClone));
+					return markers;
 				};
 
-				// Add strategy
-				vector<future<void>> strategies;
+				// Strategies are collected here then run together on the thread pool
+				vector<function<void()>> strategies;
 				auto addStrategy = [&](const function<void()>& strategy) {
-					strategies.push_back(async(launch::async, strategy));
+					strategies.push_back(strategy);
 				};
 
 				// Strategies
 				{
 					// Direct find
 					addStrategy([&]() {
-						auto detectorClone = getDetecterClone();
-						auto directMarkersFound = detectorClone->markerDetector.detect(frame.rawImage);
+						auto directMarkersFound = detect(frame.rawImage);
 						mergeResults(directMarkersFound);
 						});
 
 					// Normalize
-					if (this->parameters.strategies.normalize.enabled.get()) {
+					if (strategySettings.normalize) {
 						frame.rawImage.convertTo(frame.normalisedImage, CV_32F);
 
 						// Push values up so that mid value is middle of range 0-255
@@ -258,8 +290,7 @@ namespace ofxRulr {
 							, cv::NormTypes::NORM_MINMAX);
 
 						addStrategy([&]() {
-							auto markerDetectorClone = getDetecterClone();
-							auto newMarkersFound = markerDetectorClone->markerDetector.detect(frame.normalisedImage);
+							auto newMarkersFound = detect(frame.normalisedImage);
 							mergeResults(newMarkersFound);
 						});
 					}
@@ -267,15 +298,14 @@ namespace ofxRulr {
 						frame.normalisedImage = frame.rawImage;
 					}
 
-					// Multi-crop
-					if (this->parameters.strategies.multiCrop.enabled.get()) {
-						auto imageWidth = image.cols;
-						auto imageHeight = image.rows;
-
-						map<int, aruco::Marker> markersInAllCrops;
+					// Multi-crop. aruco's minimum marker size is relative to the image, so small markers may only be
+					// found in a crop. With the pyramid enabled, each crop is searched through its own pyramid
+					if (strategySettings.multiCrop) {
+						auto imageWidth = frame.rawImage.cols;
+						auto imageHeight = frame.rawImage.rows;
 
-						auto iterations = this->parameters.strategies.multiCrop.iterations.get();
-						auto overlap = this->parameters.strategies.multiCrop.overlap.get();
+						auto iterations = strategySettings.multiCropIterations;
+						auto overlap = strategySettings.multiCropOverlap;
 
 						for (int cropIteration = 0; cropIteration < iterations; cropIteration++) {
 							auto stepRatio = 1.0f / pow(2, cropIteration);
@@ -307,14 +337,12 @@ namespace ofxRulr {
 									}
 
 									// Perform the find
-									addStrategy([=]() {
-										auto markerDetectorClone = getDetecterClone();
-
+									addStrategy([&, x_clamped, y_clamped, width_clamped, height_clamped]() {
 										cv::Rect roi(x_clamped, y_clamped, width_clamped, height_clamped);
-										cv::Mat cropped = image(roi);
+										cv::Mat cropped = frame.rawImage(roi);
 
 										//perform detection
-										auto markersInCrop = markerDetectorClone->markerDetector.detect(cropped);
+										auto markersInCrop = detect(cropped);
 
 										//translate into original image coords
 										for (auto& markerInCrop : markersInCrop) {
@@ -332,26 +360,22 @@ namespace ofxRulr {
 					}
 
 					// Multi-brightess
-					if (this->parameters.strategies.multiBrightness.enabled.get()) {
-						for (int i = 2; i < this->parameters.strategies.multiBrightness.maxBrightess.get(); i++) {
-							addStrategy([&]() {
+					if (strategySettings.multiBrightness) {
+						for (int i = 2; i < strategySettings.maxBrightness; i++) {
+							addStrategy([&, i]() {
 								cv::Mat brighterImage;
 								frame.rawImage.convertTo(brighterImage
 									, CV_8U
 									, i
 									, 0);
-								auto markerDetectorClone = getDetecterClone();
-								auto markersFoundInBrightenedImage = markerDetectorClone->markerDetector.detect(brighterImage);
+								auto markersFoundInBrightenedImage = detect(brighterImage);
 								mergeResults(markersFoundInBrightenedImage);
 							});
 						}
 					}
 				}
 
-
-				for (auto& future : strategies) {
-					future.wait();
-				}
+				Detector::performActions(strategies, strategySettings);
 
 				// refine corners 1
 				{
@@ -403,21 +427,242 @@ namespace ofxRulr {
 					}
 				}
 
-				//speak the count
-				if (this->parameters.debug.speakCount && !fromAnotherThread) {
-					ofxRulr::Utils::speakCount(foundMarkers.size());
+				return foundMarkers;
+			}
+
+			//----------
+			std::vector<aruco::Marker> Detector::findMarkersPyramid(const cv::Mat & image, const Strategies & strategySettings) {
+				auto detect = [this](const cv::Mat & image) {
+					auto detectorClone = this->acquireDetectorClone();
+					auto markers = detectorClone->markerDetector.detect(image);
+					this->releaseDetectorClone(move(detectorClone));
+					return markers;
+				};
+
+				// Build the pyramid (level n is 1/2^n size)
+				const auto levelCount = max(strategySettings.pyramidLevels, 1);
+				const auto finestLevel = (int) ofClamp(strategySettings.pyramidFinestLevel, 0, levelCount);
+				vector<cv::Mat> levels(levelCount + 1);
+				levels[0] = image;
+				for (int level = 1; level <= levelCount; level++) {
+					cv::resize(levels[level - 1]
+						, levels[level]
+						, cv::Size(levels[level - 1].cols / 2, levels[level - 1].rows / 2)
+						, 0
+						, 0
+						, cv::INTER_AREA);
 				}
 
-				// Store if on main thread and build preview
-				if(!fromAnotherThread) {
-					this->lastDetection = frame;
-					this->foundMarkers = foundMarkers;
-					this->cachedPreviewType = Preview::None;
-					this->preview.clear();
-					return foundMarkers;
+				// Coarse detection on each level
+				vector<vector<aruco::Marker>> markersInLevels(levelCount + 1);
+				{
+					vector<function<void()>> actions;
+					for (int level = finestLevel; level <= levelCount; level++) {
+						if (levels[level].empty()) {
+							continue;
+						}
+						actions.push_back([&, level]() {
+							markersInLevels[level] = detect(levels[level]);
+						});
+					}
+					Detector::performActions(actions, strategySettings);
+				}
+
+				// Candidates in full resolution coordinates (with the level they came from). Where a marker is seen
+				// in several levels, take the finest
+				map<int, pair<int, aruco::Marker>> candidates;
+				for (int level = levelCount; level >= finestLevel; level--) {
+					const auto scale = (float) (1 << level);
+					for (auto marker : markersInLevels[level]) {
+						for (auto & point : marker) {
+							point = (point + cv::Point2f(0.5f, 0.5f)) * scale - cv::Point2f(0.5f, 0.5f);
+						}
+						candidates[marker.id] = make_pair(level, marker);
+					}
+				}
+
+				// Detect again at full resolution, but only in the region around each candidate
+				vector<aruco::Marker> markers(candidates.size());
+				{
+					const auto imageBounds = cv::Rect(0, 0, image.cols, image.rows);
+					vector<function<void()>> actions;
+					size_t index = 0;
+					for (const auto & candidate : candidates) {
+						actions.push_back([&, index]() {
+							const auto & candidateMarker = candidate.second.second;
+
+							// Found at full resolution already
+							if (candidate.second.first == 0) {
+								markers[index] = candidateMarker;
+								return;
+							}
+
+							auto region = cv::boundingRect((const vector<cv::Point2f> &) candidateMarker);
+							const auto margin = (int) (max(region.width, region.height) * strategySettings.pyramidRegionMargin) + 2;
+							region.x -= margin;
+							region.y -= margin;
+							region.width += margin * 2;
+							region.height += margin * 2;
+							region &= imageBounds;
+
+							// Fall back to the candidate (the corner refinement will still sharpen it)
+							markers[index] = candidateMarker;
+
+							if (region.area() == 0) {
+								return;
+							}
+							auto markersInRegion = detect(image(region));
+							for (auto & markerInRegion : markersInRegion) {
+								if (markerInRegion.id == candidateMarker.id) {
+									for (auto & point : markerInRegion) {
+										point.x += region.x;
+										point.y += region.y;
+									}
+									markers[index] = markerInRegion;
+									break;
+								}
+							}
+						});
+						index++;
+					}
+					Detector::performActions(actions, strategySettings);
+				}
+
+				return markers;
+			}
+
+			//----------
+			void Detector::performActions(vector<function<void()>> & actions, const Strategies & strategySettings) {
+				if (strategySettings.singleThreaded) {
+					for (auto & action : actions) {
+						action();
+					}
+				}
+				else {
+					Utils::ThreadPool::X().performBatch(actions);
+				}
+			}
+
+			//----------
+			Detector::Strategies Detector::getStrategies() const {
+				const auto & strategies = this->parameters.strategies;
+
+				Strategies strategySettings;
+				strategySettings.normalize = strategies.normalize.enabled.get();
+				strategySettings.multiCrop = strategies.multiCrop.enabled.get();
+				strategySettings.multiCropIterations = strategies.multiCrop.iterations.get();
+				strategySettings.multiCropOverlap = strategies.multiCrop.overlap.get();
+				strategySettings.multiBrightness = strategies.multiBrightness.enabled.get();
+				strategySettings.maxBrightness = strategies.multiBrightness.maxBrightess.get();
+				strategySettings.pyramid = strategies.pyramid.enabled.get();
+				strategySettings.pyramidLevels = strategies.pyramid.levels.get();
+				strategySettings.pyramidFinestLevel = strategies.pyramid.finestLevel.get();
+				strategySettings.pyramidRegionMargin = strategies.pyramid.regionMargin.get();
+				return strategySettings;
+			}
+
+			//----------
+			void Detector::benchmarkStrategies() {
+				if (this->lastDetection.rawImage.empty()) {
+					throw(ofxRulr::Exception("No image to benchmark with. Detect markers in an image first"));
+				}
+
+				const int repeats = 5;
+				const auto baseStrategies = this->getStrategies();
+
+				stringstream report;
+				report << "Normalize\tMulti crop\tMulti brightness\tPyramid\tTime [ms]\tMarkers" << endl;
+
+				Utils::ScopedProcess scopedProcess("Benchmark strategies", false, 16);
+				for (int combination = 0; combination < 16; combination++) {
+					Utils::ScopedProcess combinationProcess("Combination " + ofToString(combination), false);
+
+					auto strategies = baseStrategies;
+					strategies.normalize = combination & 1;
+					strategies.multiCrop = combination & 2;
+					strategies.multiBrightness = combination & 4;
+					strategies.pyramid = combination & 8;
+
+					size_t markerCount = 0;
+					auto startTime = chrono::high_resolution_clock::now();
+					for (int i = 0; i < repeats; i++) {
+						Frame frame;
+						frame.rawImage = this->lastDetection.rawImage;
+						markerCount = this->findMarkers(frame, strategies).size();
+					}
+					chrono::duration<float, milli> duration = chrono::high_resolution_clock::now() - startTime;
+
+					report << strategies.normalize
+						<< "\t" << strategies.multiCrop
+						<< "\t" << strategies.multiBrightness
+						<< "\t" << strategies.pyramid
+						<< "\t" << duration.count() / (float) repeats
+						<< "\t" << markerCount << endl;
+				}
+
+				ofLogNotice("ArUco::Detector") << "Detection time per image (" << this->lastDetection.rawImage.cols << "x" << this->lastDetection.rawImage.rows
+					<< ", " << Utils::ThreadPool::X().getPoolSize() << " threads)" << endl
+					<< report.str();
+			}
+
+			//----------
+			size_t Detector::getDetectorParametersHash() const {
+				const auto & arucoDetector = this->parameters.arucoDetector;
+
+				size_t hash = 0;
+				auto combine = [&hash](size_t value) {
+					hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+				};
+				combine((size_t) this->parameters.dictionary.get().get());
+				combine(std::hash<bool>()(arucoDetector.enclosedMarkers.get()));
+				combine(std::hash<int>()(arucoDetector.thresholdAttempts.get()));
+				combine(std::hash<int>()(arucoDetector.adaptiveThreshold.windowSize.get()));
+				combine(std::hash<int>()(arucoDetector.adaptiveThreshold.windowSizeRange.get()));
+				combine(std::hash<int>()(arucoDetector.threshold.get()));
+				return hash;
+			}
+
+			//----------
+			shared_ptr<Detector::DetectorClone> Detector::acquireDetectorClone() {
+				const auto hash = this->getDetectorParametersHash();
+				{
+					unique_lock<mutex> lock(this->detectorClonesMutex);
+					if (hash != this->detectorClonesHash) {
+						// Parameters changed, so the clones are stale
+						this->detectorClones.clear();
+						this->detectorClonesHash = hash;
+					}
+					if (!this->detectorClones.empty()) {
+						auto detectorClone = move(this->detectorClones.back());
+						this->detectorClones.pop_back();
+						return detectorClone;
+					}
+				}
+
+				// Build outside the lock. Building from the parameters directly rather than copying
+				// this->markerDetector means we don't race with the main thread rebuilding it
+				auto detectorClone = make_shared<DetectorClone>();
+				this->buildDetector(detectorClone->markerDetector
+					, detectorClone->dictionary
+					, detectorClone->dictionaryType);
+
+				// The clones already run in parallel on the shared pool, so aruco mustn't start threads of its own
+				detectorClone->markerDetector.getParameters().maxThreads = 1;
+				detectorClone->parametersHash = hash;
+				return detectorClone;
+			}
+
+			//----------
+			void Detector::releaseDetectorClone(shared_ptr<DetectorClone> && detectorClone) {
+				unique_lock<mutex> lock(this->detectorClonesMutex);
+				if (detectorClone->parametersHash != this->detectorClonesHash) {
+					return;
+				}
+
+				// Enough for every worker plus a few callers
+				if (this->detectorClones.size() < Utils::ThreadPool::X().getPoolSize() * 2) {
+					this->detectorClones.push_back(move(detectorClone));
 				}
-				
-				return foundMarkers;
 			}
 
 			//----------
@@ -448,8 +693,8 @@ namespace ofxRulr {
 					break;
 				}
 
-				dictionary = aruco::Dictionary::loadPredefined(this->dictionaryType);
-				markerDetector.setDictionary(this->dictionaryType);
+				dictionary = aruco::Dictionary::loadPredefined(dictionaryType);
+				markerDetector.setDictionary(dictionaryType);
 
 				auto& parameters = markerDetector.getParameters();
 				parameters.maxThreads = this->parameters.arucoDetector.threads.get();
@@ -3,6 +3,7 @@
 #include "Constants_Plugin_ArUco.h"
 #include "ofxRulr/Nodes/Base.h"
 #include "ofxRulr/Nodes/Item/Camera.h"
+#include "ofxRulr/Utils/ThreadPool.h"
 #include <aruco/aruco.h>
 
 #define ARUCO_PREVIEW_RESOLUTION 64
@@ -12,6 +13,20 @@ namespace ofxRulr {
 		namespace ArUco {
 			class PLUGIN_ARUCO_EXPORTS Detector : public Nodes::Base {
 			public:
+				struct Strategies {
+					bool normalize = true;
+					bool multiCrop = true;
+					int multiCropIterations = 4;
+					float multiCropOverlap = 0.5f;
+					bool multiBrightness = true;
+					int maxBrightness = 4;
+					bool pyramid = false;
+					int pyramidLevels = 3;
+					int pyramidFinestLevel = 1;
+					float pyramidRegionMargin = 0.5f;
+					bool singleThreaded = false; ///< Run everything on the calling thread rather than the thread pool
+				};
+
 				Detector();
 				string getTypeName() const override;
 				void init();
@@ -29,7 +44,8 @@ namespace ofxRulr {
 
 				ofxCvGui::PanelPtr getPanel() override;
 				
-				vector<aruco::Marker> findMarkers(const cv::Mat & image, bool fromAnotherThread);
+				/// Use singleThreaded when the caller is already one of many workers (e.g. importing a folder of images)
+				vector<aruco::Marker> findMarkers(const cv::Mat & image, bool fromAnotherThread, bool singleThreaded = false);
 			protected:
 				MAKE_ENUM(DetectorType
 					, (Original, MIP_3612h, ARTKP, ARTAG)
@@ -39,9 +55,29 @@ namespace ofxRulr {
 					, (Raw, Normalised, Thresholded, None)
 					, ("Raw", "Normalised", "Thresholded", "None"));
 
+				//useful when debugging to research quickly
+				struct Frame {
+					cv::Mat thresholded;
+					cv::Mat normalisedImage;
+					cv::Mat rawImage;
+				};
+
+				// A detector built with the current parameters, for use by one strategy at a time
+				struct DetectorClone;
+
 				void rebuildDetector();
 				void buildDetector(aruco::MarkerDetector&, aruco::Dictionary&, aruco::Dictionary::DICT_TYPES&) const;
 
+				Strategies getStrategies() const;
+				vector<aruco::Marker> findMarkers(Frame &, const Strategies &);
+				vector<aruco::Marker> findMarkersPyramid(const cv::Mat & image, const Strategies &);
+				void benchmarkStrategies();
+				static void performActions(vector<function<void()>> &, const Strategies &);
+
+				size_t getDetectorParametersHash() const;
+				shared_ptr<DetectorClone> acquireDetectorClone();
+				void releaseDetectorClone(shared_ptr<DetectorClone> &&);
+
 				void changeDetectorCallback(DetectorType &);
 				void changeFloatCallback(float &);
 				void changeIntCallback(int&);
@@ -52,7 +88,7 @@ namespace ofxRulr {
 					ofParameter<float> markerLength{ "Marker length [m]", 0.05, 0.001, 10 };
 
 					struct : ofParameterGroup {
-						ofParameter<int> threads{ "Threads", 8};
+						ofParameter<int> threads{ "Threads", 8}; ///< Only for getMarkerDetector(), findMarkers runs single threaded detectors on the thread pool
 						ofParameter<bool> enclosedMarkers{ "Enclosed markers", false };
 						ofParameter<int> thresholdAttempts{ "Threshold attempts", 3, 1, 10 };
 						struct : ofParameterGroup {
@@ -89,7 +125,18 @@ namespace ofxRulr {
 							PARAM_DECLARE("Multi brightness", enabled, maxBrightess);
 						} multiBrightness;
 
-						PARAM_DECLARE("Strategies", normalize, multiCrop, multiBrightness)
+						// Detect on downscaled copies of the image, then only look at the regions around
+						// what was found at full resolution (used by the direct find and within each multi crop).
+						// Finest search level 0 also searches the full resolution image
+						struct : ofParameterGroup {
+							ofParameter<bool> enabled{ "Enabled", false };
+							ofParameter<int> levels{ "Levels", 3, 1, 6 };
+							ofParameter<int> finestLevel{ "Finest search level", 1, 0, 6 };
+							ofParameter<float> regionMargin{ "Region margin [x marker size]", 0.5, 0, 2 };
+							PARAM_DECLARE("Pyramid", enabled, levels, finestLevel, regionMargin);
+						} pyramid;
+
+						PARAM_DECLARE("Strategies", normalize, multiCrop, multiBrightness, pyramid)
 					} strategies;
 					
 
@@ -122,12 +169,13 @@ namespace ofxRulr {
 
 				map<int, shared_ptr<ofImage>> cachedMarkerImages;
 
-				//useful when debugging to research quickly
-				struct Frame {
-					cv::Mat thresholded;
-					cv::Mat normalisedImage;
-					cv::Mat rawImage;
-				} lastDetection;
+				Frame lastDetection;
+
+				// Strategies run on the shared thread pool, each with a detector from the clone pool. The clones
+				// are kept between calls and thrown away when the detector parameters change
+				mutex detectorClonesMutex;
+				vector<shared_ptr<DetectorClone>> detectorClones;
+				size_t detectorClonesHash = 0;
 
 				ofImage preview;
 				Preview cachedPreviewType = Preview::Raw;
@@ -144,6 +144,15 @@ namespace ofxRulr {
 					RULR_CATCH_ALL_TO_ALERT;
 					}, OF_KEY_RETURN)->setHeight(100.0f);
 
+				inspector->addIndicatorBool("Full detection", [this]() {
+					return this->markerTracker.wasFullDetection();
+				});
+				inspector->addLiveValue<size_t>("Tracked markers", [this]() {
+					return this->markerTracker.getTrackedCount();
+				});
+				inspector->addLiveValue<size_t>("Lost markers", [this]() {
+					return this->markerTracker.getLostCount();
+				});
 			}
 
 
@@ -176,8 +185,20 @@ namespace ofxRulr {
 				auto& pixels = frame->getPixels();
 				auto image = ofxCv::toCv(pixels);
 
-				//perform the detection
-				{
+				//perform the detection (or follow the markers from the last frame)
+				if (this->parameters.tracking.enabled.get()) {
+					MarkerTracker::Settings trackerSettings;
+					trackerSettings.fullDetectInterval = this->parameters.tracking.fullDetectInterval.get();
+					trackerSettings.minimumTrackedFraction = this->parameters.tracking.minimumTrackedFraction.get();
+					trackerSettings.windowSize = this->parameters.tracking.windowSize.get();
+					trackerSettings.forwardBackwardThreshold = this->parameters.tracking.forwardBackwardThreshold.get();
+
+					this->rawMarkers = this->markerTracker.update(image, trackerSettings, [detectorNode](const cv::Mat & image) {
+						return detectorNode->findMarkers(image, false);
+					});
+				}
+				else {
+					this->markerTracker.reset();
 					this->rawMarkers = detectorNode->findMarkers(image, false);
 				}
 
@@ -2,6 +2,7 @@
 
 #include "Constants_Plugin_ArUco.h"
 #include "ofxRulr/Nodes/Base.h"
+#include "MarkerTracker.h"
 #include <aruco/aruco.h>
 
 namespace ofxRulr {
@@ -41,6 +42,7 @@ namespace ofxRulr {
 
 				vector<aruco::Marker> rawMarkers;
 				multimap<int, unique_ptr<TrackedMarker>> trackedMarkers;
+				MarkerTracker markerTracker;
 				ofxCvGui::PanelPtr panel;
 
 				ofMesh previewPlane;
@@ -52,6 +54,15 @@ namespace ofxRulr {
 
 						PARAM_DECLARE("Detection", processWhen, speakCount)
 					} detection;
+
+					struct : ofParameterGroup {
+						ofParameter<bool> enabled{ "Enabled", false };
+						ofParameter<int> fullDetectInterval{ "Full detect interval [frames]", 10 };
+						ofParameter<float> minimumTrackedFraction{ "Minimum tracked fraction", 0.75, 0, 1 };
+						ofParameter<int> windowSize{ "Window size [px]", 21 };
+						ofParameter<float> forwardBackwardThreshold{ "Forward-backward threshold [px]", 1.0 };
+						PARAM_DECLARE("Tracking", enabled, fullDetectInterval, minimumTrackedFraction, windowSize, forwardBackwardThreshold);
+					} tracking;
 					
 					struct : ofParameterGroup {
 						ofParameter<WhenToSave> whenToSave{ "When to save", WhenToSave::Never };
@@ -60,7 +71,7 @@ namespace ofxRulr {
 					} save;
 
 					ofParameter<WhenActive> drawLabels{ "Draw labels", WhenActive::Selected };
-					PARAM_DECLARE("FindMarkers", detection, save, drawLabels);
+					PARAM_DECLARE("FindMarkers", detection, tracking, save, drawLabels);
 				} parameters;
 			};
 		}
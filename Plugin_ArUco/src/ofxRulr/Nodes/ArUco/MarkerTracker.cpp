@@ -0,0 +1,207 @@
+#include "pch_Plugin_ArUco.h"
+#include "MarkerTracker.h"
+
+namespace ofxRulr {
+	namespace Nodes {
+		namespace ArUco {
+			//----------
+			vector<aruco::Marker> MarkerTracker::update(const cv::Mat & image, const Settings & settings, const DetectFunction & detect) {
+				if (image.channels() == 3) {
+					cv::cvtColor(image, this->grayscale, cv::COLOR_RGB2GRAY);
+				}
+				else {
+					image.copyTo(this->grayscale);
+				}
+
+				this->trackedCount = 0;
+				this->lostCount = 0;
+
+				auto needsFullDetection = this->previousMarkers.empty()
+					|| this->previousImage.size() != this->grayscale.size()
+					|| this->framesSinceFullDetection + 1 >= settings.fullDetectInterval;
+
+				vector<aruco::Marker> markers;
+
+				// Track the markers from the previous frame
+				if (!needsFullDetection) {
+					for (const auto & previousMarker : this->previousMarkers) {
+						cv::Point2f velocity[4];
+						auto findVelocity = this->velocities.find(previousMarker.id);
+						if (findVelocity != this->velocities.end()) {
+							copy(findVelocity->second.begin(), findVelocity->second.end(), velocity);
+						}
+
+						aruco::Marker trackedMarker;
+						if (this->track(this->grayscale, previousMarker, velocity, settings, trackedMarker)) {
+							markers.push_back(trackedMarker);
+						}
+						else {
+							this->lostCount++;
+						}
+					}
+
+					this->trackedCount = markers.size();
+					if ((float) markers.size() < settings.minimumTrackedFraction * (float) this->markerCountAtFullDetection) {
+						needsFullDetection = true;
+					}
+				}
+
+				if (needsFullDetection) {
+					markers = detect(image);
+					this->framesSinceFullDetection = 0;
+					this->markerCountAtFullDetection = markers.size();
+					this->lastWasFullDetection = true;
+				}
+				else {
+					this->framesSinceFullDetection++;
+					this->lastWasFullDetection = false;
+				}
+
+				this->store(markers);
+				return markers;
+			}
+
+			//----------
+			void MarkerTracker::reset() {
+				this->previousImage.release();
+				this->previousMarkers.clear();
+				this->velocities.clear();
+				this->framesSinceFullDetection = 0;
+				this->markerCountAtFullDetection = 0;
+				this->lastWasFullDetection = false;
+				this->trackedCount = 0;
+				this->lostCount = 0;
+			}
+
+			//----------
+			bool MarkerTracker::wasFullDetection() const {
+				return this->lastWasFullDetection;
+			}
+
+			//----------
+			size_t MarkerTracker::getTrackedCount() const {
+				return this->trackedCount;
+			}
+
+			//----------
+			size_t MarkerTracker::getLostCount() const {
+				return this->lostCount;
+			}
+
+			//----------
+			bool MarkerTracker::track(const cv::Mat & image, const aruco::Marker & previous, const cv::Point2f velocity[4], const Settings & settings, aruco::Marker & result) {
+				const auto windowSize = max(settings.windowSize | 1, 5);
+				const auto levels = max(settings.pyramidLevels, 0);
+
+				// Only look at the region where the marker can be (its corners now and where we expect them,
+				// plus enough for the search window at the coarsest level)
+				cv::Rect region;
+				{
+					this->previousPoints.assign(previous.begin(), previous.end());
+					this->points.resize(4);
+					for (int i = 0; i < 4; i++) {
+						this->points[i] = this->previousPoints[i] + velocity[i];
+					}
+
+					auto bounds = cv::boundingRect(this->previousPoints) | cv::boundingRect(this->points);
+					const auto margin = windowSize * (1 << levels);
+					bounds.x -= margin;
+					bounds.y -= margin;
+					bounds.width += margin * 2;
+					bounds.height += margin * 2;
+					region = bounds & cv::Rect(0, 0, image.cols, image.rows);
+					if (region.area() == 0) {
+						return false;
+					}
+
+					const auto offset = cv::Point2f((float) region.x, (float) region.y);
+					for (int i = 0; i < 4; i++) {
+						this->previousPoints[i] -= offset;
+						this->points[i] -= offset;
+					}
+				}
+
+				const auto previousRegion = this->previousImage(region);
+				const auto currentRegion = image(region);
+				const auto termCriteria = cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 30, 0.01);
+
+				// Forwards, starting from the predicted positions
+				cv::calcOpticalFlowPyrLK(previousRegion
+					, currentRegion
+					, this->previousPoints
+					, this->points
+					, this->status
+					, this->error
+					, cv::Size(windowSize, windowSize)
+					, levels
+					, termCriteria
+					, cv::OPTFLOW_USE_INITIAL_FLOW);
+
+				// Backwards, to check that we land back where we started
+				this->backPoints = this->previousPoints;
+				cv::calcOpticalFlowPyrLK(currentRegion
+					, previousRegion
+					, this->points
+					, this->backPoints
+					, this->backStatus
+					, this->error
+					, cv::Size(windowSize, windowSize)
+					, levels
+					, termCriteria
+					, cv::OPTFLOW_USE_INITIAL_FLOW);
+
+				const auto thresholdSquared = settings.forwardBackwardThreshold * settings.forwardBackwardThreshold;
+				for (int i = 0; i < 4; i++) {
+					if (!this->status[i] || !this->backStatus[i]) {
+						return false;
+					}
+					const auto delta = this->backPoints[i] - this->previousPoints[i];
+					if (delta.dot(delta) > thresholdSquared) {
+						return false;
+					}
+				}
+
+				// Reject quads which have folded or changed size too much to still be the same marker
+				if (!cv::isContourConvex(this->points)) {
+					return false;
+				}
+				{
+					const auto previousArea = cv::contourArea(this->previousPoints);
+					const auto area = cv::contourArea(this->points);
+					if (previousArea <= 0.0 || area < previousArea * 0.5 || area > previousArea * 2.0) {
+						return false;
+					}
+				}
+
+				result = previous;
+				for (int i = 0; i < 4; i++) {
+					result[i] = this->points[i] + cv::Point2f((float) region.x, (float) region.y);
+				}
+				return true;
+			}
+
+			//----------
+			void MarkerTracker::store(const vector<aruco::Marker> & markers) {
+				// Update the velocities of markers we've seen in both frames
+				map<int, array<cv::Point2f, 4>> velocities;
+				for (const auto & marker : markers) {
+					for (const auto & previousMarker : this->previousMarkers) {
+						if (previousMarker.id == marker.id) {
+							auto & velocity = velocities[marker.id];
+							for (int i = 0; i < 4; i++) {
+								velocity[i] = marker[i] - previousMarker[i];
+							}
+							break;
+						}
+					}
+				}
+				swap(this->velocities, velocities);
+
+				this->previousMarkers = markers;
+
+				// The old previous image becomes storage for the next frame's grayscale
+				swap(this->previousImage, this->grayscale);
+			}
+		}
+	}
+}
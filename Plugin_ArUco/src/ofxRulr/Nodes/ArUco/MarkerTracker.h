@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Constants_Plugin_ArUco.h"
+#include <aruco/aruco.h>
+
+namespace ofxRulr {
+	namespace Nodes {
+		namespace ArUco {
+			/// Follows markers from frame to frame by tracking their corners (pyramidal Lucas-Kanade inside a
+			/// window around where each marker is expected), and only falls back to a full detection every
+			/// N frames or when too many markers have been lost.
+			class PLUGIN_ARUCO_EXPORTS MarkerTracker {
+			public:
+				struct Settings {
+					int fullDetectInterval = 10; // [frames]
+					float minimumTrackedFraction = 0.75f; // of the markers found in the last full detection
+					int windowSize = 21; // [px]
+					int pyramidLevels = 3;
+					float forwardBackwardThreshold = 1.0f; // [px]
+				};
+
+				typedef function<vector<aruco::Marker>(const cv::Mat &)> DetectFunction;
+
+				/// Returns the markers in this image. detect is called for a full detection when needed
+				vector<aruco::Marker> update(const cv::Mat & image, const Settings &, const DetectFunction & detect);
+				void reset();
+
+				bool wasFullDetection() const;
+				size_t getTrackedCount() const; // markers kept by tracking in the last frame (0 after a full detection)
+				size_t getLostCount() const; // markers dropped by tracking in the last frame
+			protected:
+				bool track(const cv::Mat & image, const aruco::Marker & previous, const cv::Point2f velocity[4], const Settings &, aruco::Marker & result);
+				void store(const vector<aruco::Marker> &);
+
+				cv::Mat previousImage;
+				vector<aruco::Marker> previousMarkers;
+				map<int, array<cv::Point2f, 4>> velocities; // corner motion per frame, by marker ID
+
+				int framesSinceFullDetection = 0;
+				size_t markerCountAtFullDetection = 0;
+
+				bool lastWasFullDetection = false;
+				size_t trackedCount = 0;
+				size_t lostCount = 0;
+
+				// Working data
+				cv::Mat grayscale;
+				vector<cv::Point2f> previousPoints;
+				vector<cv::Point2f> points;
+				vector<cv::Point2f> backPoints;
+				vector<uchar> status;
+				vector<uchar> backStatus;
+				vector<float> error;
+			};
+		}
+	}
+}
@@ -1,5 +1,6 @@
 #include "pch_Plugin_ArUco.h"
 #include "ofxRulr/Solvers/MarkerProjections.h"
+#include "ofxRulr/Utils/BatchImport.h"
 
 namespace ofxRulr {
 	namespace Nodes {
@@ -530,6 +531,14 @@ namespace ofxRulr {
 					}
 					RULR_CATCH_ALL_TO_ALERT;
 					});
+				inspector->addButton("Benchmark solver", [this]() {
+					try {
+						Utils::ScopedProcess scopedProcess("Benchmark solver");
+						this->benchmarkSolver();
+						scopedProcess.end();
+					}
+					RULR_CATCH_ALL_TO_ALERT;
+					});
 			}
 
 			//----------
@@ -990,10 +999,7 @@ namespace ofxRulr {
 
 						// Perform solve
 						if (this->parameters.calibration.bundleAdjustment.enabled.get()) {
-							auto solverSettings = Solvers::MarkerProjections::defaultSolverSettings();
-							solverSettings.options.max_num_iterations = this->parameters.calibration.bundleAdjustment.maxIterations.get();
-							solverSettings.options.function_tolerance = this->parameters.calibration.bundleAdjustment.functionTolerance.get();
-							solverSettings.options.num_threads = this->parameters.calibration.bundleAdjustment.numThreads.get();
+							auto solverSettings = this->getSolverSettings();
 
 							auto cameraView = camera->getViewInObjectSpace();
 
@@ -1004,7 +1010,8 @@ namespace ofxRulr {
 								, images
 								, fixedObjectIndices
 								, initialSolution
-								, solverSettings);
+								, solverSettings
+								, this->getProblemSettings());
 
 							if (!result.isConverged()) {
 								if (this->parameters.calibration.bundleAdjustment.useIncompleteSolution.get()) {
@@ -1139,10 +1146,7 @@ namespace ofxRulr {
 
 				// Perform solve
 				{
-					auto solverSettings = Solvers::MarkerProjections::defaultSolverSettings();
-					solverSettings.options.max_num_iterations = this->parameters.calibration.bundleAdjustment.maxIterations.get();
-					solverSettings.options.function_tolerance = this->parameters.calibration.bundleAdjustment.functionTolerance.get();
-					solverSettings.options.num_threads = this->parameters.calibration.bundleAdjustment.numThreads.get();
+					auto solverSettings = this->getSolverSettings();
 
 					auto cameraView = camera->getViewInObjectSpace();
 
@@ -1153,7 +1157,8 @@ namespace ofxRulr {
 						, images
 						, fixedObjectIndices
 						, initialSolution
-						, solverSettings);
+						, solverSettings
+						, this->getProblemSettings());
 
 					if (!result.isConverged()) {
 						if (this->parameters.calibration.bundleAdjustment.useIncompleteSolution.get()) {
@@ -1315,10 +1320,7 @@ namespace ofxRulr {
 
 					// Perform the solve
 					{
-						auto solverSettings = Solvers::MarkerProjections::defaultSolverSettings();
-						solverSettings.options.max_num_iterations = this->parameters.calibration.bundleAdjustment.maxIterations.get();
-						solverSettings.options.function_tolerance = this->parameters.calibration.bundleAdjustment.functionTolerance.get();
-						solverSettings.options.num_threads = this->parameters.calibration.bundleAdjustment.numThreads.get();
+						auto solverSettings = this->getSolverSettings();
 
 						auto cameraView = camera->getViewInObjectSpace();
 
@@ -1329,7 +1331,8 @@ namespace ofxRulr {
 							, images
 							, fixedObjectIndices
 							, initialSolution
-							, solverSettings);
+							, solverSettings
+							, this->getProblemSettings());
 
 						if (result.residual > this->parameters.progressiveCalibration.maximumResidual.get()) {
 							throw(ofxRulr::Exception("Residual is too high to continue"));
@@ -1404,15 +1407,21 @@ namespace ofxRulr {
 				}
 				this->throwIfMissingAnyConnection();
 				auto markers = this->getInput<Markers>();
-				auto camera = this->getInput<Item::Camera>();
 
 				markers->throwIfMissingAConnection<ArUco::Detector>();
 				auto detector = markers->getInput<ArUco::Detector>();
 
 				auto foundMarkers = detector->findMarkers(image, false);
+				this->add(foundMarkers, name);
+			}
+
+			//----------
+			void Calibrate::add(const vector<aruco::Marker>& foundMarkers, const string& name) {
 				if (foundMarkers.empty()) {
 					throw(ofxRulr::Exception("No markers found"));
 				}
+				this->throwIfMissingAConnection<Item::Camera>();
+				auto camera = this->getInput<Item::Camera>();
 
 				auto capture = make_shared<Capture>();
 				capture->parent = this;
@@ -1437,33 +1446,24 @@ namespace ofxRulr {
 					return;
 				}
 
+				this->throwIfMissingAnyConnection();
+				auto markers = this->getInput<Markers>();
+				markers->throwIfMissingAConnection<ArUco::Detector>();
+				auto detector = markers->getInput<ArUco::Detector>();
 
-				ofDirectory directory(result.filePath);
-				auto count = directory.listDir();
-
-				Utils::ScopedProcess outerScopedProcess(result.filePath, false, count);
-
-				for (const auto& file : directory) {
-					auto extension = ofToLower(file.getExtension());
-					bool validExtension = extension == "png"
-						|| extension == "bmp"
-						|| extension == "jpg"
-						|| extension == "jpeg"
-						|| extension == "tif"
-						|| extension == "tiff";
-					if (!validExtension) {
-						continue;
-					}
-
-					auto path = file.getAbsolutePath();
-					try {
-						Utils::ScopedProcess fileScopedProcess(file.getFileName());
-						auto image = cv::imread(path);
-						this->add(image, ofFilePath::getBaseName(path));
-						fileScopedProcess.end();
-					}
-					RULR_CATCH_ALL_TO_ERROR;
-				}
+				Utils::BatchImport::Settings importSettings;
+				importSettings.threads = (size_t) max(this->parameters.folderImport.threads.get(), 0);
+				importSettings.prefetch = (size_t) max(this->parameters.folderImport.prefetch.get(), 0);
+
+				// Detect in parallel (one image per worker, each detecting single threaded), add the captures here in file order
+				auto files = Utils::BatchImport::listImages(result.filePath);
+				Utils::BatchImport::process(files, [this, detector](const cv::Mat& image, const std::filesystem::path& path) {
+					auto foundMarkers = detector->findMarkers(image, true, true);
+					auto name = path.stem().string();
+					return function<void()>([this, foundMarkers, name]() {
+						this->add(foundMarkers, name);
+					});
+				}, importSettings);
 
 				this->dirty.capturePreviews = true;
 			}
@@ -1595,6 +1595,16 @@ namespace ofxRulr {
 				this->dirty.capturePreviews = true;
 			}
 
+			//----------
+			void Calibrate::benchmarkSolver() {
+				// A synthetic venue sized map, solved with the current bundle adjustment settings
+				auto report = Solvers::MarkerProjections::benchmark(1000
+					, 200
+					, this->getSolverSettings()
+					, this->getProblemSettings());
+				ofLogNotice("MarkerMap::Calibrate") << "Bundle adjustment benchmark" << endl << report;
+			}
+
 			//----------
 			void Calibrate::initialiseUnseenMarkersInView(shared_ptr<Capture> capture) {
 				this->throwIfMissingAConnection<Markers>();
@@ -1682,6 +1692,29 @@ namespace ofxRulr {
 
 				this->dirty.capturePreviews = false;
 			}
+
+			//----------
+			ofxCeres::SolverSettings Calibrate::getSolverSettings() const {
+				const auto& bundleAdjustment = this->parameters.calibration.bundleAdjustment;
+
+				auto solverSettings = Solvers::MarkerProjections::defaultSolverSettings();
+				solverSettings.options.max_num_iterations = bundleAdjustment.maxIterations.get();
+				solverSettings.options.function_tolerance = bundleAdjustment.functionTolerance.get();
+				solverSettings.options.num_threads = max(bundleAdjustment.numThreads.get(), 1);
+				return solverSettings;
+			}
+
+			//----------
+			Solvers::MarkerProjections::ProblemSettings Calibrate::getProblemSettings() const {
+				const auto& bundleAdjustment = this->parameters.calibration.bundleAdjustment;
+
+				Solvers::MarkerProjections::ProblemSettings problemSettings;
+				problemSettings.linearSolver = bundleAdjustment.linearSolver.get();
+				problemSettings.lossFunction = bundleAdjustment.lossFunction.get();
+				problemSettings.lossScale = bundleAdjustment.lossScale.get();
+				problemSettings.analyticJacobian = bundleAdjustment.analyticJacobian.get();
+				return problemSettings;
+			}
 		}
 	}
 }
\ No newline at end of file
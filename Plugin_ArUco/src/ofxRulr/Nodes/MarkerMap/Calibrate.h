@@ -75,10 +75,12 @@ namespace ofxRulr {
 				void calibrateSelected();
 				void calibrateProgressiveMarkers();
 				void calibrateProgressiveMarkersContinuously();
+				void benchmarkSolver();
 
 
 			protected:
 				void add(const cv::Mat& image, const string& name);
+				void add(const vector<aruco::Marker>& foundMarkers, const string& name);
 				void addFolderOfImages();
 
 				void unpackSolution(vector<shared_ptr<Capture>> captures
@@ -91,6 +93,9 @@ namespace ofxRulr {
 
 				void updateCapturePreviews();
 
+				ofxCeres::SolverSettings getSolverSettings() const;
+				Solvers::MarkerProjections::ProblemSettings getProblemSettings() const;
+
 				Utils::CaptureSet<Capture> captures;
 				shared_ptr<ofxCvGui::Panels::Widgets> panel;
 
@@ -106,8 +111,12 @@ namespace ofxRulr {
 							ofParameter<int> maxIterations{ "Max iterations", 10000 };
 							ofParameter<float> functionTolerance{ "Function tolerance", 1e-9 };
 							ofParameter<bool> useIncompleteSolution{ "Use imcomplete solution",true };
-							ofParameter<int> numThreads{ "Number of threads",4 };
-							PARAM_DECLARE("Bundle Adjustment", enabled, maxIterations, functionTolerance, useIncompleteSolution, numThreads);
+							ofParameter<int> numThreads{ "Number of threads", (int) std::thread::hardware_concurrency() };
+							ofParameter<Solvers::MarkerProjections::LinearSolver> linearSolver{ "Linear solver", Solvers::MarkerProjections::LinearSolver::Auto };
+							ofParameter<Solvers::MarkerProjections::LossFunction> lossFunction{ "Loss function", Solvers::MarkerProjections::LossFunction::None };
+							ofParameter<float> lossScale{ "Loss scale [px]", 2, 0.1, 100 };
+							ofParameter<bool> analyticJacobian{ "Analytic Jacobian", true };
+							PARAM_DECLARE("Bundle Adjustment", enabled, maxIterations, functionTolerance, useIncompleteSolution, numThreads, linearSolver, lossFunction, lossScale, analyticJacobian);
 						} bundleAdjustment;
 						PARAM_DECLARE("Calibration", bundleAdjustment);
 					} calibration;
@@ -137,7 +146,13 @@ namespace ofxRulr {
 						PARAM_DECLARE("Draw", cameraRays, cameraViews, labels);
 					} draw;
 
-					PARAM_DECLARE("Calibrate", calibration, progressiveCalibration, debug, draw);
+					struct : ofParameterGroup {
+						ofParameter<int> threads{ "Threads", 0 }; ///< 0 : one per core
+						ofParameter<int> prefetch{ "Prefetch", 0 }; ///< 0 : one per thread
+						PARAM_DECLARE("Folder import", threads, prefetch);
+					} folderImport;
+
+					PARAM_DECLARE("Calibrate", calibration, progressiveCalibration, debug, draw, folderImport);
 				} parameters;
 			};
 		}
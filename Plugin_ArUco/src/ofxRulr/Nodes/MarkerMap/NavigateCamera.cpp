@@ -122,17 +122,35 @@ namespace ofxRulr {
 
 				std::vector<aruco::Marker> foundMarkers;
 
-				// Navigate using directly found markers
+				// Navigate using directly found (or tracked) markers
+				bool wasFullDetection = true;
 				if (!trustPriorPose) {
-					foundMarkers = detector->findMarkers(image, false);
+					if (this->parameters.tracking.enabled.get()) {
+						ArUco::MarkerTracker::Settings trackerSettings;
+						trackerSettings.fullDetectInterval = this->parameters.tracking.fullDetectInterval.get();
+						trackerSettings.minimumTrackedFraction = this->parameters.tracking.minimumTrackedFraction.get();
+						trackerSettings.windowSize = this->parameters.tracking.windowSize.get();
+						trackerSettings.forwardBackwardThreshold = this->parameters.tracking.forwardBackwardThreshold.get();
+
+						foundMarkers = this->markerTracker.update(image, trackerSettings, [detector](const cv::Mat & image) {
+							return detector->findMarkers(image, false);
+						});
+						wasFullDetection = this->markerTracker.wasFullDetection();
+					}
+					else {
+						this->markerTracker.reset();
+						foundMarkers = detector->findMarkers(image, false);
+					}
 					navigateToFoundMarkers(foundMarkers);
 				}
 				else {
 					// leave it empty and we just look for missing markers
+					this->markerTracker.reset();
 				}
 
 				// Find missing markers and navigate using those also
-				if (this->parameters.findMissingMarkers.enabled.get() || trustPriorPose) {
+				// (whilst tracking, only on the frames where we do a full detection)
+				if ((this->parameters.findMissingMarkers.enabled.get() && wasFullDetection) || trustPriorPose) {
 					// Bounds of camera image
 					auto imageBounds = ofRectangle(0
 						, 0
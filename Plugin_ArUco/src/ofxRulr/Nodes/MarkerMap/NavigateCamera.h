@@ -2,6 +2,7 @@
 
 #include "Constants_Plugin_ArUco.h"
 #include "ofxRulr/Nodes/Base.h"
+#include "ofxRulr/Nodes/ArUco/MarkerTracker.h"
 #include <opencv2/aruco.hpp>
 
 namespace ofxRulr {
@@ -23,6 +24,16 @@ namespace ofxRulr {
 					
 					ofParameter<bool> trustPriorPose{ "Trust prior pose", false };
 
+					// Follow markers from the previous frame rather than detecting them every frame
+					struct : ofParameterGroup {
+						ofParameter<bool> enabled{ "Enabled", false };
+						ofParameter<int> fullDetectInterval{ "Full detect interval [frames]", 10 };
+						ofParameter<float> minimumTrackedFraction{ "Minimum tracked fraction", 0.75, 0, 1 };
+						ofParameter<int> windowSize{ "Window size [px]", 21 };
+						ofParameter<float> forwardBackwardThreshold{ "Forward-backward threshold [px]", 1.0 };
+						PARAM_DECLARE("Tracking", enabled, fullDetectInterval, minimumTrackedFraction, windowSize, forwardBackwardThreshold);
+					} tracking;
+
 					struct : ofParameterGroup {
 						ofParameter<bool> enabled{ "Enabled", true };
 						ofParameter<float> searchRange{ "Search range", 2.0f, 1.0f, 10.0f };
@@ -46,6 +57,7 @@ namespace ofxRulr {
 						, onNewFrame
 						, minMarkerCount
 						, trustPriorPose
+						, tracking
 						, findMissingMarkers
 						, ransac
 						, useExtrinsicGuess
@@ -53,6 +65,7 @@ namespace ofxRulr {
 				} parameters;
 
 				vector<ofxRay::Ray> cameraRays;
+				ArUco::MarkerTracker markerTracker;
 			};
 		}
 	}
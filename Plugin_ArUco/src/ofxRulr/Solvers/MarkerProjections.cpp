@@ -1,6 +1,8 @@
 #include "pch_Plugin_ArUco.h"
 #include "MarkerProjections.h"
 #include <glm/gtx/matrix_decompose.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <random>
 
 using namespace ofxCeres::VectorMath;
 
@@ -98,6 +100,254 @@ struct MarkerProjection_Cost
 	const vector<glm::vec3> objectPoints;
 };
 
+// The same projection as MarkerProjection_Cost with the Jacobian written out by hand, which saves
+// carrying dual numbers through the 4 corners. Rotations are Euler angles applied X then Y then Z,
+// i.e. glm::quat(eulerAngles), which is what getTransform decomposes into.
+class MarkerProjection_AnalyticCost : public ceres::SizedCostFunction<4 * 2, 6, 6>
+{
+public:
+	MarkerProjection_AnalyticCost(int cameraWidth
+		, int cameraHeight
+		, const glm::mat4& cameraProjectionMatrix
+		, const vector<glm::vec2>& imagePointsUndistorted
+		, const vector<glm::vec3>& objectPoints)
+		: cameraWidth(cameraWidth)
+		, cameraHeight(cameraHeight)
+	{
+		if (imagePointsUndistorted.size() != 4 || objectPoints.size() != 4) {
+			throw(ofxRulr::Exception("MarkerProjection_AnalyticCost needs 4 image points and 4 object points"));
+		}
+
+		// glm is column major
+		for (int row = 0; row < 4; row++) {
+			for (int column = 0; column < 4; column++) {
+				this->projection[row][column] = cameraProjectionMatrix[column][row];
+			}
+		}
+		for (int i = 0; i < 4; i++) {
+			for (int j = 0; j < 2; j++) {
+				this->imagePoints[i][j] = imagePointsUndistorted[i][j];
+			}
+			for (int j = 0; j < 3; j++) {
+				this->objectPoints[i][j] = objectPoints[i][j];
+			}
+		}
+	}
+
+	bool Evaluate(double const* const* parameters
+		, double* residuals
+		, double** jacobians) const override
+	{
+		const auto viewParameters = parameters[0];
+		const auto objectParameters = parameters[1];
+
+		const bool needJacobians = jacobians != nullptr;
+		const bool needViewJacobian = needJacobians && jacobians[0] != nullptr;
+		const bool needObjectJacobian = needJacobians && jacobians[1] != nullptr;
+
+		double viewRotation[3][3], viewRotationDerivatives[3][3][3];
+		double objectRotation[3][3], objectRotationDerivatives[3][3][3];
+		getRotation(viewParameters, viewRotation, needViewJacobian ? viewRotationDerivatives : nullptr);
+		getRotation(objectParameters, objectRotation, needObjectJacobian ? objectRotationDerivatives : nullptr);
+
+		const double halfWidth = (double)this->cameraWidth / 2.0;
+		const double halfHeight = (double)this->cameraHeight / 2.0;
+
+		for (int i = 0; i < 4; i++) {
+			const auto objectPoint = this->objectPoints[i];
+
+			double worldPoint[3], viewPoint[3];
+			multiply(objectRotation, objectPoint, worldPoint);
+			for (int j = 0; j < 3; j++) {
+				worldPoint[j] += objectParameters[3 + j];
+			}
+			multiply(viewRotation, worldPoint, viewPoint);
+			for (int j = 0; j < 3; j++) {
+				viewPoint[j] += viewParameters[3 + j];
+			}
+
+			double projected[4];
+			for (int row = 0; row < 4; row++) {
+				projected[row] = this->projection[row][0] * viewPoint[0]
+					+ this->projection[row][1] * viewPoint[1]
+					+ this->projection[row][2] * viewPoint[2]
+					+ this->projection[row][3];
+			}
+			const double inverseW = 1.0 / projected[3];
+
+			residuals[i * 2 + 0] = halfWidth * (projected[0] * inverseW + 1.0) - this->imagePoints[i][0];
+			residuals[i * 2 + 1] = halfHeight * (1.0 - projected[1] * inverseW) - this->imagePoints[i][1];
+
+			if (!needJacobians) {
+				continue;
+			}
+
+			// d residual / d projected (the perspective divide)
+			double residualByProjected[2][4] = {
+				{ halfWidth * inverseW, 0, 0, -halfWidth * projected[0] * inverseW * inverseW }
+				, { 0, -halfHeight * inverseW, 0, halfHeight * projected[1] * inverseW * inverseW }
+			};
+
+			// d residual / d viewPoint
+			double residualByViewPoint[2][3];
+			for (int r = 0; r < 2; r++) {
+				for (int k = 0; k < 3; k++) {
+					residualByViewPoint[r][k] = 0.0;
+					for (int j = 0; j < 4; j++) {
+						residualByViewPoint[r][k] += residualByProjected[r][j] * this->projection[j][k];
+					}
+				}
+			}
+
+			if (needViewJacobian) {
+				for (int axis = 0; axis < 3; axis++) {
+					double viewPointByAngle[3];
+					multiply(viewRotationDerivatives[axis], worldPoint, viewPointByAngle);
+					for (int r = 0; r < 2; r++) {
+						jacobians[0][(i * 2 + r) * 6 + axis] = dot(residualByViewPoint[r], viewPointByAngle);
+					}
+				}
+				for (int r = 0; r < 2; r++) {
+					for (int k = 0; k < 3; k++) {
+						jacobians[0][(i * 2 + r) * 6 + 3 + k] = residualByViewPoint[r][k];
+					}
+				}
+			}
+
+			if (needObjectJacobian) {
+				// d residual / d worldPoint
+				double residualByWorldPoint[2][3];
+				for (int r = 0; r < 2; r++) {
+					for (int k = 0; k < 3; k++) {
+						residualByWorldPoint[r][k] = residualByViewPoint[r][0] * viewRotation[0][k]
+							+ residualByViewPoint[r][1] * viewRotation[1][k]
+							+ residualByViewPoint[r][2] * viewRotation[2][k];
+					}
+				}
+
+				for (int axis = 0; axis < 3; axis++) {
+					double worldPointByAngle[3];
+					multiply(objectRotationDerivatives[axis], objectPoint, worldPointByAngle);
+					for (int r = 0; r < 2; r++) {
+						jacobians[1][(i * 2 + r) * 6 + axis] = dot(residualByWorldPoint[r], worldPointByAngle);
+					}
+				}
+				for (int r = 0; r < 2; r++) {
+					for (int k = 0; k < 3; k++) {
+						jacobians[1][(i * 2 + r) * 6 + 3 + k] = residualByWorldPoint[r][k];
+					}
+				}
+			}
+		}
+
+		return true;
+	}
+
+protected:
+	typedef double Matrix3[3][3];
+
+	// R = Rz * Ry * Rx, and optionally dR / d(x, y, z)
+	static void getRotation(const double* parameters, Matrix3 rotation, Matrix3* derivatives) {
+		const double cx = cos(parameters[0]), sx = sin(parameters[0]);
+		const double cy = cos(parameters[1]), sy = sin(parameters[1]);
+		const double cz = cos(parameters[2]), sz = sin(parameters[2]);
+
+		const Matrix3 rx = { { 1, 0, 0 }, { 0, cx, -sx }, { 0, sx, cx } };
+		const Matrix3 ry = { { cy, 0, sy }, { 0, 1, 0 }, { -sy, 0, cy } };
+		const Matrix3 rz = { { cz, -sz, 0 }, { sz, cz, 0 }, { 0, 0, 1 } };
+
+		Matrix3 rzy;
+		multiply(rz, ry, rzy);
+		multiply(rzy, rx, rotation);
+
+		if (derivatives) {
+			const Matrix3 drx = { { 0, 0, 0 }, { 0, -sx, -cx }, { 0, cx, -sx } };
+			const Matrix3 dry = { { -sy, 0, cy }, { 0, 0, 0 }, { -cy, 0, -sy } };
+			const Matrix3 drz = { { -sz, -cz, 0 }, { cz, -sz, 0 }, { 0, 0, 0 } };
+
+			Matrix3 temp;
+			multiply(rzy, drx, derivatives[0]);
+
+			multiply(rz, dry, temp);
+			multiply(temp, rx, derivatives[1]);
+
+			multiply(drz, ry, temp);
+			multiply(temp, rx, derivatives[2]);
+		}
+	}
+
+	static void multiply(const Matrix3 a, const Matrix3 b, Matrix3 result) {
+		for (int row = 0; row < 3; row++) {
+			for (int column = 0; column < 3; column++) {
+				result[row][column] = a[row][0] * b[0][column]
+					+ a[row][1] * b[1][column]
+					+ a[row][2] * b[2][column];
+			}
+		}
+	}
+
+	static void multiply(const Matrix3 a, const double* vector, double* result) {
+		for (int row = 0; row < 3; row++) {
+			result[row] = a[row][0] * vector[0]
+				+ a[row][1] * vector[1]
+				+ a[row][2] * vector[2];
+		}
+	}
+
+	static double dot(const double* a, const double* b) {
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	int cameraWidth;
+	int cameraHeight;
+	double projection[4][4];
+	double imagePoints[4][2];
+	double objectPoints[4][3];
+};
+
+// Evaluate both costs on one residual block and return the largest difference between their Jacobians,
+// relative to the largest automatic Jacobian entry. The two compose the transforms in a different order,
+// so expect some rounding
+static double compareJacobians(int cameraWidth
+	, int cameraHeight
+	, const glm::mat4& cameraProjectionMatrix
+	, const vector<glm::vec2>& imagePointsUndistorted
+	, const vector<glm::vec3>& objectPoints
+	, const double* viewParameters
+	, const double* objectParameters)
+{
+	MarkerProjection_AnalyticCost analyticCost(cameraWidth
+		, cameraHeight
+		, cameraProjectionMatrix
+		, imagePointsUndistorted
+		, objectPoints);
+	unique_ptr<ceres::CostFunction> autoDiffCost(MarkerProjection_Cost::Create(cameraWidth
+		, cameraHeight
+		, cameraProjectionMatrix
+		, imagePointsUndistorted
+		, objectPoints));
+
+	const double* parameters[2] = { viewParameters, objectParameters };
+	double residuals[2][8];
+	double jacobians[2][2][8 * 6];
+	double* analyticJacobians[2] = { jacobians[0][0], jacobians[0][1] };
+	double* autoDiffJacobians[2] = { jacobians[1][0], jacobians[1][1] };
+	analyticCost.Evaluate(parameters, residuals[0], analyticJacobians);
+	autoDiffCost->Evaluate(parameters, residuals[1], autoDiffJacobians);
+
+	double maxDifference = 0.0;
+	double maxMagnitude = 0.0;
+	for (int block = 0; block < 2; block++) {
+		for (int i = 0; i < 8 * 6; i++) {
+			maxDifference = max(maxDifference, abs(jacobians[0][block][i] - jacobians[1][block][i]));
+			maxMagnitude = max(maxMagnitude, abs(jacobians[1][block][i]));
+		}
+	}
+	return maxDifference / max(maxMagnitude, 1e-12);
+}
+
+static const double jacobianTolerance = 1e-5;
+
 namespace ofxRulr {
 	namespace Solvers {
 		//----------
@@ -108,9 +358,10 @@ namespace ofxRulr {
 			solverSettings.printReport = true;
 			solverSettings.options.max_num_iterations = 10000;
 			solverSettings.options.function_tolerance = 1e-8;
-			//solverSettings.options.num_threads = std::thread::hardware_concurrency() - 2;
+			solverSettings.options.num_threads = max<int>(std::thread::hardware_concurrency(), 1);
 
 			// according to http://ceres-solver.org/solving_faqs.html
+			// (solve() replaces this according to ProblemSettings::linearSolver)
 			solverSettings.options.linear_solver_type = ceres::LinearSolverType::DENSE_SCHUR;
 
 			return solverSettings;
@@ -125,7 +376,8 @@ namespace ofxRulr {
 				, const vector<Image>& images
 				, const vector<int>& fixedObjectIndices
 				, const Solution& initialSolution
-				, const ofxCeres::SolverSettings& solverSettings)
+				, const ofxCeres::SolverSettings& solverSettings
+				, const ProblemSettings& problemSettings)
 		{
 			// Check the incoming data
 			set<int> unseenObjects;
@@ -227,19 +479,72 @@ namespace ofxRulr {
 				}
 			}
 
+			// Robust loss. It applies to each image of a marker, i.e. all 4 corners together.
+			// We hold it until the problem takes ownership, so that it isn't leaked if building the problem throws
+			unique_ptr<ceres::LossFunction> ownedLossFunction;
+			{
+				const double lossScale = problemSettings.lossScale * 2.0;
+				switch (problemSettings.lossFunction.get()) {
+				case LossFunction::Huber:
+					ownedLossFunction = make_unique<ceres::HuberLoss>(lossScale);
+					break;
+				case LossFunction::Cauchy:
+					ownedLossFunction = make_unique<ceres::CauchyLoss>(lossScale);
+					break;
+				case LossFunction::SoftL1:
+					ownedLossFunction = make_unique<ceres::SoftLOneLoss>(lossScale);
+					break;
+				case LossFunction::None:
+				default:
+					break;
+				}
+			}
+
+			// Check the analytic Jacobian against the automatic one on the first residual block, and don't use it if they differ
+			auto analyticJacobian = problemSettings.analyticJacobian;
+			if (analyticJacobian && !images.empty()) {
+				const auto& image = images.front();
+				auto relativeDifference = compareJacobians(cameraWidth
+					, cameraHeight
+					, cameraProjectionMatrix
+					, image.imagePointsUndistorted
+					, objectPoints[image.objectIndex]
+					, allViewParameters[image.viewIndex]
+					, allObjectParameters[image.objectIndex]);
+				if (!(relativeDifference <= jacobianTolerance)) {
+					ofLogWarning("MarkerProjections") << "Analytic Jacobian doesn't match the automatic one (relative difference "
+						<< relativeDifference << "). Using the automatic Jacobian";
+					analyticJacobian = false;
+				}
+			}
+
 			// Construct the problem
 			ceres::Problem problem;
 			{
+				auto lossFunction = ownedLossFunction.get();
 				for (const auto& image : images) {
-					auto costFunction = MarkerProjection_Cost::Create(cameraWidth
-						, cameraHeight
-						, cameraProjectionMatrix
-						, image.imagePointsUndistorted
-						, objectPoints[image.objectIndex]);
+					ceres::CostFunction* costFunction;
+					if (analyticJacobian) {
+						costFunction = new MarkerProjection_AnalyticCost(cameraWidth
+							, cameraHeight
+							, cameraProjectionMatrix
+							, image.imagePointsUndistorted
+							, objectPoints[image.objectIndex]);
+					}
+					else {
+						costFunction = MarkerProjection_Cost::Create(cameraWidth
+							, cameraHeight
+							, cameraProjectionMatrix
+							, image.imagePointsUndistorted
+							, objectPoints[image.objectIndex]);
+					}
 					problem.AddResidualBlock(costFunction
-						, NULL
+						, lossFunction
 						, allViewParameters[image.viewIndex]
 						, allObjectParameters[image.objectIndex]);
+
+					// The problem owns it now
+					ownedLossFunction.release();
 				}
 			}
 
@@ -250,9 +555,64 @@ namespace ofxRulr {
 				}
 			}
 
+			// Choose the linear solver
+			auto options = solverSettings.options;
+			{
+				auto linearSolver = problemSettings.linearSolver.get();
+				if (linearSolver == LinearSolver::Auto) {
+					linearSolver = initialSolution.views.size() > 100
+						? LinearSolver::SparseSchur
+						: LinearSolver::DenseSchur;
+				}
+
+				if (linearSolver == LinearSolver::SparseSchur
+					&& (options.sparse_linear_algebra_library_type == ceres::NO_SPARSE
+						|| !ceres::IsSparseLinearAlgebraLibraryTypeAvailable(options.sparse_linear_algebra_library_type))) {
+					if (solverSettings.printReport) {
+						ofLogWarning("MarkerProjections") << "Ceres has no sparse linear algebra library. Using iterative Schur instead";
+					}
+					linearSolver = LinearSolver::IterativeSchur;
+				}
+
+				switch (linearSolver) {
+				case LinearSolver::SparseSchur:
+					options.linear_solver_type = ceres::SPARSE_SCHUR;
+					break;
+				case LinearSolver::IterativeSchur:
+					options.linear_solver_type = ceres::ITERATIVE_SCHUR;
+					options.preconditioner_type = ceres::SCHUR_JACOBI;
+					break;
+				case LinearSolver::DenseSchur:
+				default:
+					options.linear_solver_type = ceres::DENSE_SCHUR;
+					break;
+				}
+			}
+
+			// Eliminate the larger of the two sets of parameter blocks (normally the markers). Each set is
+			// independent (views only connect to objects) so either can go first for the Schur complement
+			{
+				set<int> seenViews;
+				set<int> seenObjects;
+				for (const auto& image : images) {
+					seenViews.insert(image.viewIndex);
+					seenObjects.insert(image.objectIndex);
+				}
+
+				const auto eliminateObjects = seenObjects.size() >= seenViews.size();
+				auto ordering = new ceres::ParameterBlockOrdering();
+				for (auto objectIndex : seenObjects) {
+					ordering->AddElementToGroup(allObjectParameters[objectIndex], eliminateObjects ? 0 : 1);
+				}
+				for (auto viewIndex : seenViews) {
+					ordering->AddElementToGroup(allViewParameters[viewIndex], eliminateObjects ? 1 : 0);
+				}
+				options.linear_solver_ordering.reset(ordering);
+			}
+
 			// Solve the fit
 			ceres::Solver::Summary summary;
-			ceres::Solve(solverSettings.options
+			ceres::Solve(options
 				, &problem
 				, &summary);
 
@@ -323,6 +683,295 @@ namespace ofxRulr {
 			return result;
 		}
 
+		//----------
+		string
+			MarkerProjections::benchmark(size_t markerCount
+				, size_t viewCount
+				, const ofxCeres::SolverSettings& solverSettings
+				, const ProblemSettings& problemSettings)
+		{
+			const int cameraWidth = 1920;
+			const int cameraHeight = 1080;
+			const auto cameraProjectionMatrix = glm::perspective(glm::radians(60.0f)
+				, (float)cameraWidth / (float)cameraHeight
+				, 0.05f
+				, 100.0f);
+
+			const glm::vec3 roomSize{ 20, 5, 20 };
+			const float markerLength = 0.2f;
+			const float noise = 0.3f; // [px]
+			const float outlierFraction = 0.02f;
+			const float outlierSize = 20.0f; // [px]
+
+			mt19937 random(0);
+			auto uniform = [&random](float min, float max) {
+				return uniform_real_distribution<float>(min, max)(random);
+			};
+			auto normal = [&random](float sigma) {
+				return normal_distribution<float>(0.0f, sigma)(random);
+			};
+
+			const vector<glm::vec3> markerCorners{
+				{ -markerLength / 2.0f, markerLength / 2.0f, 0.0f }
+				, { markerLength / 2.0f, markerLength / 2.0f, 0.0f }
+				, { markerLength / 2.0f, -markerLength / 2.0f, 0.0f }
+				, { -markerLength / 2.0f, -markerLength / 2.0f, 0.0f }
+			};
+
+			auto project = [&](const glm::mat4& view, const glm::vec3& world) {
+				auto projected = cameraProjectionMatrix * view * glm::vec4(world, 1.0f);
+				projected /= projected.w;
+				return glm::vec2{
+					(float)cameraWidth * (projected.x + 1.0f) / 2.0f
+					, (float)cameraHeight * (1.0f - projected.y) / 2.0f
+				};
+			};
+
+			// Markers on the floor and walls, facing into the room
+			vector<glm::mat4> markerTransforms;
+			for (size_t i = 0; i < markerCount; i++) {
+				glm::vec3 position, markerNormal;
+				switch (random() % 5) {
+				case 0:
+					position = { uniform(-1, 1) * roomSize.x / 2, 0, uniform(-1, 1) * roomSize.z / 2 };
+					markerNormal = { 0, 1, 0 };
+					break;
+				case 1:
+					position = { -roomSize.x / 2, uniform(0.2f, roomSize.y), uniform(-1, 1) * roomSize.z / 2 };
+					markerNormal = { 1, 0, 0 };
+					break;
+				case 2:
+					position = { roomSize.x / 2, uniform(0.2f, roomSize.y), uniform(-1, 1) * roomSize.z / 2 };
+					markerNormal = { -1, 0, 0 };
+					break;
+				case 3:
+					position = { uniform(-1, 1) * roomSize.x / 2, uniform(0.2f, roomSize.y), -roomSize.z / 2 };
+					markerNormal = { 0, 0, 1 };
+					break;
+				default:
+					position = { uniform(-1, 1) * roomSize.x / 2, uniform(0.2f, roomSize.y), roomSize.z / 2 };
+					markerNormal = { 0, 0, -1 };
+					break;
+				}
+
+				// Random spin about the normal
+				auto tangent = glm::normalize(glm::cross(markerNormal, abs(markerNormal.y) > 0.5f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0)));
+				auto bitangent = glm::cross(markerNormal, tangent);
+				auto spin = uniform(0, glm::two_pi<float>());
+				auto x = tangent * cos(spin) + bitangent * sin(spin);
+				auto y = glm::cross(markerNormal, x);
+
+				glm::mat4 transform(1.0f);
+				transform[0] = glm::vec4(x, 0);
+				transform[1] = glm::vec4(y, 0);
+				transform[2] = glm::vec4(markerNormal, 0);
+				transform[3] = glm::vec4(position, 1);
+				markerTransforms.push_back(transform);
+			}
+
+			// Views from inside the room, each looking at a marker. Keep the ones which see enough markers
+			vector<glm::mat4> viewTransforms;
+			vector<Image> images;
+			vector<bool> outliers;
+			for (size_t attempt = 0; attempt < viewCount * 20 && viewTransforms.size() < viewCount; attempt++) {
+				glm::vec3 position{ uniform(-0.4f, 0.4f) * roomSize.x, uniform(1.0f, 2.5f), uniform(-0.4f, 0.4f) * roomSize.z };
+				const auto& target = markerTransforms[random() % markerTransforms.size()];
+				auto direction = glm::normalize(glm::vec3(target[3]) - position);
+				if (abs(direction.y) > 0.95f) {
+					continue;
+				}
+				auto view = glm::lookAt(position, glm::vec3(target[3]), glm::vec3(0, 1, 0));
+
+				vector<Image> viewImages;
+				vector<bool> viewOutliers;
+				for (size_t markerIndex = 0; markerIndex < markerTransforms.size(); markerIndex++) {
+					const auto& markerTransform = markerTransforms[markerIndex];
+
+					// Facing the camera
+					auto toCamera = glm::normalize(position - glm::vec3(markerTransform[3]));
+					if (glm::dot(toCamera, glm::vec3(markerTransform[2])) < 0.25f) {
+						continue;
+					}
+
+					Image image;
+					image.objectIndex = markerIndex;
+					bool visible = true;
+					for (const auto& corner : markerCorners) {
+						auto world = glm::vec3(markerTransform * glm::vec4(corner, 1.0f));
+						if ((view * glm::vec4(world, 1.0f)).z > -0.1f) {
+							visible = false;
+							break;
+						}
+						auto imagePoint = project(view, world);
+						if (imagePoint.x < 10 || imagePoint.y < 10 || imagePoint.x > cameraWidth - 10 || imagePoint.y > cameraHeight - 10) {
+							visible = false;
+							break;
+						}
+						image.imagePointsUndistorted.push_back(imagePoint);
+					}
+					if (!visible) {
+						continue;
+					}
+
+					bool outlier = uniform(0, 1) < outlierFraction;
+					for (auto& imagePoint : image.imagePointsUndistorted) {
+						imagePoint += glm::vec2(normal(noise), normal(noise));
+						if (outlier) {
+							imagePoint += glm::vec2(uniform(-outlierSize, outlierSize), uniform(-outlierSize, outlierSize));
+						}
+					}
+					viewImages.push_back(image);
+					viewOutliers.push_back(outlier);
+				}
+
+				if (viewImages.size() < 4) {
+					continue;
+				}
+				for (auto& image : viewImages) {
+					image.viewIndex = viewTransforms.size();
+					images.push_back(image);
+				}
+				outliers.insert(outliers.end(), viewOutliers.begin(), viewOutliers.end());
+				viewTransforms.push_back(view);
+			}
+
+			if (viewTransforms.empty()) {
+				throw(ofxRulr::Exception("No views see enough markers"));
+			}
+
+			// Truth, and a perturbed initial solution with the first seen marker fixed
+			Solution truth;
+			for (const auto& view : viewTransforms) {
+				truth.views.push_back(getTransform(view));
+			}
+			for (const auto& markerTransform : markerTransforms) {
+				truth.objects.push_back(getTransform(markerTransform));
+			}
+
+			vector<int> fixedObjectIndices{ images.front().objectIndex };
+			auto initialSolution = truth;
+			auto perturb = [&](Solution::Transform& transform) {
+				transform.rotation += glm::vec3(normal(0.01f), normal(0.01f), normal(0.01f));
+				transform.translation += glm::vec3(normal(0.02f), normal(0.02f), normal(0.02f));
+			};
+			for (auto& view : initialSolution.views) {
+				perturb(view);
+			}
+			for (int i = 0; i < initialSolution.objects.size(); i++) {
+				if (i != fixedObjectIndices.front()) {
+					perturb(initialSolution.objects[i]);
+				}
+			}
+
+			vector<vector<glm::vec3>> objectPoints(markerTransforms.size(), markerCorners);
+
+			stringstream report;
+			report << markerCount << " markers, " << viewTransforms.size() << " views, " << images.size() << " images ("
+				<< noise << "px noise, " << outlierFraction * 100.0f << "% outliers), "
+				<< solverSettings.options.num_threads << " threads" << endl;
+
+			// Check the analytic Jacobian against the automatic one on the initial solution
+			{
+				const auto& image = images.front();
+
+				auto toParameters = [](const Solution::Transform& transform) {
+					return vector<double>{ transform.rotation[0], transform.rotation[1], transform.rotation[2]
+						, transform.translation[0], transform.translation[1], transform.translation[2] };
+				};
+				auto viewParameters = toParameters(initialSolution.views[image.viewIndex]);
+				auto objectParameters = toParameters(initialSolution.objects[image.objectIndex]);
+
+				auto relativeDifference = compareJacobians(cameraWidth
+					, cameraHeight
+					, cameraProjectionMatrix
+					, image.imagePointsUndistorted
+					, objectPoints[image.objectIndex]
+					, viewParameters.data()
+					, objectParameters.data());
+				report << "Analytic vs automatic Jacobian : relative difference " << relativeDifference << endl;
+
+				if (!(relativeDifference <= jacobianTolerance)) {
+					throw(ofxRulr::Exception("Analytic Jacobian doesn't match the automatic one (relative difference "
+						+ ofToString(relativeDifference) + " > " + ofToString(jacobianTolerance) + ")"));
+				}
+			}
+
+			report << "Linear solver\tJacobian\tLoss\tTime [s]\tConverged\tInlier error [px]\tMarker position error [mm]" << endl;
+
+			const vector<pair<LinearSolver, string>> linearSolvers{
+				{ LinearSolver::DenseSchur, "Dense Schur" }
+				, { LinearSolver::SparseSchur, "Sparse Schur" }
+				, { LinearSolver::IterativeSchur, "Iterative Schur" }
+			};
+
+			// Without and with a robust loss (Huber unless another is selected)
+			vector<pair<LossFunction, string>> lossFunctions{ { LossFunction::None, "None" } };
+			switch (problemSettings.lossFunction.get()) {
+			case LossFunction::Cauchy:
+				lossFunctions.push_back({ LossFunction::Cauchy, "Cauchy" });
+				break;
+			case LossFunction::SoftL1:
+				lossFunctions.push_back({ LossFunction::SoftL1, "Soft L1" });
+				break;
+			default:
+				lossFunctions.push_back({ LossFunction::Huber, "Huber" });
+				break;
+			}
+
+			auto benchmarkSolverSettings = solverSettings;
+			benchmarkSolverSettings.printReport = false;
+
+			for (auto linearSolver : linearSolvers) {
+				for (auto analyticJacobian : { false, true }) {
+					for (auto lossFunction : lossFunctions) {
+						auto runProblemSettings = problemSettings;
+						runProblemSettings.linearSolver = linearSolver.first;
+						runProblemSettings.analyticJacobian = analyticJacobian;
+						runProblemSettings.lossFunction = lossFunction.first;
+
+						auto startTime = chrono::high_resolution_clock::now();
+						auto result = solve(cameraWidth
+							, cameraHeight
+							, cameraProjectionMatrix
+							, objectPoints
+							, images
+							, fixedObjectIndices
+							, initialSolution
+							, benchmarkSolverSettings
+							, runProblemSettings);
+						chrono::duration<float> duration = chrono::high_resolution_clock::now() - startTime;
+
+						float inlierError = 0.0f;
+						size_t inlierCount = 0;
+						set<int> seenObjects;
+						for (size_t i = 0; i < images.size(); i++) {
+							seenObjects.insert(images[i].objectIndex);
+							if (!outliers[i]) {
+								inlierError += result.solution.reprojectionErrorPerImage[i];
+								inlierCount++;
+							}
+						}
+
+						float positionError = 0.0f;
+						for (auto objectIndex : seenObjects) {
+							positionError += glm::distance(result.solution.objects[objectIndex].translation
+								, truth.objects[objectIndex].translation);
+						}
+
+						report << linearSolver.second
+							<< "\t" << (analyticJacobian ? "Analytic" : "Automatic")
+							<< "\t" << lossFunction.second
+							<< "\t" << duration.count()
+							<< "\t" << result.isConverged()
+							<< "\t" << inlierError / (float)max<size_t>(inlierCount, 1)
+							<< "\t" << positionError / (float)max<size_t>(seenObjects.size(), 1) * 1000.0f << endl;
+					}
+				}
+			}
+
+			return report.str();
+		}
+
 		//----------
 		MarkerProjections::Solution::Transform
 			MarkerProjections::getTransform(const glm::mat4& matrix)
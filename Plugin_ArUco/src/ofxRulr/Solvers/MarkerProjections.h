@@ -1,5 +1,6 @@
 #pragma once
 #include "ofxCeres.h"
+#include "ofxCvGui/Utils/Enum.h"
 #include <glm/glm.hpp>
 
 namespace ofxRulr {
@@ -28,6 +29,23 @@ namespace ofxRulr {
 
 			typedef ofxCeres::Result<Solution> Result;
 
+			// Dense Schur is fastest for small maps but its cost grows with the cube of the view count.
+			// Auto picks dense for small maps and sparse (or iterative if there's no sparse library) for large ones
+			MAKE_ENUM(LinearSolver
+				, (Auto, DenseSchur, SparseSchur, IterativeSchur)
+				, ("Auto", "Dense Schur", "Sparse Schur", "Iterative Schur"));
+
+			MAKE_ENUM(LossFunction
+				, (None, Huber, Cauchy, SoftL1)
+				, ("None", "Huber", "Cauchy", "Soft L1"));
+
+			struct ProblemSettings {
+				LinearSolver linearSolver = LinearSolver::Auto; ///< Overrides the linear solver in the solver settings
+				LossFunction lossFunction = LossFunction::None;
+				float lossScale = 2.0f; ///< [px] Corner error beyond which an image's observation of a marker is down-weighted
+				bool analyticJacobian = true;
+			};
+
 			static ofxCeres::SolverSettings defaultSolverSettings();
 
 			static Result solve(int cameraWidth
@@ -37,7 +55,15 @@ namespace ofxRulr {
 				, const vector<Image>& images
 				, const vector<int>& fixedObjectIndices
 				, const Solution& initialSolution
-				, const ofxCeres::SolverSettings& solverSettings = defaultSolverSettings());
+				, const ofxCeres::SolverSettings& solverSettings = defaultSolverSettings()
+				, const ProblemSettings& problemSettings = ProblemSettings());
+
+			/// Solve a synthetic marker map (markers on the walls and floor of a room, seen by views from inside
+			/// it, with noise and some outliers) with each linear solver and cost function. Returns a report
+			static string benchmark(size_t markerCount
+				, size_t viewCount
+				, const ofxCeres::SolverSettings& solverSettings = defaultSolverSettings()
+				, const ProblemSettings& problemSettings = ProblemSettings());
 
 			static Solution::Transform getTransform(const glm::mat4&);
 			static glm::mat4 getTransform(const Solution::Transform&);
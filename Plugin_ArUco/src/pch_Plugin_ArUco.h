@@ -15,6 +15,7 @@
 #include "ofxRulr/Nodes/ArUco/FindMarkers.h"
 #include "ofxRulr/Nodes/ArUco/MarkerMap.h"
 #include "ofxRulr/Nodes/ArUco/MarkerMapPoseTracker.h"
+#include "ofxRulr/Nodes/ArUco/MarkerTracker.h"
 #include "ofxRulr/Nodes/ArUco/OSCRelay.h"
 
 #include "ofxRulr/Nodes/MarkerMap/Markers.h"
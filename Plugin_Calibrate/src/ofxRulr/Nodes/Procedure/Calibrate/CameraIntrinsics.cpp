@@ -6,6 +6,7 @@
 #include "ofxRulr/Nodes/Item/Camera.h"
 
 #include "ofxRulr/Utils/ScopedProcess.h"
+#include "ofxRulr/Utils/BatchImport.h"
 
 #include "ofConstants.h"
 #include "ofxCvGui.h"
@@ -289,52 +290,67 @@ namespace ofxRulr {
 						, camera->getCameraMatrix()
 						, camera->getDistortionCoefficients());
 
-					{
-						auto capture = make_shared<Capture>();
-						capture->pointsImageSpace = imagePoints;
-						capture->pointsObjectSpace = objectPoints;
-						capture->imageWidth = camera->getWidth();
-						capture->imageHeight = camera->getHeight();
-						this->captures.add(capture);
-					}
+					this->addCapture(imagePoints, objectPoints);
 				}
 
 				//----------
-				void CameraIntrinsics::addFolder(const std::filesystem::path & path) {
-
-					//get list of files
-					vector<string> filePaths;
-					for (std::filesystem::directory_iterator it(path)
-						; it != std::filesystem::directory_iterator()
-						; ++it) {
-						filePaths.push_back(it->path().string());
-					}
+				void CameraIntrinsics::addCapture(const vector<glm::vec2> & imagePoints, const vector<glm::vec3> & objectPoints) {
+					auto camera = this->getInput<Item::Camera>();
 
-					Utils::ScopedProcess scopedProcess("Adding folder images", true, filePaths.size());
+					auto capture = make_shared<Capture>();
+					capture->pointsImageSpace = imagePoints;
+					capture->pointsObjectSpace = objectPoints;
+					capture->imageWidth = camera->getWidth();
+					capture->imageHeight = camera->getHeight();
+					this->captures.add(capture);
+				}
 
-					//for each file in path
-					for(auto filePath : filePaths) {
-						try {
-							Utils::ScopedProcess fileScopedProcess(filePath, false);
+				//----------
+				void CameraIntrinsics::addFolder(const std::filesystem::path & path) {
+					this->throwIfMissingAConnection<Item::AbstractBoard>();
+					this->throwIfMissingAConnection<Item::Camera>();
 
-							//load image
-							auto image = cv::imread(filePath);
+					auto board = this->getInput<Item::AbstractBoard>();
+					auto camera = this->getInput<Item::Camera>();
 
-							//check it loaded
-							if (image.empty()) {
-								continue;
-							}
-							else {
-								//add it to the captures
-								this->addImage(image);
-							}
+					// Take copies here so the workers don't touch the nodes whilst finding the board
+					const auto findBoardMode = this->parameters.capture.findBoardMode.get();
+					const auto cameraMatrix = camera->getCameraMatrix().clone();
+					const auto distortionCoefficients = camera->getDistortionCoefficients().clone();
+
+					auto findBoard = [this, board, findBoardMode, cameraMatrix, distortionCoefficients](const cv::Mat & image) {
+						vector<glm::vec2> imagePoints;
+						vector<glm::vec3> objectPoints;
+
+						if (!board->findBoard(image
+							, toCv(imagePoints)
+							, toCv(objectPoints)
+							, findBoardMode
+							, cameraMatrix
+							, distortionCoefficients)) {
+							throw(ofxRulr::Exception("Board not found"));
 						}
-						RULR_CATCH_ALL_TO({
-							RULR_WARNING << e.what();
+
+						return function<void()>([this, imagePoints, objectPoints]() {
+							this->addCapture(imagePoints, objectPoints);
 						});
-					}
+					};
 
-					scopedProcess.end();
+					auto files = Utils::BatchImport::listImages(path);
+					if (findBoardMode == FindBoardMode::Assistant) {
+						// The assistant is interactive so it must run on this thread. The workers only decode the images
+						Utils::BatchImport::process(files, [findBoard](const cv::Mat & image, const std::filesystem::path &) {
+							return function<void()>([findBoard, image]() {
+								findBoard(image)();
+							});
+						});
+					}
+					else {
+						// Find boards in parallel, add the captures here in file order
+						Utils::BatchImport::process(files, [findBoard](const cv::Mat & image, const std::filesystem::path &) {
+							return findBoard(image);
+						});
+					}
 				}
 
 				//----------
@@ -55,6 +55,7 @@ namespace ofxRulr {
 				protected:
 					void populateInspector(ofxCvGui::InspectArguments &);
 					void addCapture(bool triggeredFromTetheredCapture);
+					void addCapture(const vector<glm::vec2> & imagePoints, const vector<glm::vec3> & objectPoints);
 					void findBoard();
 					void calibrate();
 
@@ -42,8 +42,9 @@ namespace ofxRulr {
 					auto view = MAKE(ofxCvGui::Panels::Image, this->dummy);
 					view->onDrawImage += [this](ofxCvGui::DrawImageArguments & args) {
 						try {
+							//only preview data which is already loaded (don't force the load on every draw)
 							auto graycodeNode = this->getInput<Scan::Graycode>();
-							if (graycodeNode) {
+							if (graycodeNode && graycodeNode->isDataSetLoaded()) {
 								auto & dataSet = graycodeNode->getDataSet();
 								if (dataSet.getHasData()) {
 									ofPushMatrix();
@@ -83,9 +84,12 @@ namespace ofxRulr {
 				//----------
 				void HomographyFromGraycode::update() {
 					auto graycodeNode = this->getInput<Scan::Graycode>();
-					if (graycodeNode) {
+					if (graycodeNode && graycodeNode->isDataSetLoaded()) {
 						this->view->setImage(graycodeNode->getDecoder().getProjectorInCamera());
 					}
+					else {
+						this->view->setImage(this->dummy);
+					}
 				}
 
 				//----------
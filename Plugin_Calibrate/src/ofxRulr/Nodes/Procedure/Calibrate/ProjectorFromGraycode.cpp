@@ -344,24 +344,20 @@ namespace ofxRulr {
 					auto capture = make_shared<Capture>();
 					{
 						Utils::ScopedProcess scopedProcessFindBoardInProjectorImage("Find sub-pixel projector coordinates on board", false);
+						const auto & cameraIndex = graycodeNode->getCameraIndex();
+
 						//build the projectorImagePoints by searching and applying homography
 						for (int i = 0; i < cameraImagePoints.size(); i++) {
 							const auto & cameraImagePoint = cameraImagePoints[i];
 
-							auto distanceThresholdSquared = this->parameters.capture.pixelSearchDistance.get();
-							distanceThresholdSquared *= distanceThresholdSquared;
-
 							vector<cv::Point2f> cameraSpace;
 							vector<cv::Point2f> projectorSpace;
 
 							//build up search area
-							for (const auto & pixel : dataSet) {
-								const auto distanceSquared = glm::length2(pixel.getCameraXY() - ofxCv::toOf(cameraImagePoint));
-								if (distanceSquared < distanceThresholdSquared) {
-									cameraSpace.push_back(ofxCv::toCv(pixel.getCameraXY()));
-									projectorSpace.push_back(ofxCv::toCv(pixel.getProjectorXY()));
-								}
-							}
+							cameraIndex.findWithinRadius(ofxCv::toOf(cameraImagePoint)
+								, this->parameters.capture.pixelSearchDistance.get()
+								, cameraSpace
+								, projectorSpace);
 
 							//if we didn't find enough data
 							if (cameraSpace.size() < 6) {
@@ -251,24 +251,20 @@ namespace ofxRulr {
 
 						{
 							Utils::ScopedProcess scopedProcessFindBoardInProjectorImage("Find sub-pixel projector coordinates on board", false);
+							const auto & cameraIndex = graycodeNode->getCameraIndex();
+
 							//build the projectorImagePoints by searching and applying homography
 							for (int i = 0; i < helperCameraImagePoints.size(); i++) {
 								const auto & helperCameraImagePoint = helperCameraImagePoints[i];
 
-								auto distanceThresholdSquared = this->parameters.capture.helperPixelsSeachDistance.get();
-								distanceThresholdSquared *= distanceThresholdSquared;
-
 								vector<cv::Point2f> cameraSpace;
 								vector<cv::Point2f> projectorSpace;
 
 								//build up search area
-								for (const auto & pixel : dataSet) {
-									const auto distanceSquared = glm::length2(pixel.getCameraXY() - ofxCv::toOf(helperCameraImagePoint));
-									if (distanceSquared < distanceThresholdSquared) {
-										cameraSpace.push_back(ofxCv::toCv(pixel.getCameraXY()));
-										projectorSpace.push_back(ofxCv::toCv(pixel.getProjectorXY()));
-									}
-								}
+								cameraIndex.findWithinRadius(ofxCv::toOf(helperCameraImagePoint)
+									, this->parameters.capture.helperPixelsSeachDistance.get()
+									, cameraSpace
+									, projectorSpace);
 
 								//if we didn't find anything
 								if (cameraSpace.empty()) {
@@ -309,8 +309,9 @@ namespace ofxRulr {
 				}
 
 				// set projector width, height
-				auto projectorWidth = graycodeNode->getDataSet().getPayloadWidth();
-				auto projectorHeight = graycodeNode->getDataSet().getPayloadHeight();
+				auto dataSetInfo = graycodeNode->getDataSetInfo();
+				auto projectorWidth = dataSetInfo.payloadWidth;
+				auto projectorHeight = dataSetInfo.payloadHeight;
 				projectorNode->setWidth(projectorWidth);
 				projectorNode->setHeight(projectorHeight);
 
@@ -0,0 +1,501 @@
+#include "pch_Plugin_MoCap.h"
+#include "Benchmark.h"
+
+namespace ofxRulr {
+	namespace Nodes {
+		namespace MoCap {
+			//----------
+			// Accepts 3x1 or 1x3, float or double
+			static cv::Vec3d toVec3d(const cv::Mat & vector) {
+				cv::Mat vectorDouble;
+				vector.convertTo(vectorDouble, CV_64F);
+				auto data = vectorDouble.reshape(1, 3);
+				return cv::Vec3d(data.at<double>(0), data.at<double>(1), data.at<double>(2));
+			}
+
+#pragma mark Report
+			//----------
+			nlohmann::json Benchmark::Report::toJson() const {
+				nlohmann::json json;
+				json["framesInjected"] = this->framesInjected;
+				json["framesTracked"] = this->framesTracked;
+				json["duration"] = this->duration;
+				json["framesPerSecond"] = this->framesPerSecond;
+				json["renderTime"] = this->renderTime;
+				json["latency"]["p50"] = this->latencyP50;
+				json["latency"]["p99"] = this->latencyP99;
+				json["latency"]["max"] = this->latencyMax;
+				json["translationError"]["mean"] = this->translationErrorMean;
+				json["translationError"]["max"] = this->translationErrorMax;
+				json["rotationError"]["mean"] = this->rotationErrorMean;
+				json["rotationError"]["max"] = this->rotationErrorMax;
+				return json;
+			}
+
+			//----------
+			string Benchmark::Report::toString() const {
+				stringstream ss;
+				ss << "Tracked " << this->framesTracked << " / " << this->framesInjected << " frames in " << this->duration << "s (" << this->framesPerSecond << " fps)" << endl;
+				ss << "Latency [ms] : p50 " << this->latencyP50 << "  p99 " << this->latencyP99 << "  max " << this->latencyMax << endl;
+				ss << "Translation error [mm] : mean " << this->translationErrorMean << "  max " << this->translationErrorMax << endl;
+				ss << "Rotation error [deg] : mean " << this->rotationErrorMean << "  max " << this->rotationErrorMax << endl;
+				ss << "Render time [ms] : " << this->renderTime;
+				return ss.str();
+			}
+
+#pragma mark Benchmark
+			//----------
+			Benchmark::Benchmark() {
+				RULR_NODE_INIT_LISTENER;
+			}
+
+			//----------
+			Benchmark::~Benchmark() {
+				this->stop();
+			}
+
+			//----------
+			string Benchmark::getTypeName() const {
+				return "MoCap::Benchmark";
+			}
+
+			//----------
+			void Benchmark::init() {
+				RULR_NODE_INSPECTOR_LISTENER;
+				RULR_NODE_UPDATE_LISTENER;
+
+				this->addInput<Body>();
+				{
+					auto input = this->addInput<Item::Camera>();
+					input->onDeleteConnection += [this](shared_ptr<Item::Camera>) {
+						this->stop();
+					};
+				}
+				{
+					auto input = this->addInput<UpdateTracking>();
+					input->onNewConnection += [this](shared_ptr<UpdateTracking> inputNode) {
+						inputNode->onNewFrame.addListener([this](shared_ptr<UpdateTrackingFrame> frame) {
+							try {
+								this->receiveTrackingFrame(frame);
+							}
+							RULR_CATCH_ALL_TO_ERROR;
+						}, this);
+					};
+					input->onDeleteConnection += [this](shared_ptr<UpdateTracking> inputNode) {
+						if (inputNode) {
+							inputNode->onNewFrame.removeListeners(this);
+						}
+					};
+				}
+
+				this->onDeserialize += [this](const nlohmann::json &) {
+					this->runOnLoadPending = true;
+				};
+
+				this->manageParameters(this->parameters);
+			}
+
+			//----------
+			void Benchmark::update() {
+				// Connections are made after the node is deserialized, so wait for them before starting
+				if (this->runOnLoadPending) {
+					if (!this->parameters.automation.runOnLoad) {
+						this->runOnLoadPending = false;
+					}
+					else if (this->getInput<Body>() && this->getInput<Item::Camera>() && this->getInput<UpdateTracking>()) {
+						this->runOnLoadPending = false;
+						try {
+							this->start();
+						}
+						RULR_CATCH_ALL_TO({
+							RULR_ERROR << e.what();
+							if (this->parameters.automation.exitWhenDone) {
+								ofExit(1);
+							}
+						});
+					}
+				}
+
+				// The benchmark thread stops by itself at the end of the run
+				if (!this->running && this->benchmarkThread.joinable()) {
+					this->benchmarkThread.join();
+					this->report = this->getReport();
+					ofLogNotice("MoCap::Benchmark") << endl << this->report.toString();
+
+					const auto & reportPath = this->parameters.automation.reportPath.get();
+					if (!reportPath.empty()) {
+						try {
+							this->saveReport(reportPath);
+						}
+						RULR_CATCH_ALL_TO_ERROR;
+					}
+
+					if (this->parameters.automation.exitWhenDone) {
+						ofExit();
+					}
+				}
+			}
+
+			//----------
+			void Benchmark::populateInspector(ofxCvGui::InspectArguments & inspectArgs) {
+				auto inspector = inspectArgs.inspector;
+
+				inspector->addButton("Start", [this]() {
+					try {
+						this->start();
+					}
+					RULR_CATCH_ALL_TO_ALERT;
+				}, ' ');
+				inspector->addButton("Stop", [this]() {
+					this->stop();
+				});
+				inspector->addIndicatorBool("Running", [this]() {
+					return this->isRunning();
+				});
+				inspector->addLiveValue<size_t>("Frames injected", [this]() {
+					return this->framesInjected.load();
+				});
+
+				inspector->addTitle("Last run", ofxCvGui::Widgets::Title::Level::H3);
+				inspector->addLiveValue<string>("Frames tracked", [this]() {
+					return ofToString(this->report.framesTracked) + " / " + ofToString(this->report.framesInjected);
+				});
+				inspector->addLiveValue<float>("Tracked frames/s", [this]() {
+					return this->report.framesPerSecond;
+				});
+				inspector->addLiveValue<string>("Latency p50 / p99 [ms]", [this]() {
+					return ofToString(this->report.latencyP50) + " / " + ofToString(this->report.latencyP99);
+				});
+				inspector->addLiveValue<string>("Translation error mean / max [mm]", [this]() {
+					return ofToString(this->report.translationErrorMean) + " / " + ofToString(this->report.translationErrorMax);
+				});
+				inspector->addLiveValue<string>("Rotation error mean / max [deg]", [this]() {
+					return ofToString(this->report.rotationErrorMean) + " / " + ofToString(this->report.rotationErrorMax);
+				});
+				inspector->addLiveValue<float>("Render time [ms]", [this]() {
+					return this->report.renderTime;
+				});
+				inspector->addButton("Save report", [this]() {
+					try {
+						auto result = ofSystemSaveDialog("benchmark.json", "Save benchmark report");
+						if (result.bSuccess) {
+							this->saveReport(result.filePath);
+						}
+					}
+					RULR_CATCH_ALL_TO_ALERT;
+				});
+			}
+
+			//----------
+			void Benchmark::start() {
+				this->stop();
+
+				this->throwIfMissingAConnection<Body>();
+				this->throwIfMissingAConnection<Item::Camera>();
+				this->throwIfMissingAConnection<UpdateTracking>();
+
+				auto body = this->getInput<Body>();
+				auto camera = this->getInput<Item::Camera>();
+
+				// Freeze the scene. The tracking will move the Body node whilst we run
+				auto scene = make_shared<Scene>();
+				scene->body = body->getBodyDescription();
+				if (!scene->body || scene->body->markerCount == 0) {
+					throw(ofxRulr::Exception("Body has no markers"));
+				}
+				scene->cameraMatrix = camera->getCameraMatrix();
+				scene->distortionCoefficients = camera->getDistortionCoefficients();
+				{
+					cv::Mat rotationVector, translation;
+					camera->getExtrinsics(rotationVector, translation, true);
+					scene->viewRotationVector = toVec3d(rotationVector);
+					scene->viewTranslation = toVec3d(translation);
+				}
+				scene->width = (int) camera->getWidth();
+				scene->height = (int) camera->getHeight();
+				if (scene->width <= 0 || scene->height <= 0) {
+					throw(ofxRulr::Exception("Camera has no image size"));
+				}
+
+				{
+					unique_lock<mutex> lock(this->resultsMutex);
+					this->inFlight.clear();
+					this->framesTracked = 0;
+					this->sumTranslationError = 0.0;
+					this->sumRotationError = 0.0;
+					this->maxTranslationError = 0.0f;
+					this->maxRotationError = 0.0f;
+					this->sumRenderTime = 0.0;
+					this->latency.clear();
+					this->startTime = Clock::now();
+					this->lastResultTime = this->startTime;
+				}
+				this->framesInjected = 0;
+				this->random.seed(0); // the same scene every run
+
+				this->running = true;
+				this->benchmarkThread = std::thread([this, scene, camera]() {
+					try {
+						this->benchmarkLoop(scene, camera);
+					}
+					RULR_CATCH_ALL_TO_ERROR;
+					this->running = false;
+				});
+			}
+
+			//----------
+			void Benchmark::stop() {
+				this->running = false;
+				if (this->benchmarkThread.joinable()) {
+					this->benchmarkThread.join();
+					this->report = this->getReport();
+				}
+			}
+
+			//----------
+			bool Benchmark::isRunning() const {
+				return this->running.load();
+			}
+
+			//----------
+			Benchmark::Report Benchmark::getReport() const {
+				unique_lock<mutex> lock(this->resultsMutex);
+
+				Report report;
+				report.framesInjected = this->framesInjected.load();
+				report.framesTracked = this->framesTracked;
+				report.duration = chrono::duration<float>(this->lastResultTime - this->startTime).count();
+				if (report.duration > 0.0f) {
+					report.framesPerSecond = (float) report.framesTracked / report.duration;
+				}
+				if (report.framesInjected > 0) {
+					report.renderTime = (float)(this->sumRenderTime / (double) report.framesInjected);
+				}
+
+				report.latencyP50 = this->latency.getPercentile(0.5f);
+				report.latencyP99 = this->latency.getPercentile(0.99f);
+				report.latencyMax = this->latency.getMax();
+
+				if (report.framesTracked > 0) {
+					report.translationErrorMean = (float)(this->sumTranslationError / (double) report.framesTracked);
+					report.rotationErrorMean = (float)(this->sumRotationError / (double) report.framesTracked);
+				}
+				report.translationErrorMax = this->maxTranslationError;
+				report.rotationErrorMax = this->maxRotationError;
+
+				return report;
+			}
+
+			//----------
+			void Benchmark::saveReport(const std::filesystem::path & path) const {
+				ofFile file(path, ofFile::WriteOnly);
+				if (!file.is_open()) {
+					throw(ofxRulr::Exception("Couldn't open " + path.string() + " for writing"));
+				}
+				file << this->report.toJson().dump(4);
+				ofLogNotice("MoCap::Benchmark") << "Report saved to " << path.string();
+			}
+
+			//----------
+			void Benchmark::benchmarkLoop(shared_ptr<Scene> scene, shared_ptr<Item::Camera> camera) {
+				const auto frameCount = (size_t) max(this->parameters.frameCount.get(), 1);
+				const auto frameRate = this->parameters.frameRate.get();
+
+				cv::Mat image;
+				int64_t lastTimestamp = -1;
+
+				for (size_t i = 0; i < frameCount && this->running; i++) {
+					// Pace the frames like a camera would
+					if (frameRate > 0.0f) {
+						const auto dueTime = this->startTime + chrono::duration_cast<Clock::duration>(chrono::duration<double>((double) i / frameRate));
+						while (this->running && Clock::now() < dueTime) {
+							this_thread::sleep_for(min<Clock::duration>(dueTime - Clock::now(), chrono::milliseconds(10)));
+						}
+					}
+
+					// Scene time follows the frame rate, or the wall clock when running flat out
+					const auto sceneTime = frameRate > 0.0f
+						? (float) i / frameRate
+						: chrono::duration<float>(Clock::now() - this->startTime).count();
+					const auto truePose = this->getTruePose(*scene, sceneTime);
+
+					const auto renderStart = Clock::now();
+					this->render(*scene, truePose, image);
+
+					auto frame = make_shared<ofxMachineVision::Frame>();
+					{
+						auto & pixels = frame->getPixels();
+						pixels.allocate(image.cols, image.rows, OF_PIXELS_GRAY);
+						auto pixelsMat = ofxCv::toCv(pixels);
+						image.copyTo(pixelsMat);
+					}
+					const auto renderTime = chrono::duration<double, milli>(Clock::now() - renderStart).count();
+
+					// The timestamp identifies the frame when it comes back out of UpdateTracking
+					const auto injectTime = Clock::now();
+					auto timestamp = chrono::duration_cast<chrono::nanoseconds>(injectTime - this->startTime).count();
+					timestamp = max(timestamp, lastTimestamp + 1);
+					lastTimestamp = timestamp;
+					frame->setTimestamp(chrono::nanoseconds(timestamp));
+					frame->setFrameIndex(i);
+
+					{
+						unique_lock<mutex> lock(this->resultsMutex);
+						this->inFlight[timestamp] = InFlight{ truePose, injectTime };
+						this->sumRenderTime += renderTime;
+					}
+					this->framesInjected++;
+
+					camera->onNewFrame.notifyListeners(frame);
+				}
+
+				// Give the last frames time to come through the chain
+				const auto drainDeadline = Clock::now() + chrono::seconds(1);
+				while (this->running && Clock::now() < drainDeadline) {
+					{
+						unique_lock<mutex> lock(this->resultsMutex);
+						if (this->inFlight.empty()) {
+							break;
+						}
+					}
+					this_thread::sleep_for(chrono::milliseconds(10));
+				}
+			}
+
+			//----------
+			Benchmark::Pose Benchmark::getTruePose(const Scene & scene, float time) const {
+				const auto period = max(this->parameters.motion.period.get(), 0.01f);
+				const auto phase = (double) time / period * TWO_PI;
+				const auto translationAmplitude = (double) this->parameters.motion.translationAmplitude.get();
+				const auto rotationAmplitude = (double) this->parameters.motion.rotationAmplitude.get() * DEG_TO_RAD;
+
+				// A Lissajous path about the rest pose, turning about the body's own Y axis
+				const cv::Vec3d deltaRotation(0, rotationAmplitude * sin(phase), 0);
+				const cv::Vec3d offset(translationAmplitude * sin(phase)
+					, translationAmplitude * 0.5 * sin(phase * 2.0)
+					, translationAmplitude * 0.25 * cos(phase));
+
+				cv::Mat rotationVector, translation;
+				cv::composeRT(cv::Mat(deltaRotation)
+					, cv::Mat(cv::Vec3d())
+					, scene.body->rotationVector
+					, scene.body->translation
+					, rotationVector
+					, translation);
+
+				Pose pose;
+				pose.rotationVector = toVec3d(rotationVector);
+				pose.translation = toVec3d(translation) + offset;
+				return pose;
+			}
+
+			//----------
+			void Benchmark::render(const Scene & scene, const Pose & pose, cv::Mat & image) {
+				const auto & rendering = this->parameters.rendering;
+
+				image.create(scene.height, scene.width, CV_8UC1);
+				cv::randn(image, rendering.background.get(), rendering.noise.get());
+
+				// Body -> camera
+				cv::Mat modelViewRotationVector, modelViewTranslation;
+				cv::composeRT(cv::Mat(pose.rotationVector)
+					, cv::Mat(pose.translation)
+					, cv::Mat(scene.viewRotationVector)
+					, cv::Mat(scene.viewTranslation)
+					, modelViewRotationVector
+					, modelViewTranslation);
+				cv::Matx33d modelViewRotation;
+				cv::Rodrigues(toVec3d(modelViewRotationVector), modelViewRotation);
+				const auto modelViewTranslationVector = toVec3d(modelViewTranslation);
+
+				const auto & positions = scene.body->markers.positions;
+				this->objectPoints.resize(positions.size());
+				for (size_t i = 0; i < positions.size(); i++) {
+					this->objectPoints[i] = cv::Point3f(positions[i].x, positions[i].y, positions[i].z);
+				}
+				cv::projectPoints(this->objectPoints
+					, modelViewRotationVector
+					, modelViewTranslation
+					, scene.cameraMatrix
+					, scene.distortionCoefficients
+					, this->imagePoints);
+
+				const auto focalLength = scene.cameraMatrix.at<double>(0, 0);
+				const auto markerBrightness = rendering.markerBrightness.get();
+				const auto occlusionProbability = rendering.occlusionProbability.get();
+				uniform_real_distribution<float> occlusion(0.0f, 1.0f);
+
+				// Anti-aliased discs with sub-pixel centres
+				const int shift = 4;
+				const float scale = (float)(1 << shift);
+				for (size_t i = 0; i < this->objectPoints.size(); i++) {
+					const auto occluded = occlusion(this->random) < occlusionProbability;
+
+					const auto cameraSpace = modelViewRotation * cv::Vec3d(this->objectPoints[i]) + modelViewTranslationVector;
+					if (cameraSpace[2] <= 0.0 || occluded) {
+						continue;
+					}
+
+					const auto & imagePoint = this->imagePoints[i];
+					if (imagePoint.x < 0 || imagePoint.y < 0 || imagePoint.x >= scene.width || imagePoint.y >= scene.height) {
+						continue;
+					}
+
+					const auto radius = max(focalLength * scene.body->markerDiameter / 2.0 / cameraSpace[2], 0.5);
+					cv::circle(image
+						, cv::Point((int) (imagePoint.x * scale), (int) (imagePoint.y * scale))
+						, (int) (radius * scale)
+						, cv::Scalar(markerBrightness)
+						, cv::FILLED
+						, cv::LINE_AA
+						, shift);
+				}
+			}
+
+			//----------
+			void Benchmark::receiveTrackingFrame(shared_ptr<UpdateTrackingFrame> frame) {
+				if (!frame->incomingFrame
+					|| !frame->incomingFrame->incomingFrame
+					|| !frame->incomingFrame->incomingFrame->imageFrame) {
+					return;
+				}
+				const auto timestamp = frame->incomingFrame->incomingFrame->imageFrame->getTimestamp().count();
+				const auto now = Clock::now();
+
+				unique_lock<mutex> lock(this->resultsMutex);
+
+				auto findInFlight = this->inFlight.find(timestamp);
+				if (findInFlight == this->inFlight.end()) {
+					// Not one of ours (or from a previous run)
+					return;
+				}
+				const auto inFlight = findInFlight->second;
+				this->inFlight.erase(findInFlight);
+
+				// Forget frames which were dropped or failed somewhere along the chain
+				while (!this->inFlight.empty() && now - this->inFlight.begin()->second.injectTime > chrono::seconds(2)) {
+					this->inFlight.erase(this->inFlight.begin());
+				}
+
+				this->latency.add(chrono::duration<float, milli>(now - inFlight.injectTime).count());
+
+				// Compare with the true pose of the body in world space
+				const auto translationError = (float) cv::norm(toVec3d(frame->modelTranslation) - inFlight.truePose.translation) * 1000.0f;
+
+				cv::Matx33d trueRotation, trackedRotation;
+				cv::Rodrigues(inFlight.truePose.rotationVector, trueRotation);
+				cv::Rodrigues(toVec3d(frame->modelRotationVector), trackedRotation);
+				cv::Vec3d deltaRotation;
+				cv::Rodrigues(trueRotation.t() * trackedRotation, deltaRotation);
+				const auto rotationError = (float) (cv::norm(deltaRotation) * RAD_TO_DEG);
+
+				this->framesTracked++;
+				this->sumTranslationError += translationError;
+				this->sumRotationError += rotationError;
+				this->maxTranslationError = max(this->maxTranslationError, translationError);
+				this->maxRotationError = max(this->maxRotationError, rotationError);
+				this->lastResultTime = now;
+			}
+		}
+	}
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "ofxRulr/Nodes/Base.h"
+#include "ofxRulr/Nodes/Item/Camera.h"
+#include "ofxRulr/Utils/LatencyHistogram.h"
+
+#include "Body.h"
+#include "UpdateTracking.h"
+
+namespace ofxRulr {
+	namespace Nodes {
+		namespace MoCap {
+			/// Measures the tracking chain against a synthetic scene. Renders images of the Body's markers
+			/// moving along a known path, injects them into the Camera node (so they run through
+			/// FindMarkerCentroids -> MatchMarkers -> UpdateTracking exactly as live frames would)
+			/// and compares what comes out of UpdateTracking with the path.
+			class Benchmark : public Nodes::Base {
+			public:
+				struct Report {
+					size_t framesInjected = 0;
+					size_t framesTracked = 0;
+					float duration = 0.0f; // [s]
+					float framesPerSecond = 0.0f; // tracked frames
+					float renderTime = 0.0f; // mean [ms]
+
+					float latencyP50 = 0.0f; // [ms] injected -> UpdateTracking output
+					float latencyP99 = 0.0f;
+					float latencyMax = 0.0f;
+
+					float translationErrorMean = 0.0f; // [mm]
+					float translationErrorMax = 0.0f;
+					float rotationErrorMean = 0.0f; // [deg]
+					float rotationErrorMax = 0.0f;
+
+					nlohmann::json toJson() const;
+					string toString() const;
+				};
+
+				Benchmark();
+				~Benchmark();
+				string getTypeName() const override;
+				void init();
+				void update();
+				void populateInspector(ofxCvGui::InspectArguments &);
+
+				void start();
+				void stop();
+				bool isRunning() const;
+				Report getReport() const;
+				void saveReport(const std::filesystem::path &) const;
+			protected:
+				typedef chrono::high_resolution_clock Clock;
+
+				struct Pose {
+					cv::Vec3d rotationVector; // object -> world
+					cv::Vec3d translation;
+				};
+
+				struct Scene {
+					shared_ptr<Body::Description> body; // at rest (frozen when the benchmark starts)
+					cv::Mat cameraMatrix;
+					cv::Mat distortionCoefficients;
+					cv::Vec3d viewRotationVector; // world -> camera
+					cv::Vec3d viewTranslation;
+					int width;
+					int height;
+				};
+
+				void benchmarkLoop(shared_ptr<Scene>, shared_ptr<Item::Camera>);
+				Pose getTruePose(const Scene &, float time) const;
+				void render(const Scene &, const Pose &, cv::Mat & image);
+				void receiveTrackingFrame(shared_ptr<UpdateTrackingFrame>);
+
+				struct : ofParameterGroup {
+					ofParameter<int> frameCount{ "Frame count", 1000 };
+					ofParameter<float> frameRate{ "Frame rate [Hz] (0 = max)", 120 };
+
+					struct : ofParameterGroup {
+						ofParameter<float> translationAmplitude{ "Translation amplitude [m]", 0.2f };
+						ofParameter<float> rotationAmplitude{ "Rotation amplitude [deg]", 30.0f };
+						ofParameter<float> period{ "Period [s]", 4.0f };
+						PARAM_DECLARE("Motion", translationAmplitude, rotationAmplitude, period);
+					} motion;
+
+					struct : ofParameterGroup {
+						ofParameter<float> background{ "Background", 10, 0, 255 };
+						ofParameter<float> markerBrightness{ "Marker brightness", 220, 0, 255 };
+						ofParameter<float> noise{ "Noise (sigma)", 4, 0, 64 };
+						ofParameter<float> occlusionProbability{ "Occlusion probability", 0.05f, 0.0f, 1.0f };
+						PARAM_DECLARE("Rendering", background, markerBrightness, noise, occlusionProbability);
+					} rendering;
+
+					// For running unattended (e.g. a CI job which opens a saved patch and compares the reports)
+					struct : ofParameterGroup {
+						ofParameter<bool> runOnLoad{ "Run on load", false };
+						ofParameter<string> reportPath{ "Report path", "" }; // written after each run if set
+						ofParameter<bool> exitWhenDone{ "Exit when done", false };
+						PARAM_DECLARE("Automation", runOnLoad, reportPath, exitWhenDone);
+					} automation;
+
+					PARAM_DECLARE("Benchmark", frameCount, frameRate, motion, rendering, automation);
+				} parameters;
+
+				std::thread benchmarkThread;
+				std::mt19937 random; // benchmark thread only
+				vector<cv::Point3f> objectPoints; // benchmark thread only
+				vector<cv::Point2f> imagePoints;
+				atomic<bool> running{ false };
+				atomic<size_t> framesInjected{ 0 };
+
+				// Frames in flight, keyed by the timestamp we gave them
+				struct InFlight {
+					Pose truePose;
+					Clock::time_point injectTime;
+				};
+
+				mutable mutex resultsMutex;
+				map<int64_t, InFlight> inFlight;
+				Clock::time_point startTime;
+				Clock::time_point lastResultTime;
+				size_t framesTracked = 0;
+				double sumTranslationError = 0.0;
+				double sumRotationError = 0.0;
+				float maxTranslationError = 0.0f;
+				float maxRotationError = 0.0f;
+				double sumRenderTime = 0.0;
+				Utils::LatencyHistogram latency;
+
+				Report report; // of the last complete run (main thread)
+				bool runOnLoadPending = false;
+			};
+		}
+	}
+}
@@ -0,0 +1,375 @@
+#include "pch_Plugin_MoCap.h"
+#include "BlobKernel.h"
+
+namespace ofxRulr {
+	namespace Nodes {
+		namespace MoCap {
+#pragma mark Union-find
+			//----------
+			inline uint32_t findRoot(vector<uint32_t> & parents, uint32_t index) {
+				while (parents[index] != index) {
+					parents[index] = parents[parents[index]];
+					index = parents[index];
+				}
+				return index;
+			}
+
+			//----------
+			inline void unite(vector<uint32_t> & parents, uint32_t a, uint32_t b) {
+				a = findRoot(parents, a);
+				b = findRoot(parents, b);
+				if (a < b) {
+					parents[b] = a;
+				}
+				else if (b < a) {
+					parents[a] = b;
+				}
+			}
+
+			//----------
+			// Unite the runs of one row with the touching (8-connected) runs of the row above
+			inline void uniteRows(vector<uint32_t> & parents
+				, const BlobKernel::Workspace::Run * rowAbove, uint32_t rowAboveIndex, uint32_t rowAboveCount
+				, const BlobKernel::Workspace::Run * row, uint32_t rowIndex, uint32_t rowCount) {
+				uint32_t j = 0;
+				for (uint32_t i = 0; i < rowCount; i++) {
+					const auto & run = row[i];
+					while (j < rowAboveCount && rowAbove[j].x1 < run.x0) {
+						j++;
+					}
+					for (auto k = j; k < rowAboveCount && rowAbove[k].x0 <= run.x1; k++) {
+						unite(parents, rowIndex + i, rowAboveIndex + k);
+					}
+				}
+			}
+
+#pragma mark BlobKernel
+			//----------
+			BlobKernel::BlobKernel(size_t threadCount) {
+				// Tiles run on the shared pool, so this only limits how finely we split each frame
+				if (threadCount == 0) {
+					threadCount = Utils::ThreadPool::X().getPoolSize();
+				}
+				this->threadCount = threadCount;
+			}
+
+			//----------
+			void BlobKernel::process(const cv::Mat & image
+				, cv::Mat & difference
+				, cv::Mat & binary
+				, const Settings & settings
+				, Workspace & workspace
+				, vector<Blob> & blobs) {
+				if (image.type() != CV_8UC1) {
+					throw(ofxRulr::Exception("BlobKernel requires an 8-bit grayscale image"));
+				}
+
+				blobs.clear();
+
+				// create() keeps the existing storage when the size matches
+				difference.create(image.size(), CV_8UC1);
+				binary.create(image.size(), CV_8UC1);
+
+				const auto rows = image.rows;
+				if (rows == 0 || image.cols == 0) {
+					return;
+				}
+
+				// Split into horizontal tiles (one per thread, but small images such as search windows stay in this thread)
+				{
+					const int minimumTileHeight = 16;
+					const int minimumTilePixels = 1 << 16;
+					auto tileCount = (int) min(this->threadCount, (size_t) max(rows * image.cols / minimumTilePixels, 1));
+					auto tileHeight = max((rows + tileCount - 1) / tileCount, minimumTileHeight);
+					tileCount = (rows + tileHeight - 1) / tileHeight;
+
+					workspace.tiles.resize(tileCount);
+					for (int i = 0; i < tileCount; i++) {
+						auto & tile = workspace.tiles[i];
+						tile.y0 = i * tileHeight;
+						tile.y1 = min(tile.y0 + tileHeight, rows);
+					}
+				}
+
+				// Difference, threshold and label each tile
+				{
+					vector<function<void()>> actions;
+					for (auto & tile : workspace.tiles) {
+						actions.push_back([&image, &difference, &binary, &settings, &tile]() {
+							BlobKernel::processTile(image, difference, binary, settings, tile);
+						});
+					}
+
+					// Several frames may be in flight at once (each ThreadedProcessNode worker calls process).
+					// This thread works through the tiles too, and returns once every tile is done
+					Utils::ThreadPool::X().performBatch(actions);
+				}
+
+				// Join the tile labels into one union-find over all runs
+				auto & parents = workspace.parents;
+				{
+					size_t runCount = 0;
+					for (const auto & tile : workspace.tiles) {
+						runCount += tile.runs.size();
+					}
+					parents.resize(runCount);
+
+					uint32_t offset = 0;
+					for (auto & tile : workspace.tiles) {
+						auto localCount = (uint32_t) tile.runs.size();
+						for (uint32_t i = 0; i < localCount; i++) {
+							parents[offset + i] = offset + findRoot(tile.parents, i);
+						}
+						offset += localCount;
+					}
+
+					// Stitch the seams between neighbouring tiles
+					offset = 0;
+					for (size_t t = 1; t < workspace.tiles.size(); t++) {
+						const auto & tileAbove = workspace.tiles[t - 1];
+						const auto & tile = workspace.tiles[t];
+
+						auto lastRowStart = tileAbove.rowStarts[tileAbove.rowStarts.size() - 2];
+						auto lastRowCount = tileAbove.rowStarts.back() - lastRowStart;
+						auto tileOffset = offset + (uint32_t) tileAbove.runs.size();
+						auto firstRowCount = tile.rowStarts[1];
+
+						uniteRows(parents
+							, tileAbove.runs.data() + lastRowStart, offset + lastRowStart, lastRowCount
+							, tile.runs.data(), tileOffset, firstRowCount);
+
+						offset = tileOffset;
+					}
+				}
+
+				// Accumulate the runs into blobs
+				{
+					auto & blobIndices = workspace.blobIndices;
+					blobIndices.assign(parents.size(), -1);
+
+					uint32_t runIndex = 0;
+					for (const auto & tile : workspace.tiles) {
+						for (const auto & run : tile.runs) {
+							auto root = findRoot(parents, runIndex++);
+							auto & blobIndex = blobIndices[root];
+							if (blobIndex == -1) {
+								blobIndex = (int32_t) blobs.size();
+								Blob blob;
+								blob.boundingRect = cv::Rect(run.x0, run.y, 0, 0);
+								blobs.push_back(blob);
+							}
+							auto & blob = blobs[blobIndex];
+
+							// Bounding rect stored as (x0, y0, x1, y1) until the end
+							auto & rect = blob.boundingRect;
+							rect.x = min(rect.x, run.x0);
+							rect.y = min(rect.y, run.y);
+							rect.width = max(rect.width, run.x1);
+							rect.height = max(rect.height, run.y + 1);
+
+							blob.area += run.x1 - run.x0;
+							blob.m00 += (double) run.sumI;
+							blob.m10 += (double) run.sumXI;
+							blob.m01 += (double) run.sumI * run.y;
+
+							// Perimeter : both ends of a run are on the boundary, and so is any pixel with background above or below
+							{
+								const uchar * above = run.y > 0 ? binary.ptr<uchar>(run.y - 1) : nullptr;
+								const uchar * below = run.y + 1 < binary.rows ? binary.ptr<uchar>(run.y + 1) : nullptr;
+								uint32_t perimeter = 0;
+								for (int x = run.x0; x < run.x1; x++) {
+									if (x == run.x0
+										|| x == run.x1 - 1
+										|| !above || !above[x]
+										|| !below || !below[x]) {
+										perimeter++;
+									}
+								}
+								blob.perimeter += perimeter;
+							}
+						}
+					}
+
+					for (auto & blob : blobs) {
+						auto & rect = blob.boundingRect;
+						rect.width -= rect.x;
+						rect.height -= rect.y;
+					}
+				}
+			}
+
+			//----------
+			int BlobKernel::getEquivalentBoxSize(int blurSize) {
+				// Follow the sequence of blurs made by the contour method and sum their variances
+				vector<int> passes;
+				passes.push_back(blurSize / 2);
+				blurSize /= 2;
+				while (blurSize > 1) {
+					if (blurSize <= 32) {
+						passes.push_back(blurSize);
+						break;
+					}
+					passes.push_back(blurSize / 2);
+					blurSize /= 2;
+				}
+
+				float sumOfSquares = 0.0f;
+				for (auto pass : passes) {
+					sumOfSquares += (float) (pass * pass);
+				}
+				return (int) (sqrt(sumOfSquares) + 0.5f);
+			}
+
+			//----------
+			void BlobKernel::processTile(const cv::Mat & image
+				, cv::Mat & difference
+				, cv::Mat & binary
+				, const Settings & settings
+				, Workspace::Tile & tile) {
+				const auto cols = image.cols;
+				const auto rows = image.rows;
+				const auto radius = max(settings.boxSize / 2, 0);
+				const auto amplify = settings.amplify;
+				const auto threshold = settings.threshold;
+
+				tile.runs.clear();
+				tile.rowStarts.clear();
+
+				// Column sums over the rows in the vertical window [windowTop, windowBottom]
+				auto & columnSums = tile.columnSums;
+				columnSums.assign(cols, 0);
+				auto windowTop = max(tile.y0 - radius, 0);
+				auto windowBottom = min(tile.y0 + radius, rows - 1);
+				for (int y = windowTop; y <= windowBottom; y++) {
+					const auto row = image.ptr<uchar>(y);
+					for (int x = 0; x < cols; x++) {
+						columnSums[x] += row[x];
+					}
+				}
+
+				// Width of the horizontal window at each column (narrower at the image edges)
+				auto & columnReciprocals = tile.columnReciprocals;
+				columnReciprocals.resize(cols);
+				for (int x = 0; x < cols; x++) {
+					columnReciprocals[x] = 1.0f / (float) (min(x + radius, cols - 1) - max(x - radius, 0) + 1);
+				}
+
+				auto & boxSums = tile.boxSums;
+				boxSums.resize(cols);
+
+				for (int y = tile.y0; y < tile.y1; y++) {
+					const auto imageRow = image.ptr<uchar>(y);
+					auto differenceRow = difference.ptr<uchar>(y);
+					auto binaryRow = binary.ptr<uchar>(y);
+
+					// Running sum along the row gives the box sums (a serial dependency, so kept to adds only)
+					{
+						const auto columnSumsData = columnSums.data();
+						auto boxSumsData = boxSums.data();
+						int32_t sum = 0;
+						for (int x = 0; x <= min(radius, cols - 1); x++) {
+							sum += columnSumsData[x];
+						}
+
+						// Split at the edges so the inner loop has no branches
+						const auto growEnd = min(cols, max(cols - radius - 1, 0));
+						const auto shrinkStart = min(radius, cols);
+						int x = 0;
+						for (; x < min(growEnd, shrinkStart); x++) {
+							boxSumsData[x] = sum;
+							sum += columnSumsData[x + radius + 1];
+						}
+						for (; x < growEnd; x++) {
+							boxSumsData[x] = sum;
+							sum += columnSumsData[x + radius + 1];
+							sum -= columnSumsData[x - radius];
+						}
+						for (; x < shrinkStart; x++) {
+							boxSumsData[x] = sum;
+						}
+						for (; x < cols; x++) {
+							boxSumsData[x] = sum;
+							sum -= columnSumsData[x - radius];
+						}
+					}
+
+					// Difference and threshold (no dependencies between pixels, so this vectorises)
+					{
+						const auto boxSumsData = boxSums.data();
+						const auto columnReciprocalsData = columnReciprocals.data();
+						const auto rowReciprocal = 1.0f / (float) (windowBottom - windowTop + 1);
+						for (int x = 0; x < cols; x++) {
+							const auto mean = (int) ((float) boxSumsData[x] * columnReciprocalsData[x] * rowReciprocal + 0.5f);
+							auto value = (int) ((float) ((int) imageRow[x] - mean) * amplify + 0.5f);
+							const auto result = (uchar) min(max(value, 0), 255);
+
+							differenceRow[x] = result;
+							binaryRow[x] = result > threshold ? 255 : 0;
+						}
+					}
+
+					// Runs of foreground with their intensity sums
+					tile.rowStarts.push_back((uint32_t) tile.runs.size());
+					for (int x = 0; x < cols; ) {
+						// Skip background 8 pixels at a time
+						if (x + 8 <= cols) {
+							uint64_t word;
+							memcpy(&word, binaryRow + x, sizeof(word));
+							if (word == 0) {
+								x += 8;
+								continue;
+							}
+						}
+						if (!binaryRow[x]) {
+							x++;
+							continue;
+						}
+
+						Workspace::Run run{ y, x, x, 0, 0 };
+						for (; x < cols && binaryRow[x]; x++) {
+							run.sumI += imageRow[x];
+							run.sumXI += (uint64_t) imageRow[x] * x;
+						}
+						run.x1 = x;
+						tile.runs.push_back(run);
+					}
+
+					// Slide the vertical window down
+					if (y + radius + 1 < rows) {
+						const auto row = image.ptr<uchar>(y + radius + 1);
+						for (int x = 0; x < cols; x++) {
+							columnSums[x] += row[x];
+						}
+						windowBottom++;
+					}
+					if (y - radius >= 0) {
+						const auto row = image.ptr<uchar>(y - radius);
+						for (int x = 0; x < cols; x++) {
+							columnSums[x] -= row[x];
+						}
+						windowTop++;
+					}
+				}
+				tile.rowStarts.push_back((uint32_t) tile.runs.size());
+
+				// Label the runs within this tile
+				{
+					auto & parents = tile.parents;
+					parents.resize(tile.runs.size());
+					for (uint32_t i = 0; i < parents.size(); i++) {
+						parents[i] = i;
+					}
+
+					for (size_t row = 1; row + 1 < tile.rowStarts.size(); row++) {
+						auto rowAboveStart = tile.rowStarts[row - 1];
+						auto rowStart = tile.rowStarts[row];
+						auto rowEnd = tile.rowStarts[row + 1];
+						uniteRows(parents
+							, tile.runs.data() + rowAboveStart, rowAboveStart, rowStart - rowAboveStart
+							, tile.runs.data() + rowStart, rowStart, rowEnd - rowStart);
+					}
+				}
+			}
+		}
+	}
+}
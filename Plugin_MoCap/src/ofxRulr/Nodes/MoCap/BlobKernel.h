@@ -0,0 +1,80 @@
+#pragma once
+
+#include "ofxRulr/Utils/ThreadPool.h"
+
+namespace ofxRulr {
+	namespace Nodes {
+		namespace MoCap {
+			/// Finds bright blobs in a grayscale image in one pass per row:
+			/// running box-filter background -> amplified difference -> threshold -> run-length
+			/// connected components (8-connected), accumulating intensity moments as runs are found.
+			/// The image is split into horizontal tiles which are processed in parallel and
+			/// joined at the tile seams, so no contour point lists are ever built.
+			class BlobKernel {
+			public:
+				struct Settings {
+					int boxSize = 57; ///< Width of the background box filter [px]
+					float amplify = 4.0f;
+					int threshold = 30;
+				};
+
+				struct Blob {
+					cv::Rect boundingRect;
+					uint32_t area = 0; ///< Foreground pixel count
+					uint32_t perimeter = 0; ///< Foreground pixels which have a background 4-neighbour
+
+					// Image intensity moments over the blob's pixels, in image coordinates
+					double m00 = 0.0;
+					double m10 = 0.0;
+					double m01 = 0.0;
+				};
+
+				/// Per-frame scratch space (keep one per frame/thread so its storage gets reused)
+				struct Workspace {
+					struct Run {
+						int y;
+						int x0; // first pixel
+						int x1; // one past the last pixel
+						uint64_t sumI;
+						uint64_t sumXI;
+					};
+
+					struct Tile {
+						int y0 = 0;
+						int y1 = 0;
+						vector<Run> runs;
+						vector<uint32_t> rowStarts; // (y1 - y0) + 1 offsets into runs
+						vector<uint32_t> parents; // union-find over runs (tile-local indices)
+						vector<int32_t> columnSums;
+						vector<int32_t> boxSums;
+						vector<float> columnReciprocals;
+					};
+
+					vector<Tile> tiles;
+					vector<uint32_t> parents; // union-find over all runs
+					vector<int32_t> blobIndices;
+				};
+
+				BlobKernel(size_t threadCount = 0);
+
+				void process(const cv::Mat & image
+					, cv::Mat & difference
+					, cv::Mat & binary
+					, const Settings &
+					, Workspace &
+					, vector<Blob> & blobs);
+
+				/// The box width with the same spread as the iterated blur in the contour method
+				static int getEquivalentBoxSize(int blurSize);
+			protected:
+				static void processTile(const cv::Mat & image
+					, cv::Mat & difference
+					, cv::Mat & binary
+					, const Settings &
+					, Workspace::Tile &);
+
+				size_t threadCount;
+			};
+		}
+	}
+}
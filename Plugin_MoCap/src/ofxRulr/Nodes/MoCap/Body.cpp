@@ -134,6 +134,20 @@ namespace ofxRulr {
 					}
 				}
 
+				//rebuild body description if the Kalman filter settings have changed
+				{
+					auto bodyDescription = this->getBodyDescription();
+					if (bodyDescription) {
+						const auto & settings = bodyDescription->posePredictorSettings;
+						if (settings.useKalmanFilter != this->parameters.kalmanFilter.enabled.get()
+							|| settings.processNoise != this->parameters.kalmanFilter.processNoise.get()
+							|| settings.measurementNoise != this->parameters.kalmanFilter.measurementNoise.get()
+							|| settings.errorPost != this->parameters.kalmanFilter.errorPost.get()) {
+							this->invalidateBodyDescription();
+						}
+					}
+				}
+
 				//rebuild body description
 				if (!this->getBodyDescription()) {
 					auto bodyDescription = make_shared<Description>();
@@ -148,6 +162,11 @@ namespace ofxRulr {
 					bodyDescription->markerDiameter = this->parameters.markerDiameter;
 					bodyDescription->markerCount = markers.size();
 
+					bodyDescription->posePredictorSettings.useKalmanFilter = this->parameters.kalmanFilter.enabled;
+					bodyDescription->posePredictorSettings.processNoise = this->parameters.kalmanFilter.processNoise;
+					bodyDescription->posePredictorSettings.measurementNoise = this->parameters.kalmanFilter.measurementNoise;
+					bodyDescription->posePredictorSettings.errorPost = this->parameters.kalmanFilter.errorPost;
+
 					bodyDescription->modelTransform = this->getTransform();
 					ofxCv::decomposeMatrix(bodyDescription->modelTransform
 						, bodyDescription->rotationVector
@@ -2,6 +2,7 @@
 
 #include "ofxRulr.h"
 #include "ofxRulr/Utils/CaptureSet.h"
+#include "PosePredictor.h"
 
 namespace ofxRulr {
 	namespace Nodes {
@@ -23,6 +24,8 @@ namespace ofxRulr {
 					glm::mat4 modelTransform;
 					cv::Mat rotationVector;
 					cv::Mat translation;
+
+					PosePredictor::Settings posePredictorSettings;
 				};
 
 				Body();
@@ -4,6 +4,33 @@
 namespace ofxRulr {
 	namespace Nodes {
 		namespace MoCap {
+#pragma mark TrackingFeedback
+			//----------
+			void TrackingFeedback::setPrediction(const vector<cv::Point2f> & imagePoints) {
+				unique_lock<mutex> lock(this->predictionMutex);
+				this->predictedImagePoints.assign(imagePoints.begin(), imagePoints.end());
+				this->predictionTime = chrono::high_resolution_clock::now();
+				this->hasPrediction = !imagePoints.empty();
+			}
+
+			//----------
+			void TrackingFeedback::notifyTrackingLost() {
+				unique_lock<mutex> lock(this->predictionMutex);
+				this->hasPrediction = false;
+			}
+
+			//----------
+			bool TrackingFeedback::getPrediction(vector<cv::Point2f> & imagePoints, chrono::milliseconds maximumAge) const {
+				unique_lock<mutex> lock(this->predictionMutex);
+				if (!this->hasPrediction
+					|| chrono::high_resolution_clock::now() - this->predictionTime > maximumAge) {
+					return false;
+				}
+				imagePoints.assign(this->predictedImagePoints.begin(), this->predictedImagePoints.end());
+				return true;
+			}
+
+#pragma mark FindMarkerCentroids
 			//----------
 			FindMarkerCentroids::FindMarkerCentroids() {
 				RULR_NODE_INIT_LISTENER;
@@ -16,99 +43,292 @@ namespace ofxRulr {
 
 			//----------
 			void FindMarkerCentroids::init() {
+				RULR_NODE_INSPECTOR_LISTENER;
+
+				// We have no update() of our own (no GL, no other nodes), so the patch may run the ThreadedProcessNode one on a worker thread
+				this->setUpdateIsThreadSafe(true);
+
 				this->manageParameters(this->parameters);
 			}
 
+			//----------
+			void FindMarkerCentroids::populateInspector(ofxCvGui::InspectArguments & inspectArgs) {
+				auto inspector = inspectArgs.inspector;
+				inspector->addIndicatorBool("Full search", [this]() {
+					return this->lastSearchWasFull.load();
+				});
+				inspector->addLiveValueHistory("Searched area [%]", [this]() {
+					return this->lastSearchedFraction.load() * 100.0f;
+				});
+			}
+
 			//----------
 			void FindMarkerCentroids::processFrame(shared_ptr<ofxMachineVision::Frame> incomingFrame) {
-				//create the ouput frame;
-				auto outgoingFrame = make_shared<FindMarkerCentroidsFrame>();
+				//create the ouput frame (recycled, so its image storage is normally already the right size)
+				auto outgoingFrame = this->acquireOutgoingFrame();
 				outgoingFrame->imageFrame = incomingFrame; 
+				outgoingFrame->trackingFeedback = this->trackingFeedback;
+				outgoingFrame->receivedTime = chrono::high_resolution_clock::now();
+
+				const uchar * const storageBefore[] = {
+					outgoingFrame->grayscale.data
+					, outgoingFrame->blurred.data
+					, outgoingFrame->difference.data
+					, outgoingFrame->binary.data
+					, outgoingFrame->paddedBlurred.data
+					, outgoingFrame->paddedDifference.data
+					, outgoingFrame->paddedBinary.data
+				};
 
 				//convert to grayscale if needs be
-				outgoingFrame->image = ofxCv::toCv(incomingFrame->getPixels());
+				auto incomingImage = ofxCv::toCv(incomingFrame->getPixels());
 				switch (incomingFrame->getPixels().getPixelFormat()) {
 				case ofPixelFormat::OF_PIXELS_GRAY:
+					outgoingFrame->image = incomingImage;
 					break;
 				case ofPixelFormat::OF_PIXELS_RGB:
 				case ofPixelFormat::OF_PIXELS_BGR:
-					cv::cvtColor(outgoingFrame->image, outgoingFrame->image, cv::COLOR_RGB2GRAY);
+					cv::cvtColor(incomingImage, outgoingFrame->grayscale, cv::COLOR_RGB2GRAY);
+					outgoingFrame->image = outgoingFrame->grayscale;
 					break;
 				case ofPixelFormat::OF_PIXELS_RGBA:
 				case ofPixelFormat::OF_PIXELS_BGRA:
-					cv::cvtColor(outgoingFrame->image, outgoingFrame->image, cv::COLOR_RGBA2GRAY);
+					cv::cvtColor(incomingImage, outgoingFrame->grayscale, cv::COLOR_RGBA2GRAY);
+					outgoingFrame->image = outgoingFrame->grayscale;
 					break;
 				default:
 					throw(ofxRulr::Exception("Image format not supported by FindContourMarkers"));
 				}
 
+				this->findSearchRegions(*outgoingFrame);
+				const auto method = this->parameters.method.get();
+
+				//allocate the working images up front, so that each search region can write into a view of them
+				{
+					cv::Mat * const images[] = {
+						&outgoingFrame->difference
+						, &outgoingFrame->binary
+						, &outgoingFrame->blurred // only used by Method::Contours
+					};
+					const size_t imageCount = method == Method::Contours ? 3 : 2;
+					for (size_t i = 0; i < imageCount; i++) {
+						auto image = images[i];
+						image->create(outgoingFrame->image.size(), CV_8UC1);
+
+						//when only searching windows, clear the rest for the previews
+						if (!outgoingFrame->fullSearch) {
+							image->setTo(0);
+						}
+					}
+
+					//scratch for the padded windows
+					if (!outgoingFrame->fullSearch) {
+						if (method == Method::Contours) {
+							outgoingFrame->paddedBlurred.create(outgoingFrame->image.size(), CV_8UC1);
+						}
+						else {
+							outgoingFrame->paddedDifference.create(outgoingFrame->image.size(), CV_8UC1);
+							outgoingFrame->paddedBinary.create(outgoingFrame->image.size(), CV_8UC1);
+						}
+					}
+				}
+
+				for (const auto & region : outgoingFrame->searchRegions) {
+					switch (method.get()) {
+					case Method::Contours:
+						this->findCentroidsContours(*outgoingFrame, region);
+						break;
+					case Method::Fused:
+						this->findCentroidsFused(*outgoingFrame, region);
+						break;
+					default:
+						break;
+					}
+				}
+
+				//count any image storage which had to be (re)allocated
+				{
+					const uchar * const storageAfter[] = {
+						outgoingFrame->grayscale.data
+						, outgoingFrame->blurred.data
+						, outgoingFrame->difference.data
+						, outgoingFrame->binary.data
+						, outgoingFrame->paddedBlurred.data
+						, outgoingFrame->paddedDifference.data
+						, outgoingFrame->paddedBinary.data
+					};
+					int allocations = 0;
+					for (size_t i = 0; i < 7; i++) {
+						if (storageAfter[i] != storageBefore[i]) {
+							allocations++;
+						}
+					}
+					if (allocations > 0) {
+						this->notifyAllocations(allocations);
+					}
+				}
+
+				//get moments centers
+				auto count = outgoingFrame->boundingRects.size();
+				outgoingFrame->centroids.reserve(count);
+				for (size_t i = 0; i < count; i++) {
+					const auto & moment = outgoingFrame->moments[i];
+					outgoingFrame->centroids.emplace_back(
+						moment.m10 / moment.m00 + outgoingFrame->boundingRects[i].x - outgoingFrame->dilationSize
+						, moment.m01 / moment.m00 + outgoingFrame->boundingRects[i].y - outgoingFrame->dilationSize
+					);
+				}
+
+				//announce the new frame
+				this->emitFrame(outgoingFrame);
+			}
+
+			//----------
+			void FindMarkerCentroids::findSearchRegions(FindMarkerCentroidsFrame & frame) {
+				const auto imageRect = cv::Rect(0, 0, frame.image.cols, frame.image.rows);
+
+				auto useFullSearch = [&]() {
+					frame.searchRegions.assign(1, imageRect);
+					frame.fullSearch = true;
+					this->framesSinceFullSearch.store(0);
+					this->lastSearchWasFull.store(true);
+					this->lastSearchedFraction.store(1.0f);
+				};
+
+				//check if we can use the prediction from tracking
+				vector<cv::Point2f> predictedImagePoints;
+				if (!this->parameters.roiSearch.enabled.get()
+					|| this->framesSinceFullSearch++ >= this->parameters.roiSearch.fullSearchInterval.get()
+					|| !frame.trackingFeedback->getPrediction(predictedImagePoints, chrono::milliseconds((int) this->parameters.roiSearch.maximumAge.get()))) {
+					useFullSearch();
+					return;
+				}
+
+				//make a window around each prediction
+				const auto windowSize = (int) this->parameters.roiSearch.windowSize.get();
+				for (const auto & imagePoint : predictedImagePoints) {
+					auto window = cv::Rect((int) imagePoint.x - windowSize / 2
+						, (int) imagePoint.y - windowSize / 2
+						, windowSize
+						, windowSize) & imageRect;
+					if (window.area() > 0) {
+						frame.searchRegions.push_back(window);
+					}
+				}
+
+				//merge overlapping windows so that no marker is found twice
+				{
+					bool merged = true;
+					while (merged) {
+						merged = false;
+						for (size_t i = 0; i < frame.searchRegions.size() && !merged; i++) {
+							for (size_t j = i + 1; j < frame.searchRegions.size(); j++) {
+								if ((frame.searchRegions[i] & frame.searchRegions[j]).area() > 0) {
+									frame.searchRegions[i] |= frame.searchRegions[j];
+									frame.searchRegions.erase(frame.searchRegions.begin() + j);
+									merged = true;
+									break;
+								}
+							}
+						}
+					}
+				}
+
+				size_t searchedArea = 0;
+				for (const auto & region : frame.searchRegions) {
+					searchedArea += region.area();
+				}
+
+				if (frame.searchRegions.empty() || searchedArea * 2 > (size_t) imageRect.area()) {
+					//windows are no help here
+					frame.searchRegions.clear();
+					useFullSearch();
+					return;
+				}
+
+				frame.fullSearch = false;
+				this->lastSearchWasFull.store(false);
+				this->lastSearchedFraction.store((float) searchedArea / (float) imageRect.area());
+			}
+
+			//----------
+			void FindMarkerCentroids::findCentroidsContours(FindMarkerCentroidsFrame & frame, const cv::Rect & region) {
+				//views into the frame's images (which are already allocated)
+				auto image = frame.image(region);
+				auto blurred = frame.blurred(region);
+				auto difference = frame.difference(region);
+				auto binary = frame.binary(region);
+
 				//local difference
 				{
-					//iterative blur
+					//iterative blur (of a search window padded by the blur radius, then cropped back to the window)
 					{
+						const auto paddedRegion = this->getPaddedRegion(frame, region);
+						auto paddedImage = frame.image(paddedRegion);
+						auto paddedBlurred = paddedRegion == region
+							? blurred
+							: frame.paddedBlurred(paddedRegion);
+
 						int blurSize = this->parameters.localDifference.blurSize;
 
-						cv::blur(outgoingFrame->image, outgoingFrame->blurred, cv::Size(blurSize / 2, blurSize / 2));
+						//later passes mustn't read the scratch image outside the padded region (it's stale)
+						const auto isolated = cv::BORDER_DEFAULT | cv::BORDER_ISOLATED;
+
+						cv::blur(paddedImage, paddedBlurred, cv::Size(blurSize / 2, blurSize / 2));
 						blurSize /= 2;
 						while (blurSize > 1) {
 							if (blurSize <= 32) {
-								cv::blur(outgoingFrame->blurred, outgoingFrame->blurred, cv::Size(blurSize, blurSize));
+								cv::blur(paddedBlurred, paddedBlurred, cv::Size(blurSize, blurSize), cv::Point(-1, -1), isolated);
 								break;
 							}
-							cv::blur(outgoingFrame->blurred, outgoingFrame->blurred, cv::Size(blurSize / 2, blurSize / 2));
+							cv::blur(paddedBlurred, paddedBlurred, cv::Size(blurSize / 2, blurSize / 2), cv::Point(-1, -1), isolated);
 							blurSize /= 2;
 						}
+
+						if (paddedRegion != region) {
+							paddedBlurred(region - paddedRegion.tl()).copyTo(blurred);
+						}
 					}
 
-					outgoingFrame->difference = outgoingFrame->image - outgoingFrame->blurred;
-					outgoingFrame->difference *= this->parameters.localDifference.differenceAmplify;
+					//write into the existing storage rather than assigning new Mats
+					cv::subtract(image, blurred, difference);
+					difference.convertTo(difference, -1, this->parameters.localDifference.differenceAmplify);
 
-					cv::threshold(outgoingFrame->difference
-						, outgoingFrame->binary
+					cv::threshold(difference
+						, binary
 						, this->parameters.localDifference.threshold
 						, 255
 						, cv::THRESH_BINARY);
 				}
 
 				//find the contours
-				cv::findContours(outgoingFrame->binary
-					, outgoingFrame->contours
+				vector<vector<cv::Point2i>> contours;
+				auto & contoursInRegion = frame.fullSearch ? frame.contours : contours;
+				cv::findContours(binary
+					, contoursInRegion
 					, cv::RETR_EXTERNAL
 					, cv::CHAIN_APPROX_NONE);
 
-				auto count = outgoingFrame->contours.size();
-
 				//find the bounding rectangles (check if valid also)
-				outgoingFrame->boundingRects.reserve(count);
-				for (const auto & contour : outgoingFrame->contours) {
+				frame.boundingRects.reserve(frame.boundingRects.size() + contoursInRegion.size());
+				for (auto & contour : contoursInRegion) {
 					auto rect = cv::boundingRect(contour);
+					rect.x += region.x;
+					rect.y += region.y;
 
-					//check area
-					if (rect.area() <= this->parameters.contourFilter.minimumArea) {
+					if (!this->isValidBlob(rect, region)) {
 						continue;
 					}
 
-					//check if it touches edge of frame (we use a threshold of 2px for rejections)
-					{
-						const int distanceThreshold = 2;
-						auto bottomRight = rect.br();
-						if (rect.x <= distanceThreshold
-							|| rect.y <= distanceThreshold
-							|| outgoingFrame->image.cols - bottomRight.x <= distanceThreshold
-							|| outgoingFrame->image.rows - bottomRight.y <= distanceThreshold) {
-							continue;
-						}
-					}
-
 					//create a dilated rect for finding moments
 					auto dilatedRect = rect;
 					{
-						dilatedRect.x -= outgoingFrame->dilationSize;
-						dilatedRect.y -= outgoingFrame->dilationSize;
-						dilatedRect.width += outgoingFrame->dilationSize;
-						dilatedRect.height += outgoingFrame->dilationSize;
+						dilatedRect.x -= frame.dilationSize;
+						dilatedRect.y -= frame.dilationSize;
+						dilatedRect.width += frame.dilationSize;
+						dilatedRect.height += frame.dilationSize;
 					}
-					auto moment = cv::moments(outgoingFrame->image(dilatedRect));
+					auto moment = cv::moments(frame.image(dilatedRect));
 
 					//check circularity
 					//https://github.com/opencv/opencv/blob/master/modules/features2d/src/blobdetector.cpp#L225
@@ -121,25 +341,118 @@ namespace ofxRulr {
 							continue;
 						}
 					}
+
+					if (!frame.fullSearch) {
+						for (auto & point : contour) {
+							point += region.tl();
+						}
+						frame.contours.push_back(move(contour));
+					}
 					
-					outgoingFrame->boundingRects.push_back(rect);
-					outgoingFrame->moments.push_back(moment);
-					outgoingFrame->circularity.push_back(circularity);
+					frame.boundingRects.push_back(rect);
+					frame.moments.push_back(moment);
+					frame.circularity.push_back(circularity);
 				}
-				count = outgoingFrame->boundingRects.size();
+			}
 
-				//get moments centers
-				outgoingFrame->centroids.reserve(count);
-				for (size_t i = 0; i < count; i++) {
-					const auto & moment = outgoingFrame->moments[i];
-					outgoingFrame->centroids.emplace_back(
-						moment.m10 / moment.m00 + outgoingFrame->boundingRects[i].x - outgoingFrame->dilationSize
-						, moment.m01 / moment.m00 + outgoingFrame->boundingRects[i].y - outgoingFrame->dilationSize
-					);
+			//----------
+			void FindMarkerCentroids::findCentroidsFused(FindMarkerCentroidsFrame & frame, const cv::Rect & region) {
+				BlobKernel::Settings settings;
+				settings.boxSize = BlobKernel::getEquivalentBoxSize(this->parameters.localDifference.blurSize);
+				settings.amplify = this->parameters.localDifference.differenceAmplify;
+				settings.threshold = (int) floor(this->parameters.localDifference.threshold.get());
+
+				//process the window padded by the blur radius, then keep what's inside the window
+				const auto paddedRegion = this->getPaddedRegion(frame, region);
+				auto difference = frame.difference(region);
+				auto binary = frame.binary(region);
+				auto paddedDifference = paddedRegion == region
+					? difference
+					: frame.paddedDifference(paddedRegion);
+				auto paddedBinary = paddedRegion == region
+					? binary
+					: frame.paddedBinary(paddedRegion);
+				this->blobKernel.process(frame.image(paddedRegion)
+					, paddedDifference
+					, paddedBinary
+					, settings
+					, frame.blobKernelWorkspace
+					, frame.blobs);
+				if (paddedRegion != region) {
+					const auto window = region - paddedRegion.tl();
+					paddedDifference(window).copyTo(difference);
+					paddedBinary(window).copyTo(binary);
 				}
 
-				//announce the new frame
-				this->onNewFrame(outgoingFrame);
+				frame.boundingRects.reserve(frame.boundingRects.size() + frame.blobs.size());
+				for (const auto & blob : frame.blobs) {
+					auto rect = blob.boundingRect;
+					rect.x += paddedRegion.x;
+					rect.y += paddedRegion.y;
+
+					//blobs in the padding (or crossing into it) are rejected here as they touch the window's edge
+					if (!this->isValidBlob(rect, region) || blob.m00 <= 0.0) {
+						continue;
+					}
+
+					//this isn't the contour method's measure (which uses the intensity of the whole dilated rect and the
+					//contour's arc length, scaled by the gamma). It's the shape alone: the foreground pixel count against the
+					//boundary pixel count. A digital disc scores ~1.3, a square ~1.0 and a thin line ~4pi/length
+					auto perimeter = (float) blob.perimeter;
+					auto circularity = (float) (4 * CV_PI * blob.area / (perimeter * perimeter));
+					if (circularity < this->parameters.contourFilter.minimumCircularityFused.get()) {
+						continue;
+					}
+
+					//moments are relative to the dilated rect (as with the contour method)
+					cv::Moments moment;
+					{
+						auto originX = rect.x - paddedRegion.x - frame.dilationSize;
+						auto originY = rect.y - paddedRegion.y - frame.dilationSize;
+						moment.m00 = blob.m00;
+						moment.m10 = blob.m10 - originX * blob.m00;
+						moment.m01 = blob.m01 - originY * blob.m00;
+					}
+
+					frame.boundingRects.push_back(rect);
+					frame.moments.push_back(moment);
+					frame.circularity.push_back(circularity);
+				}
+			}
+
+			//----------
+			bool FindMarkerCentroids::isValidBlob(const cv::Rect & rect, const cv::Rect & region) const {
+				//check area
+				if (rect.area() <= this->parameters.contourFilter.minimumArea) {
+					return false;
+				}
+
+				//check if it touches edge of frame or search window (we use a threshold of 2px for rejections)
+				{
+					const int distanceThreshold = 2;
+					auto bottomRight = rect.br();
+					auto regionBottomRight = region.br();
+					if (rect.x - region.x <= distanceThreshold
+						|| rect.y - region.y <= distanceThreshold
+						|| regionBottomRight.x - bottomRight.x <= distanceThreshold
+						|| regionBottomRight.y - bottomRight.y <= distanceThreshold) {
+						return false;
+					}
+				}
+
+				return true;
+			}
+
+			//----------
+			cv::Rect FindMarkerCentroids::getPaddedRegion(const FindMarkerCentroidsFrame & frame, const cv::Rect & region) const {
+				//the iterated blurs (and the fused method's box) reach at most half the blur size from each pixel
+				const auto padding = (int) this->parameters.localDifference.blurSize.get() / 2 + 1;
+				auto paddedRegion = region;
+				paddedRegion.x -= padding;
+				paddedRegion.y -= padding;
+				paddedRegion.width += padding * 2;
+				paddedRegion.height += padding * 2;
+				return paddedRegion & cv::Rect(0, 0, frame.image.cols, frame.image.rows);
 			}
 		}
 	}
@@ -1,38 +1,100 @@
 #pragma once
 
 #include "ThreadedProcessNode.h"
+#include "BlobKernel.h"
 #include "ofxRulr/Nodes/Item/Camera.h"
 
 namespace ofxRulr {
 	namespace Nodes {
 		namespace MoCap {
+			/// Written by the tracking at the end of the chain to tell FindMarkerCentroids where
+			/// markers are expected in the next frame (a shared instance travels with each frame)
+			class TrackingFeedback {
+			public:
+				void setPrediction(const vector<cv::Point2f> & imagePoints);
+				void notifyTrackingLost();
+
+				/// Returns false if there is no prediction or it is older than maximumAge
+				bool getPrediction(vector<cv::Point2f> & imagePoints, chrono::milliseconds maximumAge) const;
+			protected:
+				mutable mutex predictionMutex;
+				vector<cv::Point2f> predictedImagePoints;
+				chrono::high_resolution_clock::time_point predictionTime;
+				bool hasPrediction = false;
+			};
+
 			struct FindMarkerCentroidsFrame {
 				shared_ptr<ofxMachineVision::Frame> imageFrame;
+				shared_ptr<TrackingFeedback> trackingFeedback;
+
+				// When the image reached us. Used to group frames from several cameras
+				// (the devices' own timestamps aren't on a shared clock)
+				chrono::high_resolution_clock::time_point receivedTime;
 
-				cv::Mat image;
+				vector<cv::Rect> searchRegions; // windows which were processed (whole image for a full search)
+				bool fullSearch = true;
+
+				cv::Mat image; // points to the incoming pixels or to grayscale
+				cv::Mat grayscale; // storage for color conversion
 				cv::Mat blurred;
 				cv::Mat difference;
 				cv::Mat binary;
 
-				vector<vector<cv::Point2i>> contours;
+				// Search windows are processed padded by the blur radius, so that the blur sees the real image
+				// around them. These hold the padded results (full image size, so they're allocated once)
+				cv::Mat paddedBlurred;
+				cv::Mat paddedDifference;
+				cv::Mat paddedBinary;
+
+				vector<vector<cv::Point2i>> contours; // only with Method::Contours
+				vector<BlobKernel::Blob> blobs; // only with Method::Fused (working data for one search region)
+				BlobKernel::Workspace blobKernelWorkspace;
+
 				vector<cv::Rect> boundingRects;
 				const int dilationSize = 2; // used for calculating moments
-				vector<cv::Moments> moments;
+				vector<cv::Moments> moments; // relative to the dilated bounding rect
 				vector<float> circularity;
 				vector<cv::Point2f> centroids;
+
+				// Clear for reuse by the frame pool (image storage is kept)
+				void reset() {
+					this->imageFrame.reset();
+					this->trackingFeedback.reset();
+					this->searchRegions.clear();
+					this->fullSearch = true;
+					this->image.release();
+					this->contours.clear();
+					this->blobs.clear();
+					this->boundingRects.clear();
+					this->moments.clear();
+					this->circularity.clear();
+					this->centroids.clear();
+				}
 			};
 
 			class FindMarkerCentroids : public ThreadedProcessNode<Item::Camera
 				, ofxMachineVision::Frame
 				, FindMarkerCentroidsFrame> {
 			public:
+				MAKE_ENUM(Method
+					, (Contours, Fused)
+					, ("Contours", "Fused"));
+
 				FindMarkerCentroids();
 				virtual string getTypeName() const override;
 				void init();
+				void populateInspector(ofxCvGui::InspectArguments &);
 			protected:
 				void processFrame(shared_ptr<ofxMachineVision::Frame>) override;
+				void findSearchRegions(FindMarkerCentroidsFrame &);
+				void findCentroidsContours(FindMarkerCentroidsFrame &, const cv::Rect & region);
+				void findCentroidsFused(FindMarkerCentroidsFrame &, const cv::Rect & region);
+				bool isValidBlob(const cv::Rect & blob, const cv::Rect & region) const;
+				cv::Rect getPaddedRegion(const FindMarkerCentroidsFrame &, const cv::Rect & region) const;
 
 				struct : ofParameterGroup {
+					ofParameter<Method> method{ "Method", Method::Contours };
+
 					struct : ofParameterGroup {
 						ofParameter<float> blurSize{ "Blur size", 100, 0, 1000 };
 						ofParameter<float> threshold{ "Threshold", 30, 0, 255 };
@@ -44,11 +106,27 @@ namespace ofxRulr {
 						ofParameter<float> minimumArea{ "Minimum area [px]", 100, 0, 10000 };
 						ofParameter<float> circularityGamma{ "Circularity gamma", 0.8, 0, 2.0f };
 						ofParameter<float> minimumCircularity{ "Minimum circularity ", 10.0, 0, 100.0f };
-						PARAM_DECLARE("Contour filter", minimumArea, circularityGamma, minimumCircularity);
+						ofParameter<float> minimumCircularityFused{ "Minimum circularity (Fused)", 0.5, 0, 2.0f }; ///< A different measure to the Contours method, see findCentroidsFused
+						PARAM_DECLARE("Contour filter", minimumArea, circularityGamma, minimumCircularity, minimumCircularityFused);
 					} contourFilter;
 
-					PARAM_DECLARE("FindMarkerCentroids", localDifference, contourFilter);
+					struct : ofParameterGroup {
+						ofParameter<bool> enabled{ "Enabled", true };
+						ofParameter<float> windowSize{ "Window size [px]", 64, 8, 512 };
+						ofParameter<int> fullSearchInterval{ "Full search interval [frames]", 30 };
+						ofParameter<float> maximumAge{ "Maximum prediction age [ms]", 100 };
+						PARAM_DECLARE("ROI search", enabled, windowSize, fullSearchInterval, maximumAge);
+					} roiSearch;
+
+					PARAM_DECLARE("FindMarkerCentroids", method, localDifference, contourFilter, roiSearch);
 				} parameters;
+
+				BlobKernel blobKernel;
+
+				shared_ptr<TrackingFeedback> trackingFeedback = make_shared<TrackingFeedback>();
+				atomic<int> framesSinceFullSearch{ 0 };
+				atomic<bool> lastSearchWasFull{ true };
+				atomic<float> lastSearchedFraction{ 1.0f };
 			};
 		}
 	}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <vector>
+
+namespace ofxRulr {
+	namespace Nodes {
+		namespace MoCap {
+			/// A pool of recycled frames for a ThreadedProcessNode.
+			/// A frame comes back to the pool when the last downstream user releases it. It is reset at that point
+			/// (so an idle frame doesn't keep upstream frames and their camera buffers alive), and its cv::Mats etc
+			/// are reused by the next acquire() rather than reallocated.
+			/// FrameType must have a reset() which clears per-frame data but keeps any storage.
+			template<typename FrameType>
+			class FramePool {
+			public:
+				FramePool(size_t maxSize = 8)
+					: store(make_shared<Store>()) {
+					this->store->maxSize = maxSize;
+				}
+
+				/// Returns a reset frame, allocating one only if all pooled frames are in use
+				shared_ptr<FrameType> acquire() {
+					unique_ptr<FrameType> frame;
+					{
+						unique_lock<mutex> lock(this->store->lock);
+						if (!this->store->freeFrames.empty()) {
+							frame = move(this->store->freeFrames.back());
+							this->store->freeFrames.pop_back();
+						}
+						else if (this->store->size < this->store->maxSize) {
+							this->store->size++;
+							this->allocationCount++;
+							frame = make_unique<FrameType>();
+						}
+						else {
+							// Pool is exhausted (e.g. downstream is holding on to frames), so this frame won't be recycled
+							this->allocationCount++;
+							return make_shared<FrameType>();
+						}
+						this->store->inUse++;
+					}
+
+					// The frame returns to the store when released. If the pool has gone by then, it's just deleted
+					weak_ptr<Store> weakStore = this->store;
+					return shared_ptr<FrameType>(frame.release(), [weakStore](FrameType * frame) {
+						auto store = weakStore.lock();
+						if (!store) {
+							delete frame;
+							return;
+						}
+
+						frame->reset();
+
+						unique_lock<mutex> lock(store->lock);
+						store->inUse--;
+						store->freeFrames.emplace_back(frame);
+					});
+				}
+
+				/// Allocate frames ahead of time
+				void reserve(size_t count) {
+					unique_lock<mutex> lock(this->store->lock);
+					while (this->store->size < count && this->store->size < this->store->maxSize) {
+						this->store->size++;
+						this->allocationCount++;
+						this->store->freeFrames.push_back(make_unique<FrameType>());
+					}
+				}
+
+				/// Release the idle frames (frames in use still come back to the pool)
+				void clear() {
+					unique_lock<mutex> lock(this->store->lock);
+					this->store->size -= this->store->freeFrames.size();
+					this->store->freeFrames.clear();
+				}
+
+				size_t getSize() const {
+					unique_lock<mutex> lock(this->store->lock);
+					return this->store->size;
+				}
+
+				size_t getInUseCount() const {
+					unique_lock<mutex> lock(this->store->lock);
+					return this->store->inUse;
+				}
+
+				/// Total frames allocated by this pool (including overflow frames)
+				uint64_t getAllocationCount() const {
+					return this->allocationCount.load();
+				}
+			protected:
+				// Shared with the frames' deleters, which may run after the pool is gone
+				struct Store {
+					mutex lock;
+					vector<unique_ptr<FrameType>> freeFrames;
+					size_t size = 0; ///< Pooled frames, free or in use
+					size_t inUse = 0;
+					size_t maxSize = 8;
+				};
+
+				shared_ptr<Store> store;
+				atomic<uint64_t> allocationCount{ 0 };
+			};
+		}
+	}
+}
@@ -0,0 +1,397 @@
+#include "pch_Plugin_MoCap.h"
+#include "FrameStream.h"
+
+namespace ofxRulr {
+	namespace Nodes {
+		namespace MoCap {
+			namespace FrameStream {
+				static const char FileMagic[8] = { 'R', 'U', 'L', 'R', 'F', 'R', 'M', '1' };
+				static const char IndexMagic[8] = { 'R', 'U', 'L', 'R', 'I', 'D', 'X', '1' };
+				static const uint32_t FrameTag = 'F' | 'R' << 8 | 'M' << 16 | 'E' << 24;
+				static const uint32_t IndexTag = 'I' | 'N' << 8 | 'D' << 16 | 'X' << 24;
+
+				struct ChunkHeader {
+					uint32_t tag;
+					uint32_t reserved;
+					uint64_t payloadSize;
+				};
+
+				struct FrameHeader {
+					uint64_t frameIndex;
+					int64_t timestamp;
+					int64_t recordTime;
+					uint32_t width;
+					uint32_t height;
+					int32_t type;
+					uint32_t regionCount;
+				};
+
+				struct RegionHeader {
+					int32_t x;
+					int32_t y;
+					int32_t width;
+					int32_t height;
+				};
+
+				//----------
+				template<typename T>
+				void writeRaw(ofstream & file, const T & value) {
+					file.write((const char *) &value, sizeof(T));
+				}
+
+				//----------
+				template<typename T>
+				void readRaw(ifstream & file, T & value) {
+					file.read((char *) &value, sizeof(T));
+					if (!file) {
+						throw(ofxRulr::Exception("FrameStream : unexpected end of file"));
+					}
+				}
+
+#pragma mark Writer
+				//----------
+				Writer::~Writer() {
+					try {
+						this->close();
+					}
+					RULR_CATCH_ALL_TO_ERROR;
+				}
+
+				//----------
+				void Writer::open(const filesystem::path & path) {
+					this->close();
+
+					// A large buffer so that each frame goes to disk in a few big writes
+					this->fileBuffer.resize(8 << 20);
+					this->file.rdbuf()->pubsetbuf(this->fileBuffer.data(), this->fileBuffer.size());
+
+					this->file.open(path, ios::out | ios::binary | ios::trunc);
+					if (!this->file.is_open()) {
+						throw(ofxRulr::Exception("Couldn't open " + path.string() + " for writing"));
+					}
+					this->path = path;
+					this->file.write(FileMagic, sizeof(FileMagic));
+					this->position = sizeof(FileMagic);
+					this->index.clear();
+				}
+
+				//----------
+				void Writer::close() {
+					if (!this->file.is_open()) {
+						return;
+					}
+
+					// Index chunk
+					const auto indexOffset = this->position;
+					this->file.clear();
+					this->file.seekp(indexOffset);
+					const uint64_t indexPayloadSize = sizeof(uint64_t) + this->index.size() * (sizeof(int64_t) + sizeof(uint64_t));
+					{
+						ChunkHeader chunkHeader{ IndexTag, 0, indexPayloadSize };
+						writeRaw(this->file, chunkHeader);
+						writeRaw(this->file, (uint64_t) this->index.size());
+						for (const auto & entry : this->index) {
+							writeRaw(this->file, (int64_t) entry.recordTime.count());
+							writeRaw(this->file, entry.offset);
+						}
+					}
+
+					// Trailer
+					writeRaw(this->file, indexOffset);
+					this->file.write(IndexMagic, sizeof(IndexMagic));
+
+					this->file.close();
+					this->index.clear();
+
+					// A frame which failed to write may have left bytes beyond the trailer
+					const auto fileSize = indexOffset + sizeof(ChunkHeader) + indexPayloadSize + sizeof(uint64_t) + sizeof(IndexMagic);
+					if (filesystem::file_size(this->path) > fileSize) {
+						filesystem::resize_file(this->path, fileSize);
+					}
+				}
+
+				//----------
+				bool Writer::isOpen() const {
+					return this->file.is_open();
+				}
+
+				//----------
+				void Writer::write(uint64_t frameIndex
+					, chrono::nanoseconds timestamp
+					, chrono::nanoseconds recordTime
+					, const cv::Mat & image
+					, const vector<cv::Rect> & regions) {
+					if (!this->file.is_open()) {
+						throw(ofxRulr::Exception("FrameStream::Writer is not open"));
+					}
+
+					const auto imageBounds = cv::Rect(0, 0, image.cols, image.rows);
+					this->clippedRegions.clear();
+					if (regions.empty()) {
+						this->clippedRegions.push_back(imageBounds);
+					}
+					else {
+						for (const auto & region : regions) {
+							auto clipped = region & imageBounds;
+							if (clipped.area() > 0) {
+								this->clippedRegions.push_back(clipped);
+							}
+						}
+					}
+
+					const auto pixelSize = image.elemSize();
+					uint64_t payloadSize = sizeof(FrameHeader);
+					for (const auto & region : this->clippedRegions) {
+						payloadSize += sizeof(RegionHeader) + (uint64_t) region.area() * pixelSize;
+					}
+
+					writeRaw(this->file, ChunkHeader{ FrameTag, 0, payloadSize });
+					writeRaw(this->file, FrameHeader{ frameIndex
+						, (int64_t) timestamp.count()
+						, (int64_t) recordTime.count()
+						, (uint32_t) image.cols
+						, (uint32_t) image.rows
+						, (int32_t) image.type()
+						, (uint32_t) this->clippedRegions.size() });
+					for (const auto & region : this->clippedRegions) {
+						writeRaw(this->file, RegionHeader{ region.x, region.y, region.width, region.height });
+					}
+					for (const auto & region : this->clippedRegions) {
+						const auto rowSize = region.width * pixelSize;
+						if (region == imageBounds && image.isContinuous()) {
+							this->file.write((const char *) image.data, rowSize * region.height);
+						}
+						else {
+							for (int y = region.y; y < region.y + region.height; y++) {
+								this->file.write((const char *) image.ptr(y, region.x), rowSize);
+							}
+						}
+					}
+
+					if (!this->file) {
+						// Go back so that the next frame (or the index on close) is written over what we managed of this one
+						this->file.clear();
+						this->file.seekp(this->position);
+						throw(ofxRulr::Exception("FrameStream : failed to write frame (is the disk full?)"));
+					}
+
+					// Only index the frame once it's all written
+					this->index.push_back({ recordTime, this->position });
+					this->position += sizeof(ChunkHeader) + payloadSize;
+				}
+
+				//----------
+				size_t Writer::getFrameCount() const {
+					return this->index.size();
+				}
+
+				//----------
+				uint64_t Writer::getBytesWritten() const {
+					return this->position;
+				}
+
+#pragma mark Reader
+				//----------
+				void Reader::open(const filesystem::path & path) {
+					this->close();
+
+					this->file.open(path, ios::in | ios::binary);
+					if (!this->file.is_open()) {
+						throw(ofxRulr::Exception("Couldn't open " + path.string()));
+					}
+
+					char magic[8];
+					this->file.read(magic, sizeof(magic));
+					if (!this->file || memcmp(magic, FileMagic, sizeof(magic)) != 0) {
+						this->file.close();
+						throw(ofxRulr::Exception(path.string() + " is not a frame stream file"));
+					}
+
+					this->file.seekg(0, ios::end);
+					const auto fileSize = (uint64_t) this->file.tellg();
+
+					// Try the index written on close
+					bool hasIndex = false;
+					if (fileSize >= sizeof(FileMagic) + sizeof(uint64_t) + sizeof(IndexMagic)) {
+						uint64_t indexOffset;
+						char indexMagic[8];
+						this->file.seekg(fileSize - sizeof(uint64_t) - sizeof(IndexMagic));
+						readRaw(this->file, indexOffset);
+						this->file.read(indexMagic, sizeof(indexMagic));
+						if (this->file && memcmp(indexMagic, IndexMagic, sizeof(indexMagic)) == 0 && indexOffset < fileSize) {
+							this->file.seekg(indexOffset);
+							ChunkHeader chunkHeader;
+							readRaw(this->file, chunkHeader);
+							if (chunkHeader.tag == IndexTag) {
+								uint64_t count;
+								readRaw(this->file, count);
+
+								// Check the count against what's left of the file before allocating for it (the index may be corrupt)
+								const uint64_t entrySize = sizeof(int64_t) + sizeof(uint64_t);
+								const auto entriesStart = indexOffset + sizeof(ChunkHeader) + sizeof(uint64_t);
+								const auto entriesAvailable = fileSize > entriesStart
+									? (fileSize - entriesStart) / entrySize
+									: 0;
+								if (count <= entriesAvailable) {
+									this->index.resize(count);
+									hasIndex = true;
+									for (auto & entry : this->index) {
+										int64_t recordTime;
+										readRaw(this->file, recordTime);
+										readRaw(this->file, entry.offset);
+										entry.recordTime = chrono::nanoseconds(recordTime);
+										if (entry.offset >= indexOffset) {
+											hasIndex = false;
+											break;
+										}
+									}
+									if (!hasIndex) {
+										this->index.clear();
+									}
+								}
+							}
+						}
+					}
+
+					if (!hasIndex) {
+						this->file.clear();
+						this->rebuildIndex(fileSize);
+					}
+				}
+
+				//----------
+				void Reader::close() {
+					if (this->file.is_open()) {
+						this->file.close();
+					}
+					this->file.clear();
+					this->index.clear();
+				}
+
+				//----------
+				bool Reader::isOpen() const {
+					return this->file.is_open();
+				}
+
+				//----------
+				size_t Reader::getFrameCount() const {
+					return this->index.size();
+				}
+
+				//----------
+				chrono::nanoseconds Reader::getDuration() const {
+					if (this->index.empty()) {
+						return chrono::nanoseconds(0);
+					}
+					return this->index.back().recordTime - this->index.front().recordTime;
+				}
+
+				//----------
+				const vector<IndexEntry> & Reader::getIndex() const {
+					return this->index;
+				}
+
+				//----------
+				size_t Reader::findFrame(chrono::nanoseconds recordTime) const {
+					auto it = lower_bound(this->index.begin(), this->index.end(), recordTime, [](const IndexEntry & entry, chrono::nanoseconds time) {
+						return entry.recordTime < time;
+					});
+					return (size_t)(it - this->index.begin());
+				}
+
+				//----------
+				void Reader::read(size_t frameIndex, Frame & frame) {
+					if (frameIndex >= this->index.size()) {
+						throw(ofxRulr::Exception("FrameStream : frame " + ofToString(frameIndex) + " is out of range"));
+					}
+
+					this->file.clear();
+					this->file.seekg(this->index[frameIndex].offset);
+
+					ChunkHeader chunkHeader;
+					readRaw(this->file, chunkHeader);
+					if (chunkHeader.tag != FrameTag) {
+						throw(ofxRulr::Exception("FrameStream : index points to a chunk which isn't a frame"));
+					}
+
+					FrameHeader header;
+					readRaw(this->file, header);
+					frame.frameIndex = header.frameIndex;
+					frame.timestamp = chrono::nanoseconds(header.timestamp);
+					frame.recordTime = chrono::nanoseconds(header.recordTime);
+
+					frame.regions.resize(header.regionCount);
+					for (auto & region : frame.regions) {
+						RegionHeader regionHeader;
+						readRaw(this->file, regionHeader);
+						region = cv::Rect(regionHeader.x, regionHeader.y, regionHeader.width, regionHeader.height);
+					}
+
+					frame.image.create(header.height, header.width, header.type);
+					const auto imageBounds = cv::Rect(0, 0, frame.image.cols, frame.image.rows);
+					const auto pixelSize = frame.image.elemSize();
+
+					const bool isWholeImage = frame.regions.size() == 1 && frame.regions.front() == imageBounds;
+					if (!isWholeImage) {
+						frame.image.setTo(cv::Scalar::all(0));
+					}
+
+					for (const auto & region : frame.regions) {
+						if ((region & imageBounds) != region) {
+							throw(ofxRulr::Exception("FrameStream : region is outside the image"));
+						}
+						const auto rowSize = region.width * pixelSize;
+						if (isWholeImage && frame.image.isContinuous()) {
+							this->file.read((char *) frame.image.data, rowSize * region.height);
+						}
+						else {
+							for (int y = region.y; y < region.y + region.height; y++) {
+								this->file.read((char *) frame.image.ptr(y, region.x), rowSize);
+							}
+						}
+					}
+					if (!this->file) {
+						throw(ofxRulr::Exception("FrameStream : unexpected end of file"));
+					}
+				}
+
+				//----------
+				void Reader::rebuildIndex(uint64_t fileSize) {
+					this->index.clear();
+
+					uint64_t position = sizeof(FileMagic);
+					while (position + sizeof(ChunkHeader) <= fileSize) {
+						this->file.seekg(position);
+						ChunkHeader chunkHeader;
+						this->file.read((char *) &chunkHeader, sizeof(chunkHeader));
+						if (!this->file) {
+							break;
+						}
+
+						const auto chunkEnd = position + sizeof(ChunkHeader) + chunkHeader.payloadSize;
+						if (chunkEnd > fileSize) {
+							// Truncated (the recording didn't finish)
+							break;
+						}
+
+						if (chunkHeader.tag == FrameTag) {
+							FrameHeader frameHeader;
+							this->file.read((char *) &frameHeader, sizeof(frameHeader));
+							if (!this->file) {
+								break;
+							}
+							this->index.push_back({ chrono::nanoseconds(frameHeader.recordTime), position });
+						}
+						else if (chunkHeader.tag != IndexTag) {
+							// Not one of ours, so we can't trust anything after this
+							break;
+						}
+
+						position = chunkEnd;
+					}
+					this->file.clear();
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <fstream>
+
+namespace ofxRulr {
+	namespace Nodes {
+		namespace MoCap {
+			/// Append-only binary file of camera frames (whole images or just regions of them).
+			///
+			/// Layout (little endian) :
+			///		header : "RULRFRM1"
+			///		chunks : { uint32 tag, uint32 reserved, uint64 payload size, payload }
+			///			'FRME' : frame index, device timestamp [ns], record time [ns], width, height, cv type,
+			///			         region count, regions { x, y, width, height }, then each region's pixels
+			///			'INDX' : count, { record time [ns], file offset of the frame chunk }
+			///		trailer : uint64 offset of the INDX chunk, "RULRIDX1"
+			///
+			/// The index and trailer are written on close. If they are missing (e.g. the app crashed
+			/// whilst recording) the reader rebuilds the index by scanning the chunks.
+			namespace FrameStream {
+				struct Frame {
+					uint64_t frameIndex = 0;
+					chrono::nanoseconds timestamp{ 0 }; ///< From the device
+					chrono::nanoseconds recordTime{ 0 }; ///< Since the start of the recording
+					cv::Mat image; ///< Full size. Pixels outside the regions are zero
+					vector<cv::Rect> regions;
+				};
+
+				struct IndexEntry {
+					chrono::nanoseconds recordTime;
+					uint64_t offset;
+				};
+
+				class Writer {
+				public:
+					~Writer();
+
+					void open(const filesystem::path &);
+					void close();
+					bool isOpen() const;
+
+					/// Writes the given regions of the image (or the whole image if regions is empty)
+					void write(uint64_t frameIndex
+						, chrono::nanoseconds timestamp
+						, chrono::nanoseconds recordTime
+						, const cv::Mat & image
+						, const vector<cv::Rect> & regions);
+
+					size_t getFrameCount() const;
+					uint64_t getBytesWritten() const;
+				protected:
+					ofstream file;
+					filesystem::path path;
+					vector<char> fileBuffer;
+					vector<IndexEntry> index;
+					uint64_t position = 0;
+					vector<cv::Rect> clippedRegions;
+				};
+
+				class Reader {
+				public:
+					void open(const filesystem::path &);
+					void close();
+					bool isOpen() const;
+
+					size_t getFrameCount() const;
+					chrono::nanoseconds getDuration() const;
+					const vector<IndexEntry> & getIndex() const;
+
+					/// First frame at or after the given time since the start of the recording
+					size_t findFrame(chrono::nanoseconds recordTime) const;
+
+					/// Reuses the frame's image storage where possible
+					void read(size_t frameIndex, Frame &);
+				protected:
+					void rebuildIndex(uint64_t fileSize);
+
+					ifstream file;
+					vector<IndexEntry> index;
+				};
+			}
+		}
+	}
+}
@@ -0,0 +1,343 @@
+#include "pch_Plugin_MoCap.h"
+#include "MarkerAssignment.h"
+
+namespace ofxRulr {
+	namespace Nodes {
+		namespace MoCap {
+			//----------
+			static uint32_t findRoot(vector<uint32_t> & parents, uint32_t index) {
+				while (parents[index] != index) {
+					parents[index] = parents[parents[index]];
+					index = parents[index];
+				}
+				return index;
+			}
+
+			//----------
+			void MarkerAssignment::process(const vector<cv::Point2f> & projectedMarkers
+				, const vector<cv::Point2f> & centroids
+				, const Settings & settings
+				, Workspace & workspace
+				, vector<Match> & matches
+				, Report & report) {
+				matches.clear();
+				report = Report();
+
+				if (projectedMarkers.empty() || centroids.empty() || !(settings.distanceThresholdSquared > 0.0f)) {
+					return;
+				}
+
+				MarkerAssignment::findCandidates(projectedMarkers
+					, centroids
+					, settings.distanceThresholdSquared
+					, workspace);
+				auto & candidates = workspace.candidates;
+				report.candidateCount = candidates.size();
+				if (candidates.empty()) {
+					return;
+				}
+
+				const auto markerCount = (uint32_t) projectedMarkers.size();
+				const auto centroidCount = (uint32_t) centroids.size();
+
+				// Group the candidates into connected components
+				auto & parents = workspace.parents;
+				parents.resize(markerCount + centroidCount);
+				for (uint32_t i = 0; i < parents.size(); i++) {
+					parents[i] = i;
+				}
+				workspace.centroidCandidateCounts.assign(centroidCount, 0);
+				for (const auto & candidate : candidates) {
+					auto rootA = findRoot(parents, candidate.markerIndex);
+					auto rootB = findRoot(parents, markerCount + candidate.centroidIndex);
+					if (rootA != rootB) {
+						parents[max(rootA, rootB)] = min(rootA, rootB);
+					}
+					workspace.centroidCandidateCounts[candidate.centroidIndex]++;
+				}
+				for (auto count : workspace.centroidCandidateCounts) {
+					if (count > 1) {
+						report.contestedCount++;
+					}
+				}
+
+				// Sort candidates by component (then distance), so each component is a contiguous span
+				auto & componentRoots = workspace.componentRoots;
+				componentRoots.resize(candidates.size());
+				for (size_t i = 0; i < candidates.size(); i++) {
+					componentRoots[i] = findRoot(parents, candidates[i].markerIndex);
+				}
+				{
+					auto & order = workspace.candidateOrder;
+					order.resize(candidates.size());
+					for (uint32_t i = 0; i < order.size(); i++) {
+						order[i] = i;
+					}
+					sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+						if (componentRoots[a] != componentRoots[b]) {
+							return componentRoots[a] < componentRoots[b];
+						}
+						return candidates[a].distanceSquared < candidates[b].distanceSquared;
+					});
+
+					auto & sortedCandidates = workspace.sortedCandidates;
+					auto & sortedRoots = workspace.sortedRoots;
+					sortedCandidates.resize(candidates.size());
+					sortedRoots.resize(candidates.size());
+					for (size_t i = 0; i < order.size(); i++) {
+						sortedCandidates[i] = candidates[order[i]];
+						sortedRoots[i] = componentRoots[order[i]];
+					}
+					candidates.swap(sortedCandidates);
+					componentRoots.swap(sortedRoots);
+				}
+
+				workspace.markerUsed.assign(markerCount, 0);
+				workspace.centroidUsed.assign(centroidCount, 0);
+
+				size_t spanStart = 0;
+				while (spanStart < candidates.size()) {
+					auto spanEnd = spanStart + 1;
+					while (spanEnd < candidates.size() && componentRoots[spanEnd] == componentRoots[spanStart]) {
+						spanEnd++;
+					}
+					const auto spanCount = spanEnd - spanStart;
+					if (spanCount > 1) {
+						report.largestComponent = max(report.largestComponent, spanCount);
+					}
+
+					if (spanCount == 1) {
+						// Uncontested
+						const auto & candidate = candidates[spanStart];
+						matches.push_back({ candidate.markerIndex, candidate.centroidIndex, candidate.distanceSquared });
+					}
+					else if (settings.optimal) {
+						MarkerAssignment::solveComponentOptimal(candidates.data() + spanStart
+							, spanCount
+							, settings.distanceThresholdSquared
+							, workspace
+							, matches);
+					}
+					else {
+						// Greedy : take the shortest edges first (span is sorted by distance)
+						for (size_t i = spanStart; i < spanEnd; i++) {
+							const auto & candidate = candidates[i];
+							if (workspace.markerUsed[candidate.markerIndex] || workspace.centroidUsed[candidate.centroidIndex]) {
+								continue;
+							}
+							workspace.markerUsed[candidate.markerIndex] = 1;
+							workspace.centroidUsed[candidate.centroidIndex] = 1;
+							matches.push_back({ candidate.markerIndex, candidate.centroidIndex, candidate.distanceSquared });
+						}
+					}
+
+					spanStart = spanEnd;
+				}
+
+				sort(matches.begin(), matches.end(), [](const Match & a, const Match & b) {
+					return a.centroidIndex < b.centroidIndex;
+				});
+				for (const auto & match : matches) {
+					report.cost += match.distanceSquared;
+				}
+			}
+
+			//----------
+			void MarkerAssignment::findCandidates(const vector<cv::Point2f> & projectedMarkers
+				, const vector<cv::Point2f> & centroids
+				, float distanceThresholdSquared
+				, Workspace & workspace) {
+				auto & candidates = workspace.candidates;
+				candidates.clear();
+
+				// Bounds of the centroids
+				cv::Point2f minimum = centroids.front();
+				cv::Point2f maximum = centroids.front();
+				for (const auto & centroid : centroids) {
+					minimum.x = min(minimum.x, centroid.x);
+					minimum.y = min(minimum.y, centroid.y);
+					maximum.x = max(maximum.x, centroid.x);
+					maximum.y = max(maximum.y, centroid.y);
+				}
+
+				// Cells at least as large as the gate, and no more than 256 x 256 of them
+				const auto threshold = sqrt(distanceThresholdSquared);
+				const auto cellSize = max(max(threshold, 1.0f)
+					, max(maximum.x - minimum.x, maximum.y - minimum.y) / 256.0f);
+				const int gridWidth = (int) ((maximum.x - minimum.x) / cellSize) + 1;
+				const int gridHeight = (int) ((maximum.y - minimum.y) / cellSize) + 1;
+
+				auto getCellIndex = [&](const cv::Point2f & point) {
+					auto x = min((int) ((point.x - minimum.x) / cellSize), gridWidth - 1);
+					auto y = min((int) ((point.y - minimum.y) / cellSize), gridHeight - 1);
+					return (uint32_t) (y * gridWidth + x);
+				};
+
+				// Counting sort of the centroids into cells
+				auto & cellStarts = workspace.cellStarts;
+				auto & cellEntries = workspace.cellEntries;
+				cellStarts.assign(gridWidth * gridHeight + 1, 0);
+				for (const auto & centroid : centroids) {
+					cellStarts[getCellIndex(centroid) + 1]++;
+				}
+				for (size_t i = 1; i < cellStarts.size(); i++) {
+					cellStarts[i] += cellStarts[i - 1];
+				}
+				cellEntries.resize(centroids.size());
+				{
+					auto & cellFill = workspace.cellFill;
+					cellFill.assign(cellStarts.begin(), cellStarts.end() - 1);
+					for (uint32_t i = 0; i < centroids.size(); i++) {
+						cellEntries[cellFill[getCellIndex(centroids[i])]++] = i;
+					}
+				}
+
+				// Query the cells overlapping each marker's gate
+				for (uint32_t markerIndex = 0; markerIndex < projectedMarkers.size(); markerIndex++) {
+					const auto & marker = projectedMarkers[markerIndex];
+					if (!(marker.x == marker.x && marker.y == marker.y)) {
+						// NaN
+						continue;
+					}
+
+					// Clamp in float first (projected markers can be far outside the image)
+					auto getCellRange = [&](float value, float gridMinimum, int gridSize, int & first, int & last) {
+						auto firstF = floor((value - threshold - gridMinimum) / cellSize);
+						auto lastF = floor((value + threshold - gridMinimum) / cellSize);
+						first = (int) max(firstF, 0.0f);
+						last = (int) min(lastF, (float) (gridSize - 1));
+						return lastF >= 0.0f && firstF <= (float) (gridSize - 1);
+					};
+					int x0, x1, y0, y1;
+					if (!getCellRange(marker.x, minimum.x, gridWidth, x0, x1)
+						|| !getCellRange(marker.y, minimum.y, gridHeight, y0, y1)) {
+						continue;
+					}
+
+					for (int y = y0; y <= y1; y++) {
+						for (int x = x0; x <= x1; x++) {
+							const auto cellIndex = y * gridWidth + x;
+							for (auto i = cellStarts[cellIndex]; i < cellStarts[cellIndex + 1]; i++) {
+								const auto centroidIndex = cellEntries[i];
+								const auto delta = centroids[centroidIndex] - marker;
+								const auto distanceSquared = delta.x * delta.x + delta.y * delta.y;
+								if (distanceSquared < distanceThresholdSquared) {
+									candidates.push_back({ markerIndex, centroidIndex, distanceSquared });
+								}
+							}
+						}
+					}
+				}
+			}
+
+			//----------
+			void MarkerAssignment::solveComponentOptimal(const Workspace::Candidate * candidates
+				, size_t candidateCount
+				, float distanceThresholdSquared
+				, Workspace & workspace
+				, vector<Match> & matches) {
+				// Local indices for the markers (rows) and centroids (columns) in this component
+				auto & componentMarkers = workspace.componentMarkers;
+				auto & componentCentroids = workspace.componentCentroids;
+				componentMarkers.clear();
+				componentCentroids.clear();
+				for (size_t i = 0; i < candidateCount; i++) {
+					componentMarkers.push_back(candidates[i].markerIndex);
+					componentCentroids.push_back(candidates[i].centroidIndex);
+				}
+				sort(componentMarkers.begin(), componentMarkers.end());
+				componentMarkers.erase(unique(componentMarkers.begin(), componentMarkers.end()), componentMarkers.end());
+				sort(componentCentroids.begin(), componentCentroids.end());
+				componentCentroids.erase(unique(componentCentroids.begin(), componentCentroids.end()), componentCentroids.end());
+
+				// Every row also gets its own 'unassigned' column, so rows <= columns always holds
+				const auto rows = (int) componentMarkers.size();
+				const auto columns = (int) componentCentroids.size() + rows;
+
+				// Leaving a marker unassigned costs the gate, anything outside the gate costs more than that
+				const double unassignedCost = distanceThresholdSquared;
+				const double blockedCost = 2.0 * distanceThresholdSquared + 1.0;
+
+				auto & costs = workspace.costs;
+				costs.assign((size_t) rows * columns, blockedCost);
+				for (int row = 0; row < rows; row++) {
+					costs[(size_t) row * columns + componentCentroids.size() + row] = unassignedCost;
+				}
+				for (size_t i = 0; i < candidateCount; i++) {
+					const auto row = lower_bound(componentMarkers.begin(), componentMarkers.end(), candidates[i].markerIndex) - componentMarkers.begin();
+					const auto column = lower_bound(componentCentroids.begin(), componentCentroids.end(), candidates[i].centroidIndex) - componentCentroids.begin();
+					costs[(size_t) row * columns + column] = candidates[i].distanceSquared;
+				}
+
+				// Hungarian algorithm with potentials, O(rows^2 * columns). Indices are 1-based, 0 is a sentinel
+				auto & u = workspace.u;
+				auto & v = workspace.v;
+				auto & minimumValues = workspace.minimumValues;
+				auto & columnRows = workspace.columnRows;
+				auto & way = workspace.way;
+				auto & columnUsed = workspace.columnUsed;
+				u.assign(rows + 1, 0.0);
+				v.assign(columns + 1, 0.0);
+				columnRows.assign(columns + 1, 0);
+				way.assign(columns + 1, 0);
+
+				const auto infinity = numeric_limits<double>::max();
+				for (int row = 1; row <= rows; row++) {
+					columnRows[0] = row;
+					int column0 = 0;
+					minimumValues.assign(columns + 1, infinity);
+					columnUsed.assign(columns + 1, 0);
+					do {
+						columnUsed[column0] = 1;
+						const auto row0 = columnRows[column0];
+						auto delta = infinity;
+						int column1 = 0;
+						for (int column = 1; column <= columns; column++) {
+							if (columnUsed[column]) {
+								continue;
+							}
+							const auto reducedCost = costs[(size_t) (row0 - 1) * columns + (column - 1)] - u[row0] - v[column];
+							if (reducedCost < minimumValues[column]) {
+								minimumValues[column] = reducedCost;
+								way[column] = column0;
+							}
+							if (minimumValues[column] < delta) {
+								delta = minimumValues[column];
+								column1 = column;
+							}
+						}
+						for (int column = 0; column <= columns; column++) {
+							if (columnUsed[column]) {
+								u[columnRows[column]] += delta;
+								v[column] -= delta;
+							}
+							else {
+								minimumValues[column] -= delta;
+							}
+						}
+						column0 = column1;
+					} while (columnRows[column0] != 0);
+
+					do {
+						const auto column1 = way[column0];
+						columnRows[column0] = columnRows[column1];
+						column0 = column1;
+					} while (column0 != 0);
+				}
+
+				// Read out the real (non-'unassigned') assignments
+				for (int column = 1; column <= (int) componentCentroids.size(); column++) {
+					const auto row = columnRows[column];
+					if (row == 0) {
+						continue;
+					}
+					const auto cost = costs[(size_t) (row - 1) * columns + (column - 1)];
+					if (cost >= unassignedCost) {
+						continue;
+					}
+					matches.push_back({ componentMarkers[row - 1], componentCentroids[column - 1], (float) cost });
+				}
+			}
+		}
+	}
+}
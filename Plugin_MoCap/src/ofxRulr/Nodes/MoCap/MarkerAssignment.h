@@ -0,0 +1,86 @@
+#pragma once
+
+namespace ofxRulr {
+	namespace Nodes {
+		namespace MoCap {
+			/// Assigns detected centroids to projected markers one-to-one.
+			/// Centroids are binned into a uniform grid (cell size >= threshold) so that each marker
+			/// only sees the centroids within the gating distance. The candidate graph is split into
+			/// connected components, and each contested component is solved either greedily
+			/// (shortest edges first) or optimally (Hungarian, minimising the summed squared distance
+			/// with 'unassigned' costing the threshold).
+			class MarkerAssignment {
+			public:
+				struct Settings {
+					float distanceThresholdSquared = 400.0f; ///< [px^2]
+					bool optimal = true;
+				};
+
+				struct Match {
+					size_t markerIndex;
+					size_t centroidIndex;
+					float distanceSquared;
+				};
+
+				struct Report {
+					float cost = 0.0f; ///< Sum of squared distances of the matches [px^2]
+					size_t candidateCount = 0; ///< Marker-centroid pairs inside the gate
+					size_t contestedCount = 0; ///< Centroids inside the gate of more than one marker
+					size_t largestComponent = 0; ///< Candidates in the largest contested group
+				};
+
+				/// Per-frame scratch space (keep one per frame so its storage gets reused)
+				struct Workspace {
+					struct Candidate {
+						uint32_t markerIndex;
+						uint32_t centroidIndex;
+						float distanceSquared;
+					};
+
+					vector<uint32_t> cellStarts;
+					vector<uint32_t> cellFill;
+					vector<uint32_t> cellEntries;
+					vector<Candidate> candidates;
+					vector<uint32_t> parents; // union-find over markers then centroids
+					vector<uint32_t> centroidCandidateCounts;
+					vector<uint32_t> componentRoots;
+					vector<uint32_t> candidateOrder;
+					vector<Candidate> sortedCandidates;
+					vector<uint32_t> sortedRoots;
+					vector<uint8_t> markerUsed;
+					vector<uint8_t> centroidUsed;
+
+					// Hungarian
+					vector<double> costs;
+					vector<double> u;
+					vector<double> v;
+					vector<double> minimumValues;
+					vector<int> columnRows;
+					vector<int> way;
+					vector<uint8_t> columnUsed;
+					vector<uint32_t> componentMarkers;
+					vector<uint32_t> componentCentroids;
+				};
+
+				/// Matches are returned sorted by centroid index
+				static void process(const vector<cv::Point2f> & projectedMarkers
+					, const vector<cv::Point2f> & centroids
+					, const Settings &
+					, Workspace &
+					, vector<Match> & matches
+					, Report &);
+			protected:
+				static void findCandidates(const vector<cv::Point2f> & projectedMarkers
+					, const vector<cv::Point2f> & centroids
+					, float distanceThresholdSquared
+					, Workspace &);
+
+				static void solveComponentOptimal(const Workspace::Candidate * candidates
+					, size_t candidateCount
+					, float distanceThresholdSquared
+					, Workspace &
+					, vector<Match> & matches);
+			};
+		}
+	}
+}
@@ -159,6 +159,18 @@ namespace ofxRulr {
 				inspector->addButton("Force use capture", [this]() {
 					this->needsForceUseCapture.store(true);
 				});
+				inspector->addIndicatorBool("Using pose prediction", [this]() {
+					return this->lastFrameUsedPrediction.load();
+				});
+				inspector->addButton("Reset pose prediction", [this]() {
+					this->posePredictor->reset();
+				});
+				inspector->addLiveValue<float>("Assignment cost [px^2]", [this]() {
+					return this->lastAssignmentCost.load();
+				});
+				inspector->addLiveValue<size_t>("Contested centroids", [this]() {
+					return this->lastContestedCentroids.load();
+				});
 			}
 
 			//----------
@@ -174,8 +186,9 @@ namespace ofxRulr {
 			//----------
 			void MatchMarkers::processFrame(shared_ptr<FindMarkerCentroidsFrame> incomingFrame) {
 				//construct the output frame
-				auto outputFrame = make_shared<MatchMarkersFrame>();
+				auto outputFrame = this->acquireOutgoingFrame();
 				outputFrame->incomingFrame = incomingFrame;
+				outputFrame->posePredictor = this->posePredictor;
 
 				{
 					auto lock = unique_lock<mutex>(this->descriptionMutex);
@@ -248,7 +261,10 @@ namespace ofxRulr {
 					this->needsForceUseCapture.store(false);
 				}
 
-				this->onNewFrame.notifyListeners(move(outputFrame));
+				this->lastFrameUsedPrediction.store(outputFrame->usedPrediction);
+				this->lastAssignmentCost.store(outputFrame->result.assignment.cost);
+				this->lastContestedCentroids.store(outputFrame->result.assignment.contestedCount);
+				this->emitFrame(move(outputFrame));
 			}
 
 			//----------
@@ -261,13 +277,49 @@ namespace ofxRulr {
 					, outputFrame->modelViewRotationVector
 					, outputFrame->modelViewTranslation);
 
+				const auto & bodyDescription = outputFrame->bodyDescription;
+				const auto & cameraDescription = outputFrame->cameraDescription;
+				auto modelTransform = bodyDescription->modelTransform;
+
+				//start from where we expect the body to be at the time of this frame rather than where it was last seen
+				if (this->parameters.posePrediction.enabled) {
+					cv::Mat predictedRotationVector, predictedTranslation;
+					if (outputFrame->posePredictor->predict(predictedRotationVector
+						, predictedTranslation
+						, outputFrame->incomingFrame->receivedTime
+						, chrono::milliseconds((int) this->parameters.posePrediction.maximumAge.get()))) {
+						outputFrame->modelViewRotationVector = predictedRotationVector;
+						outputFrame->modelViewTranslation = predictedTranslation;
+						outputFrame->usedPrediction = true;
+
+						//the predicted pose decides which markers are in view too
+						auto cameraTransform = ofxCv::makeMatrix(cameraDescription->inverseRotationVector
+							, cameraDescription->inverseTranslation);
+
+						cv::Mat cameraRotationInverse;
+						cv::Mat cameraTranslationInverse;
+						ofxCv::decomposeMatrix(glm::inverse(cameraTransform)
+							, cameraRotationInverse
+							, cameraTranslationInverse);
+
+						cv::Mat modelRotationVector, modelTranslation;
+						cv::composeRT(predictedRotationVector
+							, predictedTranslation
+							, cameraRotationInverse
+							, cameraTranslationInverse
+							, modelRotationVector
+							, modelTranslation);
+						modelTransform = ofxCv::makeMatrix(modelRotationVector, modelTranslation);
+					}
+				}
+
 				//first check the markers are inside the camera image
 				//(cvProjectPoints will happily give us weird results for markers outside view, e.g. distortion loop back, behind cam)
 				{
 					vector<glm::vec3> matrixProjections;
 					for (int i = 0; i < bodyDescription->markerCount; i++) {
 						const auto & objectSpacePoint = bodyDescription->markers.positions[i];
-						const auto worldSpace = Utils::applyTransform(bodyDescription->modelTransform, objectSpacePoint);
+						const auto worldSpace = Utils::applyTransform(modelTransform, objectSpacePoint);
 						const auto projectionSpace = Utils::applyTransform(cameraDescription->viewProjectionMatrix, worldSpace);
 						if (projectionSpace.z < -1 || projectionSpace.z > 1) {
 							//outside of depth clipping range
@@ -292,8 +344,29 @@ namespace ofxRulr {
 			//----------
 			shared_ptr<MatchMarkersFrame> MatchMarkers::processCheckKnownPoses(shared_ptr<MatchMarkersFrame> & outputFrame) {
 				auto captures = this->captures.getSelection();
+
+				//try the captures nearest to the predicted (or last) pose first
+				if (!outputFrame->modelViewRotationVector.empty() && captures.size() > 1) {
+					vector<pair<float, shared_ptr<Capture>>> rankedCaptures;
+					for (auto capture : captures) {
+						auto distance = PosePredictor::getPoseDistance(outputFrame->modelViewRotationVector
+							, outputFrame->modelViewTranslation
+							, cv::Mat(capture->modelViewRotationVector)
+							, cv::Mat(capture->modelViewTranslation));
+						rankedCaptures.emplace_back(distance, capture);
+					}
+					stable_sort(rankedCaptures.begin(), rankedCaptures.end(), [](const pair<float, shared_ptr<Capture>> & a, const pair<float, shared_ptr<Capture>> & b) {
+						return a.first < b.first;
+					});
+					for (size_t i = 0; i < rankedCaptures.size(); i++) {
+						captures[i] = rankedCaptures[i].second;
+					}
+				}
+
+				// One frame for the whole search, rather than one per capture from the frame pool
+				auto searchFrame = this->acquireOutgoingFrame();
 				for (auto capture : captures) {
-					auto searchFrame = make_shared<MatchMarkersFrame>(* outputFrame);
+					*searchFrame = *outputFrame;
 
 					searchFrame->modelViewRotationVector = cv::Mat(capture->modelViewRotationVector);
 					searchFrame->modelViewTranslation = cv::Mat(capture->modelViewTranslation);
@@ -339,31 +412,24 @@ namespace ofxRulr {
 					, outputFrame->search.projectedMarkerImagePoints);
 
 				//clear the result
-				outputFrame->result = MatchMarkersFrame::Result();
-
-				for (size_t centroidIndex = 0; centroidIndex < outputFrame->incomingFrame->centroids.size(); centroidIndex++) {
+				outputFrame->result.clear();
+
+				//match each centroid to at most one marker (and vice versa) within the threshold
+				MarkerAssignment::Settings assignmentSettings;
+				assignmentSettings.distanceThresholdSquared = outputFrame->distanceThresholdSquared;
+				assignmentSettings.optimal = this->parameters.assignmentMethod.get() == AssignmentMethod::Optimal;
+				MarkerAssignment::process(outputFrame->search.projectedMarkerImagePoints
+					, outputFrame->incomingFrame->centroids
+					, assignmentSettings
+					, outputFrame->assignmentWorkspace
+					, outputFrame->assignmentMatches
+					, outputFrame->result.assignment);
+
+				for (const auto & match : outputFrame->assignmentMatches) {
+					const auto & matchIndex = match.markerIndex;
+					const auto & centroidIndex = match.centroidIndex;
 					const auto & centroid = outputFrame->incomingFrame->centroids[centroidIndex];
 
-					map<float, size_t> matchesByDistance; // { distanceSquared, marker index in incoming frame vector}
-
-														  //find all matching markers
-					for (size_t i = 0; i < outputFrame->search.count; i++) {
-						//find distance
-						const auto & markerProjected = outputFrame->search.projectedMarkerImagePoints[i];
-						const auto delta = centroid - markerProjected;
-						const auto distanceSquared = delta.x * delta.x + delta.y * delta.y;
-
-						if (distanceSquared < outputFrame->distanceThresholdSquared) {
-							matchesByDistance.emplace(distanceSquared, i);
-						}
-					}
-
-					if (matchesByDistance.empty()) {
-						//no match found
-						continue;
-					}
-
-					auto matchIndex = matchesByDistance.begin()->second;
 					outputFrame->result.markerListIndicies.push_back(matchIndex);
 					outputFrame->result.markerIDs.push_back(outputFrame->search.markerIDs[matchIndex]);
 					outputFrame->result.projectedPoints.push_back(outputFrame->search.projectedMarkerImagePoints[matchIndex]);
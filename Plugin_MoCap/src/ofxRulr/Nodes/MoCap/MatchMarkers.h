@@ -3,6 +3,7 @@
 #include "ThreadedProcessNode.h"
 #include "FindMarkerCentroids.h"
 #include "Body.h"
+#include "MarkerAssignment.h"
 
 namespace ofxRulr {
 	namespace Nodes {
@@ -20,9 +21,11 @@ namespace ofxRulr {
 				shared_ptr<FindMarkerCentroidsFrame> incomingFrame;
 				shared_ptr<Body::Description> bodyDescription;
 				shared_ptr<CameraDescription> cameraDescription;
+				shared_ptr<PosePredictor> posePredictor; // UpdateTracking feeds its results back into this
 
 				cv::Mat modelViewRotationVector;
 				cv::Mat modelViewTranslation;
+				bool usedPrediction = false;
 
 				struct Search {
 					size_t count;
@@ -33,6 +36,10 @@ namespace ofxRulr {
 
 				float distanceThresholdSquared;
 
+				// Working data for processModelViewTransform
+				MarkerAssignment::Workspace assignmentWorkspace;
+				vector<MarkerAssignment::Match> assignmentMatches;
+
 				struct Result {
 					bool success = false;
 					bool forceTakeTransform = false;
@@ -45,7 +52,38 @@ namespace ofxRulr {
 					vector<size_t> centroidIndex;
 					vector<cv::Point3f> objectSpacePoints;
 					float reprojectionError = 0.0f;
+					MarkerAssignment::Report assignment;
+
+					// Keeps the vectors' storage
+					void clear() {
+						this->success = false;
+						this->forceTakeTransform = false;
+						this->trackingWasLost = false;
+						this->count = 0;
+						this->markerListIndicies.clear();
+						this->markerIDs.clear();
+						this->projectedPoints.clear();
+						this->centroids.clear();
+						this->centroidIndex.clear();
+						this->objectSpacePoints.clear();
+						this->reprojectionError = 0.0f;
+						this->assignment = MarkerAssignment::Report();
+					}
 				} result;
+
+				// Clear for reuse by the frame pool
+				void reset() {
+					this->incomingFrame.reset();
+					this->bodyDescription.reset();
+					this->cameraDescription.reset();
+					this->posePredictor.reset();
+					this->usedPrediction = false;
+					this->search.count = 0;
+					this->search.markerIDs.clear();
+					this->search.objectSpacePoints.clear();
+					this->search.projectedMarkerImagePoints.clear();
+					this->result.clear();
+				}
 			};
 
 			class MatchMarkers : public ThreadedProcessNode<FindMarkerCentroids
@@ -82,6 +120,10 @@ namespace ofxRulr {
 					, (Selected, Always)
 					, ("Selected", "Always"));
 
+				MAKE_ENUM(AssignmentMethod
+					, (Greedy, Optimal)
+					, ("Greedy", "Optimal"));
+
 				void processFrame(shared_ptr<FindMarkerCentroidsFrame>) override;
 				void processTrackingSearch(shared_ptr<MatchMarkersFrame> &);
 				shared_ptr<MatchMarkersFrame> processCheckKnownPoses(shared_ptr<MatchMarkersFrame> &);
@@ -91,7 +133,15 @@ namespace ofxRulr {
 					ofParameter<float> trackingDistanceThreshold{ "Tracking distance threshold [px]", 20, 0, 300 };
 					ofParameter<float> refindTrackingThreshold{ "Re-find tracking threshold [px]", 30, 0, 300 };
 					ofParameter<WhenDrawWorld> whenDraw{ "Draw when", WhenDrawWorld::Selected };
-					PARAM_DECLARE("MatchMarkers", trackingDistanceThreshold, refindTrackingThreshold, whenDraw);
+					ofParameter<AssignmentMethod> assignmentMethod{ "Assignment method", AssignmentMethod::Optimal };
+
+					struct : ofParameterGroup {
+						ofParameter<bool> enabled{ "Enabled", true };
+						ofParameter<float> maximumAge{ "Maximum age [ms]", 500 };
+						PARAM_DECLARE("Pose prediction", enabled, maximumAge);
+					} posePrediction;
+
+					PARAM_DECLARE("MatchMarkers", trackingDistanceThreshold, refindTrackingThreshold, whenDraw, assignmentMethod, posePrediction);
 				} parameters;
 
 				Utils::CaptureSet<Capture> captures;
@@ -100,6 +150,11 @@ namespace ofxRulr {
 				shared_ptr<CameraDescription> cameraDescription;
 				mutex descriptionMutex;
 
+				shared_ptr<PosePredictor> posePredictor = make_shared<PosePredictor>();
+				atomic<bool> lastFrameUsedPrediction{ false };
+				atomic<float> lastAssignmentCost{ 0.0f };
+				atomic<size_t> lastContestedCentroids{ 0 };
+
 				atomic<bool> needsTakeCapture = false;
 				atomic<bool> needsForceUseCapture = false;
 				ofThreadChannel<shared_ptr<Capture>> newCaptures;
@@ -0,0 +1,219 @@
+#include "pch_Plugin_MoCap.h"
+#include "MultiViewSolvePnP.h"
+
+namespace ofxRulr {
+	namespace Nodes {
+		namespace MoCap {
+			//----------
+			void MultiViewSolvePnP::setView(View & view
+				, const cv::Mat & cameraMatrix
+				, const cv::Mat & distortionCoefficients
+				, const cv::Mat & viewRotationVector
+				, const cv::Mat & viewTranslation
+				, const vector<cv::Point2f> & imagePoints
+				, const vector<cv::Point3f> & objectPoints) {
+				cv::Mat rotationVector, translation;
+				viewRotationVector.convertTo(rotationVector, CV_64F);
+				viewTranslation.convertTo(translation, CV_64F);
+				cv::Rodrigues(rotationVector, view.rotation);
+				view.translation = cv::Vec3d(translation.reshape(1, 3));
+
+				cv::Mat cameraMatrixDouble;
+				cameraMatrix.convertTo(cameraMatrixDouble, CV_64F);
+				view.focalLength = (cameraMatrixDouble.at<double>(0, 0) + cameraMatrixDouble.at<double>(1, 1)) / 2.0;
+
+				view.objectPoints = objectPoints;
+				if (imagePoints.empty()) {
+					view.normalizedImagePoints.clear();
+				}
+				else {
+					cv::undistortPoints(imagePoints
+						, view.normalizedImagePoints
+						, cameraMatrix
+						, distortionCoefficients);
+				}
+			}
+
+			//----------
+			MultiViewSolvePnP::Result MultiViewSolvePnP::solve(const vector<View> & views
+				, cv::Vec3d & rotationVector
+				, cv::Vec3d & translation
+				, const Settings & settings) {
+				Result result;
+
+				cv::Matx33d rotation;
+				cv::Rodrigues(rotationVector, rotation);
+
+				Matx66d JtJ;
+				Vec6d Jtr;
+				double inlierSumSquaredError = 0.0;
+				auto cost = MultiViewSolvePnP::evaluate(views, rotation, translation, settings.huberThreshold, &JtJ, &Jtr, result, inlierSumSquaredError);
+				if (result.observationCount < 3) {
+					// 6 parameters need at least 3 points
+					return result;
+				}
+
+				double lambda = 1e-3;
+				for (int iteration = 0; iteration < settings.maxIterations; iteration++) {
+					result.iterations = iteration + 1;
+
+					// Levenberg-Marquardt step (damping the diagonal)
+					auto A = JtJ;
+					for (int i = 0; i < 6; i++) {
+						A(i, i) += lambda * (JtJ(i, i) + 1e-9);
+					}
+					Vec6d step;
+					if (!cv::solve(A, -Jtr, step, cv::DECOMP_CHOLESKY)) {
+						lambda *= 10.0;
+						continue;
+					}
+
+					// Rotation is updated on the left (in world space) : R' = exp(w) R
+					cv::Matx33d deltaRotation;
+					cv::Rodrigues(cv::Vec3d(step[0], step[1], step[2]), deltaRotation);
+					const cv::Matx33d candidateRotation = deltaRotation * rotation;
+					const cv::Vec3d candidateTranslation = translation + cv::Vec3d(step[3], step[4], step[5]);
+
+					Matx66d candidateJtJ;
+					Vec6d candidateJtr;
+					Result candidateResult;
+					double candidateInlierSumSquaredError = 0.0;
+					auto candidateCost = MultiViewSolvePnP::evaluate(views, candidateRotation, candidateTranslation, settings.huberThreshold
+						, &candidateJtJ, &candidateJtr, candidateResult, candidateInlierSumSquaredError);
+
+					if (candidateCost < cost) {
+						rotation = candidateRotation;
+						translation = candidateTranslation;
+						JtJ = candidateJtJ;
+						Jtr = candidateJtr;
+						result.observationCount = candidateResult.observationCount;
+						result.inlierCount = candidateResult.inlierCount;
+						inlierSumSquaredError = candidateInlierSumSquaredError;
+
+						const auto improvement = cost - candidateCost;
+						cost = candidateCost;
+						lambda = max(lambda / 10.0, 1e-9);
+
+						if (cv::norm(step) < 1e-9 || improvement < 1e-10 * cost) {
+							break;
+						}
+					}
+					else {
+						lambda *= 10.0;
+						if (lambda > 1e9) {
+							break;
+						}
+					}
+				}
+
+				cv::Rodrigues(rotation, rotationVector);
+				result.reprojectionError = (float) sqrt(inlierSumSquaredError / (double) max<size_t>(result.inlierCount, 1));
+				result.success = result.inlierCount >= 3;
+				return result;
+			}
+
+			//----------
+			double MultiViewSolvePnP::evaluate(const vector<View> & views
+				, const cv::Matx33d & rotation
+				, const cv::Vec3d & translation
+				, float huberThreshold
+				, Matx66d * JtJ
+				, Vec6d * Jtr
+				, Result & result
+				, double & inlierSumSquaredError) {
+				double cost = 0.0;
+				if (JtJ) {
+					*JtJ = Matx66d::zeros();
+					*Jtr = Vec6d::all(0.0);
+				}
+				result.observationCount = 0;
+				result.inlierCount = 0;
+				inlierSumSquaredError = 0.0;
+
+				const double huber = huberThreshold;
+				const double inlierThresholdSquared = 9.0 * huber * huber;
+
+				for (const auto & view : views) {
+					const auto count = min(view.objectPoints.size(), view.normalizedImagePoints.size());
+					const auto & f = view.focalLength;
+
+					for (size_t i = 0; i < count; i++) {
+						const auto & objectPoint = view.objectPoints[i];
+						const cv::Vec3d rotated = rotation * cv::Vec3d(objectPoint.x, objectPoint.y, objectPoint.z);
+						const cv::Vec3d cameraPoint = view.rotation * (rotated + translation) + view.translation;
+						if (cameraPoint[2] < 1e-6) {
+							// Behind the camera
+							continue;
+						}
+
+						const auto inverseZ = 1.0 / cameraPoint[2];
+						const auto & observed = view.normalizedImagePoints[i];
+						const double residual[2] = {
+							f * (cameraPoint[0] * inverseZ - observed.x)
+							, f * (cameraPoint[1] * inverseZ - observed.y)
+						};
+						const auto errorSquared = residual[0] * residual[0] + residual[1] * residual[1];
+						const auto error = sqrt(errorSquared);
+
+						// Huber : quadratic near zero, linear in the tails
+						double weight = 1.0;
+						if (error <= huber) {
+							cost += 0.5 * errorSquared;
+						}
+						else {
+							weight = huber / error;
+							cost += huber * (error - 0.5 * huber);
+						}
+						result.observationCount++;
+						if (errorSquared <= inlierThresholdSquared) {
+							inlierSumSquaredError += errorSquared;
+							result.inlierCount++;
+						}
+
+						if (!JtJ) {
+							continue;
+						}
+
+						// d(residual)/d(cameraPoint)
+						const cv::Matx<double, 2, 3> dProjection(
+							f * inverseZ, 0.0, -f * cameraPoint[0] * inverseZ * inverseZ
+							, 0.0, f * inverseZ, -f * cameraPoint[1] * inverseZ * inverseZ);
+
+						// d(worldPoint)/d(rotation step) = -[rotated]x, d(worldPoint)/d(translation step) = I
+						const cv::Matx33d negativeSkew(
+							0.0, rotated[2], -rotated[1]
+							, -rotated[2], 0.0, rotated[0]
+							, rotated[1], -rotated[0], 0.0);
+						const cv::Matx<double, 2, 3> dRotation = dProjection * view.rotation * negativeSkew;
+						const cv::Matx<double, 2, 3> dTranslation = dProjection * view.rotation;
+
+						double J[2][6];
+						for (int row = 0; row < 2; row++) {
+							for (int column = 0; column < 3; column++) {
+								J[row][column] = dRotation(row, column);
+								J[row][column + 3] = dTranslation(row, column);
+							}
+						}
+
+						for (int a = 0; a < 6; a++) {
+							for (int b = a; b < 6; b++) {
+								(*JtJ)(a, b) += weight * (J[0][a] * J[0][b] + J[1][a] * J[1][b]);
+							}
+							(*Jtr)[a] += weight * (J[0][a] * residual[0] + J[1][a] * residual[1]);
+						}
+					}
+				}
+
+				if (JtJ) {
+					for (int a = 0; a < 6; a++) {
+						for (int b = 0; b < a; b++) {
+							(*JtJ)(a, b) = (*JtJ)(b, a);
+						}
+					}
+				}
+
+				return cost;
+			}
+		}
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+namespace ofxRulr {
+	namespace Nodes {
+		namespace MoCap {
+			/// Finds one body pose (object -> world) which agrees with the marker observations of several
+			/// calibrated cameras at once. A small fixed-size Levenberg-Marquardt solve over the 6 pose
+			/// parameters with a Huber loss, so a handful of iterations over a few hundred observations
+			/// takes well under a millisecond. Observations are undistorted up front, so the inner loop
+			/// is a plain pinhole projection.
+			class MultiViewSolvePnP {
+			public:
+				struct View {
+					// World -> camera
+					cv::Matx33d rotation;
+					cv::Vec3d translation;
+
+					double focalLength = 1.0; ///< Scales normalized residuals to pixels
+
+					vector<cv::Point2f> normalizedImagePoints;
+					vector<cv::Point3f> objectPoints;
+				};
+
+				struct Settings {
+					int maxIterations = 10;
+					float huberThreshold = 2.0f; ///< [px]
+				};
+
+				struct Result {
+					bool success = false;
+					int iterations = 0;
+					size_t observationCount = 0;
+					size_t inlierCount = 0; ///< Observations within 3x the Huber threshold
+					float reprojectionError = 0.0f; ///< RMS over the inliers [px]
+				};
+
+				/// Fill a view from a camera's calibration and its matched markers
+				static void setView(View &
+					, const cv::Mat & cameraMatrix
+					, const cv::Mat & distortionCoefficients
+					, const cv::Mat & viewRotationVector
+					, const cv::Mat & viewTranslation
+					, const vector<cv::Point2f> & imagePoints
+					, const vector<cv::Point3f> & objectPoints);
+
+				/// rotationVector and translation are the initial guess and receive the result
+				static Result solve(const vector<View> &
+					, cv::Vec3d & rotationVector
+					, cv::Vec3d & translation
+					, const Settings &);
+			protected:
+				typedef cv::Matx<double, 6, 6> Matx66d;
+				typedef cv::Vec<double, 6> Vec6d;
+
+				/// Returns the robust cost. Fills the normal equations if JtJ is given
+				static double evaluate(const vector<View> &
+					, const cv::Matx33d & rotation
+					, const cv::Vec3d & translation
+					, float huberThreshold
+					, Matx66d * JtJ
+					, Vec6d * Jtr
+					, Result & result
+					, double & inlierSumSquaredError);
+			};
+		}
+	}
+}
@@ -81,7 +81,7 @@ namespace ofxRulr {
 					sender->sendBundle(bundle);
 				}
 				
-				this->onNewFrame.notifyListeners(shared_ptr<void*>());
+				this->emitFrame(shared_ptr<void*>());
 			}
 
 			//----------
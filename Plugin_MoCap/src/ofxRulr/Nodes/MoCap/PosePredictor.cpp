@@ -0,0 +1,150 @@
+#include "pch_Plugin_MoCap.h"
+#include "PosePredictor.h"
+
+namespace ofxRulr {
+	namespace Nodes {
+		namespace MoCap {
+			//----------
+			// Accepts 3x1 or 1x3, float or double
+			static cv::Vec3d toVec3d(const cv::Mat & vector) {
+				cv::Mat vectorDouble;
+				vector.convertTo(vectorDouble, CV_64F);
+				auto data = vectorDouble.reshape(1, 3);
+				return cv::Vec3d(data.at<double>(0), data.at<double>(1), data.at<double>(2));
+			}
+
+			//----------
+			void PosePredictor::addMeasurement(const cv::Mat & rotationVectorMat, const cv::Mat & translationMat, Clock::time_point time, const Settings & settings) {
+				auto rotation = toVec3d(rotationVectorMat);
+				auto translation = toVec3d(translationMat);
+
+				unique_lock<mutex> lock(this->stateMutex);
+
+				// Restart the model after a gap, a loss of tracking, or a jump in the rotation vector (e.g. wrapping past 180 degrees)
+				const auto maximumGap = chrono::milliseconds(500);
+				const double maximumRotationStep = 1.0; // [rad]
+				if (this->needsInitialise
+					|| this->measurementCount == 0
+					|| time - this->lastMeasurementTime > maximumGap
+					|| cv::norm(rotation - this->rotation) > maximumRotationStep
+					|| settings.useKalmanFilter != this->kalmanFilterActive) {
+					this->initialise(rotation, translation, settings);
+					this->lastMeasurementTime = time;
+					return;
+				}
+
+				// Frames can arrive out of order (e.g. from several cameras), skip any older than what we have
+				auto dt = chrono::duration<double>(time - this->lastMeasurementTime).count();
+				if (dt <= 0.0) {
+					return;
+				}
+
+				if (settings.useKalmanFilter) {
+					// Constant velocity : position += velocity * dt
+					auto & transitionMatrix = this->kalmanFilter.transitionMatrix;
+					for (int i = 0; i < 6; i++) {
+						transitionMatrix.at<double>(i, i + 6) = dt;
+					}
+					cv::setIdentity(this->kalmanFilter.processNoiseCov, cv::Scalar::all(settings.processNoise));
+					cv::setIdentity(this->kalmanFilter.measurementNoiseCov, cv::Scalar::all(settings.measurementNoise));
+
+					cv::Mat measurement(6, 1, CV_64F);
+					for (int i = 0; i < 3; i++) {
+						measurement.at<double>(i) = rotation[i];
+						measurement.at<double>(i + 3) = translation[i];
+					}
+
+					this->kalmanFilter.predict();
+					const auto & state = this->kalmanFilter.correct(measurement);
+					for (int i = 0; i < 3; i++) {
+						this->rotation[i] = state.at<double>(i);
+						this->translation[i] = state.at<double>(i + 3);
+						this->rotationVelocity[i] = state.at<double>(i + 6);
+						this->translationVelocity[i] = state.at<double>(i + 9);
+					}
+				}
+				else {
+					this->rotationVelocity = (rotation - this->rotation) / dt;
+					this->translationVelocity = (translation - this->translation) / dt;
+					this->rotation = rotation;
+					this->translation = translation;
+				}
+
+				this->lastMeasurementTime = time;
+				this->measurementCount++;
+			}
+
+			//----------
+			void PosePredictor::notifyTrackingLost() {
+				unique_lock<mutex> lock(this->stateMutex);
+				this->needsInitialise = true;
+			}
+
+			//----------
+			void PosePredictor::reset() {
+				unique_lock<mutex> lock(this->stateMutex);
+				this->measurementCount = 0;
+				this->needsInitialise = true;
+			}
+
+			//----------
+			bool PosePredictor::predict(cv::Mat & rotationVector, cv::Mat & translation, Clock::time_point time, chrono::milliseconds maximumAge) const {
+				unique_lock<mutex> lock(this->stateMutex);
+				if (this->measurementCount == 0) {
+					return false;
+				}
+
+				auto age = time - this->lastMeasurementTime;
+				if (age > maximumAge) {
+					return false;
+				}
+
+				auto dt = chrono::duration<double>(age).count();
+				rotationVector = cv::Mat(this->rotation + this->rotationVelocity * dt, true);
+				translation = cv::Mat(this->translation + this->translationVelocity * dt, true);
+				return true;
+			}
+
+			//----------
+			float PosePredictor::getPoseDistance(const cv::Mat & rotationVectorA, const cv::Mat & translationA
+				, const cv::Mat & rotationVectorB, const cv::Mat & translationB) {
+				auto rA = toVec3d(rotationVectorA);
+				auto tA = toVec3d(translationA);
+				auto rB = toVec3d(rotationVectorB);
+				auto tB = toVec3d(translationB);
+
+				// Angle between the two rotations
+				cv::Matx33d rotationA, rotationB;
+				cv::Rodrigues(rA, rotationA);
+				cv::Rodrigues(rB, rotationB);
+				cv::Vec3d deltaRotation;
+				cv::Rodrigues(rotationA.t() * rotationB, deltaRotation);
+
+				auto depth = (cv::norm(tA) + cv::norm(tB)) / 2.0;
+				return (float) (cv::norm(tA - tB) + cv::norm(deltaRotation) * depth);
+			}
+
+			//----------
+			void PosePredictor::initialise(const cv::Vec3d & rotation, const cv::Vec3d & translation, const Settings & settings) {
+				this->rotation = rotation;
+				this->translation = translation;
+				this->rotationVelocity = cv::Vec3d();
+				this->translationVelocity = cv::Vec3d();
+				this->measurementCount = 1;
+				this->needsInitialise = false;
+
+				this->kalmanFilterActive = settings.useKalmanFilter;
+				if (settings.useKalmanFilter) {
+					this->kalmanFilter.init(12, 6, 0, CV_64F);
+					cv::setIdentity(this->kalmanFilter.transitionMatrix);
+					cv::setIdentity(this->kalmanFilter.measurementMatrix);
+					cv::setIdentity(this->kalmanFilter.errorCovPost, cv::Scalar::all(settings.errorPost));
+					for (int i = 0; i < 3; i++) {
+						this->kalmanFilter.statePost.at<double>(i) = rotation[i];
+						this->kalmanFilter.statePost.at<double>(i + 3) = translation[i];
+					}
+				}
+			}
+		}
+	}
+}
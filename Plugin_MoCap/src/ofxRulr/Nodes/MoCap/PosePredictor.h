@@ -0,0 +1,57 @@
+#pragma once
+
+#include <mutex>
+#include <chrono>
+
+namespace ofxRulr {
+	namespace Nodes {
+		namespace MoCap {
+			/// Predicts the next model-view pose of a body from recent tracking results with a
+			/// constant-velocity model (optionally smoothed by a Kalman filter).
+			/// The rotation is extrapolated as a rotation vector, which is fine for the small
+			/// rotations between frames. Thread safe.
+			class PosePredictor {
+			public:
+				typedef chrono::high_resolution_clock Clock;
+
+				struct Settings {
+					bool useKalmanFilter = false;
+					float processNoise = 1e-5f;
+					float measurementNoise = 1e-2f;
+					float errorPost = 1.0f;
+				};
+
+				/// time is when the frame which was measured was captured (e.g. its receivedTime), not when the measurement was made
+				void addMeasurement(const cv::Mat & rotationVector, const cv::Mat & translation, Clock::time_point time, const Settings &);
+
+				/// The next measurement restarts the motion model (e.g. we jumped to a known pose)
+				void notifyTrackingLost();
+				void reset();
+
+				/// Predict the pose at time (e.g. the receivedTime of the frame being matched).
+				/// Returns false if the last measurement is older than maximumAge at that time
+				bool predict(cv::Mat & rotationVector, cv::Mat & translation, Clock::time_point time, chrono::milliseconds maximumAge) const;
+
+				/// A distance between poses for ranking, where rotation is converted to displacement at the body's depth [m]
+				static float getPoseDistance(const cv::Mat & rotationVectorA, const cv::Mat & translationA
+					, const cv::Mat & rotationVectorB, const cv::Mat & translationB);
+			protected:
+				void initialise(const cv::Vec3d & rotation, const cv::Vec3d & translation, const Settings &);
+
+				mutable mutex stateMutex;
+
+				cv::Vec3d rotation;
+				cv::Vec3d translation;
+				cv::Vec3d rotationVelocity; // per second
+				cv::Vec3d translationVelocity; // per second
+
+				Clock::time_point lastMeasurementTime;
+				size_t measurementCount = 0;
+				bool needsInitialise = true;
+
+				cv::KalmanFilter kalmanFilter;
+				bool kalmanFilterActive = false;
+			};
+		}
+	}
+}
@@ -88,7 +88,7 @@ namespace ofxRulr {
 					auto lock = unique_lock<mutex>(this->previewFrameMutex);
 					this->previewFrame = incomingFrame;
 				}
-				this->onNewFrame(shared_ptr<void *>());
+				this->emitFrame(shared_ptr<void *>());
 			}
 
 			//----------
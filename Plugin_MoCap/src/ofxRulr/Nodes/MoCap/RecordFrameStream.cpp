@@ -0,0 +1,221 @@
+#include "pch_Plugin_MoCap.h"
+#include "RecordFrameStream.h"
+
+#include "FindMarkerCentroids.h"
+
+namespace ofxRulr {
+	namespace Nodes {
+		namespace MoCap {
+			//----------
+			RecordFrameStream::RecordFrameStream() {
+				RULR_NODE_INIT_LISTENER;
+			}
+
+			//----------
+			RecordFrameStream::~RecordFrameStream() {
+				try {
+					this->stopRecording();
+				}
+				RULR_CATCH_ALL_TO_ERROR;
+			}
+
+			//----------
+			string RecordFrameStream::getTypeName() const {
+				return "MoCap::RecordFrameStream";
+			}
+
+			//----------
+			void RecordFrameStream::init() {
+				RULR_NODE_INSPECTOR_LISTENER;
+				RULR_NODE_UPDATE_LISTENER;
+
+				{
+					auto input = this->addInput<Item::Camera>();
+					input->onNewConnection += [this](shared_ptr<Item::Camera> inputNode) {
+						inputNode->onNewFrame.addListener([this](shared_ptr<ofxMachineVision::Frame> frame) {
+							if (this->recording && this->parameters.source.get() == Source::Camera) {
+								this->recordFrame(frame, vector<cv::Rect>());
+							}
+						}, this);
+					};
+					input->onDeleteConnection += [this](shared_ptr<Item::Camera> inputNode) {
+						if (inputNode) {
+							inputNode->onNewFrame.removeListeners(this);
+						}
+					};
+				}
+
+				{
+					auto input = this->addInput<FindMarkerCentroids>();
+					input->onNewConnection += [this](shared_ptr<FindMarkerCentroids> inputNode) {
+						inputNode->onNewFrame.addListener([this](shared_ptr<FindMarkerCentroidsFrame> incomingFrame) {
+							if (!this->recording || this->parameters.source.get() != Source::MarkerRegions) {
+								return;
+							}
+							if (!incomingFrame->imageFrame) {
+								return;
+							}
+
+							// Copy what we need so that the pooled frame can be recycled straight away
+							const auto margin = this->parameters.regionMargin.get();
+							vector<cv::Rect> regions;
+							regions.reserve(incomingFrame->boundingRects.size());
+							for (const auto & boundingRect : incomingFrame->boundingRects) {
+								regions.emplace_back(boundingRect.x - margin
+									, boundingRect.y - margin
+									, boundingRect.width + margin * 2
+									, boundingRect.height + margin * 2);
+							}
+							if (regions.empty()) {
+								// An empty region so that we record that the frame happened without writing any pixels
+								// (no regions at all would mean the whole image)
+								regions.emplace_back(0, 0, 0, 0);
+							}
+							this->recordFrame(incomingFrame->imageFrame, move(regions));
+						}, this);
+					};
+					input->onDeleteConnection += [this](shared_ptr<FindMarkerCentroids> inputNode) {
+						if (inputNode) {
+							inputNode->onNewFrame.removeListeners(this);
+						}
+					};
+				}
+
+				this->manageParameters(this->parameters);
+			}
+
+			//----------
+			void RecordFrameStream::update() {
+				auto currentRate = (float)this->framesWrittenSinceLastAppFrame.exchange(0) / ofGetLastFrameTime();
+				this->framesWrittenPerSecond = ofLerp(this->framesWrittenPerSecond, currentRate, 0.1f);
+			}
+
+			//----------
+			void RecordFrameStream::populateInspector(ofxCvGui::InspectArguments & inspectArgs) {
+				auto inspector = inspectArgs.inspector;
+
+				inspector->addButton("Start recording", [this]() {
+					try {
+						auto result = ofSystemSaveDialog(this->getDefaultFilename() + ".rulrframes", "Record frames to");
+						if (result.bSuccess) {
+							this->startRecording(result.filePath);
+						}
+					}
+					RULR_CATCH_ALL_TO_ALERT;
+				}, ' ');
+				inspector->addButton("Stop recording", [this]() {
+					try {
+						this->stopRecording();
+					}
+					RULR_CATCH_ALL_TO_ALERT;
+				});
+				inspector->addIndicatorBool("Recording", [this]() {
+					return this->isRecording();
+				});
+				inspector->addLiveValue<string>("File", [this]() {
+					return this->recordingPath;
+				});
+				inspector->addLiveValueHistory("Frames written [Hz]", [this]() {
+					return this->framesWrittenPerSecond;
+				});
+				inspector->addLiveValue<uint64_t>("Frames written", [this]() {
+					return this->framesWritten.load();
+				});
+				inspector->addLiveValue<uint64_t>("Dropped frames", [this]() {
+					return this->droppedFrames.load();
+				});
+				inspector->addLiveValue<float>("Written [MB]", [this]() {
+					return (float)this->bytesWritten.load() / (float)(1 << 20);
+				});
+				inspector->addLiveValueHistory("Write time [ms]", [this]() {
+					return this->writeTime.load();
+				});
+			}
+
+			//----------
+			void RecordFrameStream::startRecording(const filesystem::path & path) {
+				this->stopRecording();
+
+				{
+					unique_lock<mutex> lock(this->writerMutex);
+					this->writer.open(path);
+				}
+
+				this->recordingPath = path.string();
+				this->framesWritten = 0;
+				this->bytesWritten = 0;
+				this->droppedFrames = 0;
+
+				unique_lock<mutex> lock(this->writerThreadMutex);
+				this->writerThread = make_unique<Utils::ThreadPool>(1, (size_t) max(this->parameters.queueSize.get(), 1));
+				this->nextFrameIndex = 0;
+				this->recordingStart = Clock::now();
+				this->recording.store(true);
+			}
+
+			//----------
+			void RecordFrameStream::stopRecording() {
+				unique_ptr<Utils::ThreadPool> writerThread;
+				{
+					unique_lock<mutex> lock(this->writerThreadMutex);
+					this->recording.store(false);
+					swap(writerThread, this->writerThread);
+				}
+				if (!writerThread) {
+					return;
+				}
+
+				// Let the writer finish what's queued before closing the file (the pool doesn't drain on destruction)
+				while (writerThread->getQueueSize() > 0 || writerThread->getStatistics().activeWorkers > 0) {
+					this_thread::sleep_for(chrono::milliseconds(1));
+				}
+				writerThread.reset();
+
+				unique_lock<mutex> lock(this->writerMutex);
+				this->writer.close();
+			}
+
+			//----------
+			bool RecordFrameStream::isRecording() const {
+				return this->recording.load();
+			}
+
+			//----------
+			void RecordFrameStream::recordFrame(shared_ptr<ofxMachineVision::Frame> frame, vector<cv::Rect> && regions) {
+				unique_lock<mutex> lock(this->writerThreadMutex);
+				if (!this->writerThread) {
+					return;
+				}
+
+				const auto recordTime = chrono::duration_cast<chrono::nanoseconds>(Clock::now() - this->recordingStart);
+				const auto frameIndex = this->nextFrameIndex++; // counts dropped frames too, so drops show as gaps
+
+				auto action = [this, frame, regions = move(regions), recordTime, frameIndex]() {
+					auto startTime = Clock::now();
+					{
+						unique_lock<mutex> lock(this->writerMutex);
+						if (!this->writer.isOpen()) {
+							return;
+						}
+						auto image = ofxCv::toCv(frame->getPixels());
+						this->writer.write(frameIndex
+							, frame->getTimestamp()
+							, recordTime
+							, image
+							, regions);
+						this->bytesWritten = this->writer.getBytesWritten();
+					}
+					chrono::duration<float, milli> duration = Clock::now() - startTime;
+					this->writeTime = duration.count();
+					this->framesWritten++;
+					this->framesWrittenSinceLastAppFrame++;
+				};
+
+				// The writer keeps up or we drop frames. We never hold up the camera thread
+				if (!this->writerThread->performAsync(action)) {
+					this->droppedFrames++;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "ofxRulr/Nodes/Base.h"
+#include "ofxRulr/Nodes/Item/Camera.h"
+#include "ofxRulr/Utils/ThreadPool.h"
+
+#include "FrameStream.h"
+
+namespace ofxRulr {
+	namespace Nodes {
+		namespace MoCap {
+			/// Streams incoming camera frames to a FrameStream file on a background thread.
+			/// Either whole frames from a Camera, or only the marker regions found by FindMarkerCentroids.
+			class RecordFrameStream : public Nodes::Base {
+			public:
+				MAKE_ENUM(Source
+					, (Camera, MarkerRegions)
+					, ("Camera", "Marker regions"));
+
+				RecordFrameStream();
+				~RecordFrameStream();
+				string getTypeName() const override;
+				void init();
+				void update();
+				void populateInspector(ofxCvGui::InspectArguments &);
+
+				void startRecording(const filesystem::path &);
+				void stopRecording();
+				bool isRecording() const;
+			protected:
+				typedef chrono::high_resolution_clock Clock;
+
+				void recordFrame(shared_ptr<ofxMachineVision::Frame>, vector<cv::Rect> && regions);
+
+				struct : ofParameterGroup {
+					ofParameter<Source> source{ "Source", Source::Camera };
+					ofParameter<int> regionMargin{ "Region margin [px]", 8 };
+					ofParameter<int> queueSize{ "Queue size [frames]", 64 };
+					PARAM_DECLARE("RecordFrameStream", source, regionMargin, queueSize);
+				} parameters;
+
+				mutex writerThreadMutex; // guards writerThread, recordingStart and nextFrameIndex
+				unique_ptr<Utils::ThreadPool> writerThread; // one worker, so frames are written in order
+				Clock::time_point recordingStart;
+				uint64_t nextFrameIndex = 0;
+
+				mutex writerMutex;
+				FrameStream::Writer writer;
+
+				atomic<bool> recording{ false };
+				string recordingPath;
+
+				atomic<uint64_t> framesWritten{ 0 };
+				atomic<uint64_t> bytesWritten{ 0 };
+				atomic<uint64_t> droppedFrames{ 0 };
+				atomic<float> writeTime{ 0.0f };
+				atomic<int> framesWrittenSinceLastAppFrame{ 0 };
+				float framesWrittenPerSecond = 0.0f;
+			};
+		}
+	}
+}
@@ -22,6 +22,9 @@ namespace ofxRulr {
 
 				this->threadPool = make_unique<Utils::ThreadPool>(4, 100);
 
+				// We have no update() of our own (no GL, no other nodes), so the patch may run the ThreadedProcessNode one on a worker thread
+				this->setUpdateIsThreadSafe(true);
+
 				this->manageParameters(this->parameters);
 			}
 
@@ -97,7 +100,7 @@ namespace ofxRulr {
 						fs << "contours" << outgoingFrame->contours;
 					}
 				}
-				this->onNewFrame(outgoingFrame);
+				this->emitFrame(outgoingFrame);
 			}
 
 			//----------
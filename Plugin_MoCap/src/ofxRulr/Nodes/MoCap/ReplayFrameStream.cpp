@@ -0,0 +1,204 @@
+#include "pch_Plugin_MoCap.h"
+#include "ReplayFrameStream.h"
+
+namespace ofxRulr {
+	namespace Nodes {
+		namespace MoCap {
+			//----------
+			ReplayFrameStream::ReplayFrameStream() {
+				RULR_NODE_INIT_LISTENER;
+			}
+
+			//----------
+			ReplayFrameStream::~ReplayFrameStream() {
+				this->stop();
+			}
+
+			//----------
+			string ReplayFrameStream::getTypeName() const {
+				return "MoCap::ReplayFrameStream";
+			}
+
+			//----------
+			void ReplayFrameStream::init() {
+				RULR_NODE_INSPECTOR_LISTENER;
+				RULR_NODE_UPDATE_LISTENER;
+
+				auto input = this->addInput<Item::Camera>();
+				input->onDeleteConnection += [this](shared_ptr<Item::Camera>) {
+					this->stop();
+				};
+
+				this->manageParameters(this->parameters);
+			}
+
+			//----------
+			void ReplayFrameStream::update() {
+				// The playback thread stops by itself at the end of the file
+				if (!this->playing && this->playbackThread.joinable()) {
+					this->playbackThread.join();
+				}
+
+				auto currentRate = (float)this->framesSinceLastAppFrame.exchange(0) / ofGetLastFrameTime();
+				this->framesPerSecond = ofLerp(this->framesPerSecond, currentRate, 0.1f);
+			}
+
+			//----------
+			void ReplayFrameStream::populateInspector(ofxCvGui::InspectArguments & inspectArgs) {
+				auto inspector = inspectArgs.inspector;
+
+				inspector->addButton("Open", [this]() {
+					try {
+						auto result = ofSystemLoadDialog("Select frame stream");
+						if (result.bSuccess) {
+							this->open(result.filePath);
+						}
+					}
+					RULR_CATCH_ALL_TO_ALERT;
+				});
+				inspector->addLiveValue<string>("File", [this]() {
+					return this->filePath;
+				});
+				inspector->addLiveValue<size_t>("Frame count", [this]() {
+					return this->frameCount;
+				});
+				inspector->addLiveValue<float>("Duration [s]", [this]() {
+					return this->duration;
+				});
+
+				inspector->addButton("Play", [this]() {
+					try {
+						this->play();
+					}
+					RULR_CATCH_ALL_TO_ALERT;
+				}, ' ');
+				inspector->addButton("Stop", [this]() {
+					this->stop();
+				});
+				inspector->addIndicatorBool("Playing", [this]() {
+					return this->isPlaying();
+				});
+				inspector->addLiveValue<size_t>("Current frame", [this]() {
+					return this->currentFrame.load();
+				});
+				inspector->addLiveValue<float>("Current time [s]", [this]() {
+					return this->currentTime.load();
+				});
+				inspector->addLiveValueHistory("Frames played [Hz]", [this]() {
+					return this->framesPerSecond;
+				});
+			}
+
+			//----------
+			void ReplayFrameStream::open(const filesystem::path & path) {
+				this->stop();
+
+				this->filePath.clear();
+				this->frameCount = 0;
+				this->duration = 0.0f;
+
+				this->reader.open(path);
+
+				this->filePath = path.string();
+				this->frameCount = this->reader.getFrameCount();
+				this->duration = chrono::duration<float>(this->reader.getDuration()).count();
+				this->currentFrame = 0;
+				this->currentTime = 0.0f;
+			}
+
+			//----------
+			void ReplayFrameStream::play() {
+				this->stop();
+
+				this->throwIfMissingAConnection<Item::Camera>();
+				auto camera = this->getInput<Item::Camera>();
+
+				if (!this->reader.isOpen()) {
+					throw(ofxRulr::Exception("No file is open"));
+				}
+				if (this->reader.getFrameCount() == 0) {
+					throw(ofxRulr::Exception("File contains no frames"));
+				}
+
+				this->playing = true;
+				this->playbackThread = std::thread([this, camera]() {
+					try {
+						this->playbackLoop(camera);
+					}
+					RULR_CATCH_ALL_TO_ERROR;
+					this->playing = false;
+				});
+			}
+
+			//----------
+			void ReplayFrameStream::stop() {
+				this->playing = false;
+				if (this->playbackThread.joinable()) {
+					this->playbackThread.join();
+				}
+			}
+
+			//----------
+			bool ReplayFrameStream::isPlaying() const {
+				return this->playing.load();
+			}
+
+			//----------
+			void ReplayFrameStream::playbackLoop(shared_ptr<Item::Camera> camera) {
+				const auto & index = this->reader.getIndex();
+				const auto startTime = index.front().recordTime + chrono::duration_cast<chrono::nanoseconds>(chrono::duration<float>(max(this->parameters.startTime.get(), 0.0f)));
+				const auto realTime = this->parameters.speed.get() == Speed::RealTime;
+				const auto loop = this->parameters.loop.get();
+
+				FrameStream::Frame record;
+
+				do {
+					auto frameIndex = this->reader.findFrame(startTime);
+					if (frameIndex >= index.size()) {
+						throw(ofxRulr::Exception("Start time is after the end of the recording"));
+					}
+
+					// Playback time 0 is the first frame we play
+					const auto firstRecordTime = index[frameIndex].recordTime;
+					const auto playbackStart = Clock::now();
+
+					for (; frameIndex < index.size() && this->playing; frameIndex++) {
+						this->reader.read(frameIndex, record);
+
+						if (realTime) {
+							const auto dueTime = playbackStart + chrono::duration_cast<Clock::duration>(record.recordTime - firstRecordTime);
+							// Sleep in short steps so that stop() doesn't have to wait out a long gap in the recording
+							while (this->playing && Clock::now() < dueTime) {
+								this_thread::sleep_for(min<Clock::duration>(dueTime - Clock::now(), chrono::milliseconds(10)));
+							}
+							if (!this->playing) {
+								break;
+							}
+						}
+
+						if (record.image.depth() != CV_8U) {
+							throw(ofxRulr::Exception("Only 8 bit images can be replayed"));
+						}
+
+						// Copy out of the record (its image is reused for the next frame)
+						auto frame = make_shared<ofxMachineVision::Frame>();
+						{
+							auto & pixels = frame->getPixels();
+							pixels.allocate(record.image.cols, record.image.rows, (size_t) record.image.channels());
+							auto pixelsMat = ofxCv::toCv(pixels);
+							record.image.copyTo(pixelsMat);
+						}
+						frame->setTimestamp(record.timestamp);
+						frame->setFrameIndex(record.frameIndex);
+
+						camera->onNewFrame.notifyListeners(frame);
+
+						this->currentFrame = frameIndex;
+						this->currentTime = chrono::duration<float>(record.recordTime - index.front().recordTime).count();
+						this->framesSinceLastAppFrame++;
+					}
+				} while (loop && this->playing);
+			}
+		}
+	}
+}
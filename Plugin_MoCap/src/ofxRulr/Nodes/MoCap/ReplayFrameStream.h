@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ofxRulr/Nodes/Base.h"
+#include "ofxRulr/Nodes/Item/Camera.h"
+
+#include "FrameStream.h"
+
+namespace ofxRulr {
+	namespace Nodes {
+		namespace MoCap {
+			/// Plays a FrameStream file back into a Camera node, so that everything downstream
+			/// of the camera sees the recorded frames as if they were coming live from the device.
+			class ReplayFrameStream : public Nodes::Base {
+			public:
+				MAKE_ENUM(Speed
+					, (RealTime, MaxSpeed)
+					, ("Real time", "Max speed"));
+
+				ReplayFrameStream();
+				~ReplayFrameStream();
+				string getTypeName() const override;
+				void init();
+				void update();
+				void populateInspector(ofxCvGui::InspectArguments &);
+
+				void open(const filesystem::path &);
+				void play();
+				void stop();
+				bool isPlaying() const;
+			protected:
+				typedef chrono::high_resolution_clock Clock;
+
+				void playbackLoop(shared_ptr<Item::Camera>);
+
+				struct : ofParameterGroup {
+					ofParameter<Speed> speed{ "Speed", Speed::RealTime };
+					ofParameter<bool> loop{ "Loop", false };
+					ofParameter<float> startTime{ "Start time [s]", 0 };
+					PARAM_DECLARE("ReplayFrameStream", speed, loop, startTime);
+				} parameters;
+
+				FrameStream::Reader reader; // owned by the playback thread whilst playing
+				string filePath;
+				size_t frameCount = 0;
+				float duration = 0.0f; // [s]
+
+				std::thread playbackThread;
+				atomic<bool> playing{ false };
+				atomic<size_t> currentFrame{ 0 };
+				atomic<float> currentTime{ 0.0f };
+				atomic<int> framesSinceLastAppFrame{ 0 };
+				float framesPerSecond = 0.0f;
+			};
+		}
+	}
+}
@@ -2,57 +2,345 @@
 
 #include "ofxRulr/Nodes/Base.h"
 #include "ofxRulr/Utils/ThreadPool.h"
+#include "ofxRulr/Utils/LatencyHistogram.h"
+#include "ofxRulr/Utils/LatestValue.h"
+#include "FramePool.h"
 
 namespace ofxRulr {
 	namespace Nodes {
 		namespace MoCap {
+			// What the pipeline does with an incoming frame when its queue is full
+			MAKE_ENUM(BackpressurePolicy
+				, (DropOldest, DropNewest, Block)
+				, ("Drop oldest", "Drop newest", "Block"));
+
 			template<class IncomingNodeType
 				, class IncomingFrameType
 				, class OutgoingFrameType>
 				class ThreadedProcessNode : public Nodes::Base {
 			private:
+				typedef chrono::high_resolution_clock Clock;
+
 				atomic<float> processingTime = 0;
 				atomic<int> processedFramesSinceLastAppFrame = 0;
 				atomic<int> droppedFramesSinceLastAppFrame = 0;
+				atomic<int> allocationsSinceLastAppFrame = 0;
+				uint64_t lastFramePoolAllocationCount = 0;
 
 				float processedFramesPerSecond = 0.0f;
 				float droppedFramesPerSecond = 0.0f;
+				float allocationsPerSecond = 0.0f;
 				unique_ptr<Utils::ThreadPool> threadPool;
 
+				// Pipeline mode : incoming frames are numbered in arrival order, queued, processed by up to
+				// 'Max in flight' workers, and held in a reorder buffer so that they leave in the same order
+				struct PendingFrame {
+					uint64_t sequence;
+					shared_ptr<IncomingFrameType> frame;
+					Clock::time_point arrivalTime;
+				};
+
+				struct {
+					mutex lock;
+					condition_variable spaceAvailable;
+					deque<PendingFrame> frames;
+					size_t runnerCount = 0;
+					uint64_t nextSequence = 0;
+				} pipelineInput;
+
+				struct CompletedFrame {
+					vector<shared_ptr<OutgoingFrameType>> outgoingFrames;
+					Clock::time_point arrivalTime;
+					Clock::time_point completeTime;
+					bool dropped = false;
+				};
+
+				struct {
+					mutex lock;
+					map<uint64_t, CompletedFrame> frames;
+					uint64_t nextSequence = 0;
+					bool draining = false; // a thread is emitting frames, others leave their results to it
+					atomic<size_t> size{ 0 };
+				} reorderBuffer;
+
+				// Set on the worker thread whilst processing a frame in pipeline mode, so that emitFrame can collect the output
+				struct ActionContext {
+					ThreadedProcessNode * owner;
+					vector<shared_ptr<OutgoingFrameType>> emittedFrames;
+				};
+
+				static ActionContext *& currentActionContext() {
+					static thread_local ActionContext * context = nullptr;
+					return context;
+				}
+
+				struct {
+					Utils::LatencyHistogram queue; // arrival -> start of processing
+					Utils::LatencyHistogram process; // start -> end of processing
+					Utils::LatencyHistogram reorder; // end of processing -> emitted (pipeline only)
+					Utils::LatencyHistogram total; // arrival -> emitted
+				} latencies;
+
+				atomic<bool> closing{ false };
+
 				struct : ofParameterGroup {
 					ofParameter<bool> performInParentThread{ "Perform in parent thread", false };
 
+					struct : ofParameterGroup {
+						ofParameter<bool> enabled{ "Enabled", false };
+						ofParameter<int> maxInFlight{ "Max in flight", 2 };
+						ofParameter<int> queueSize{ "Queue size", 3 };
+						ofParameter<BackpressurePolicy> backpressure{ "Backpressure", BackpressurePolicy::DropOldest };
+						PARAM_DECLARE("Pipeline", enabled, maxInFlight, queueSize, backpressure);
+					} pipeline;
+
 					struct : ofParameterGroup {
 						ofParameter<bool> keepLastFrame{ "Keep last frame", false };
 						ofParameter<bool> performEveryAppFrame{ "Perform every app frame", false };
 						PARAM_DECLARE("Debug", keepLastFrame, performEveryAppFrame);
 					} debug;
 
-					PARAM_DECLARE("ThreadedProcessNode", performInParentThread, debug);
+					PARAM_DECLARE("ThreadedProcessNode", performInParentThread, pipeline, debug);
 				} parameters;
+
+				static float millisecondsBetween(const Clock::time_point & start, const Clock::time_point & end) {
+					return chrono::duration<float, ratio<1, 1000>>(end - start).count();
+				}
+
+				// mayBlock is false when called from the app thread, where the Block policy drops the frame instead
+				void submitToPipeline(shared_ptr<IncomingFrameType> incomingFrame, bool mayBlock) {
+					auto arrivalTime = Clock::now();
+					vector<PendingFrame> droppedFrames; // completed after we let go of the queue
+					bool startRunner = false;
+					{
+						unique_lock<mutex> lock(this->pipelineInput.lock);
+						PendingFrame pendingFrame{ this->pipelineInput.nextSequence++, incomingFrame, arrivalTime };
+
+						// Apply backpressure
+						const auto queueSize = (size_t) max(this->parameters.pipeline.queueSize.get(), 1);
+						while (pendingFrame.frame && this->pipelineInput.frames.size() >= queueSize) {
+							switch (this->parameters.pipeline.backpressure.get().get()) {
+							case BackpressurePolicy::DropNewest:
+								droppedFrames.push_back(move(pendingFrame));
+								pendingFrame.frame.reset();
+								break;
+							case BackpressurePolicy::Block:
+								if (!mayBlock) {
+									droppedFrames.push_back(move(pendingFrame));
+									pendingFrame.frame.reset();
+									break;
+								}
+								this->pipelineInput.spaceAvailable.wait(lock);
+								if (this->closing) {
+									droppedFrames.push_back(move(pendingFrame));
+									pendingFrame.frame.reset();
+								}
+								break;
+							case BackpressurePolicy::DropOldest:
+							default:
+								droppedFrames.push_back(move(this->pipelineInput.frames.front()));
+								this->pipelineInput.frames.pop_front();
+								break;
+							}
+						}
+
+						if (pendingFrame.frame) {
+							this->pipelineInput.frames.push_back(move(pendingFrame));
+
+							// Start another worker if we're allowed more in flight
+							const auto maxInFlight = (size_t) ofClamp(this->parameters.pipeline.maxInFlight.get(), 1, this->getThreadPoolSize());
+							if (this->pipelineInput.runnerCount < maxInFlight) {
+								this->pipelineInput.runnerCount++;
+								startRunner = true;
+							}
+						}
+					}
+
+					for (auto & droppedFrame : droppedFrames) {
+						this->droppedFramesSinceLastAppFrame++;
+						this->completeSequence(droppedFrame.sequence, CompletedFrame{ {}, droppedFrame.arrivalTime, arrivalTime, true });
+					}
+
+					if (startRunner) {
+						if (!this->threadPool->performAsync([this]() { this->runPipeline(); })) {
+							// The frame stays queued for the next worker
+							unique_lock<mutex> lock(this->pipelineInput.lock);
+							this->pipelineInput.runnerCount--;
+						}
+					}
+				}
+
+				// Worker loop which takes frames from the pipeline queue until it is empty
+				void runPipeline() {
+					while (true) {
+						PendingFrame pendingFrame;
+						{
+							unique_lock<mutex> lock(this->pipelineInput.lock);
+							if (this->pipelineInput.frames.empty() || this->closing) {
+								this->pipelineInput.runnerCount--;
+								return;
+							}
+							pendingFrame = move(this->pipelineInput.frames.front());
+							this->pipelineInput.frames.pop_front();
+						}
+						this->pipelineInput.spaceAvailable.notify_one();
+
+						auto startTime = Clock::now();
+						this->latencies.queue.add(millisecondsBetween(pendingFrame.arrivalTime, startTime));
+
+						ActionContext context{ this };
+						auto previousContext = currentActionContext();
+						currentActionContext() = &context;
+						try {
+							this->processFrame(pendingFrame.frame);
+						}
+						RULR_CATCH_ALL_TO_ERROR;
+						currentActionContext() = previousContext;
+
+						auto endTime = Clock::now();
+						auto duration = millisecondsBetween(startTime, endTime);
+						this->latencies.process.add(duration);
+						this->processingTime.store(duration);
+						this->processedFramesSinceLastAppFrame++;
+
+						this->completeSequence(pendingFrame.sequence, CompletedFrame{ move(context.emittedFrames), pendingFrame.arrivalTime, endTime, false });
+					}
+				}
+
+				// Store the result for a sequence number, then emit everything which is now in order.
+				// Only one thread drains at a time (which keeps the order), and it emits outside the lock
+				// so that slow listeners don't hold up the other workers
+				void completeSequence(uint64_t sequence, CompletedFrame && completedFrame) {
+					unique_lock<mutex> lock(this->reorderBuffer.lock);
+					this->reorderBuffer.frames.emplace(sequence, move(completedFrame));
+					this->reorderBuffer.size.store(this->reorderBuffer.frames.size());
+					if (this->reorderBuffer.draining) {
+						return;
+					}
+					this->reorderBuffer.draining = true;
+
+					auto & frames = this->reorderBuffer.frames;
+					vector<CompletedFrame> readyFrames;
+					while (true) {
+						while (!frames.empty() && frames.begin()->first == this->reorderBuffer.nextSequence) {
+							readyFrames.push_back(move(frames.begin()->second));
+							frames.erase(frames.begin());
+							this->reorderBuffer.nextSequence++;
+						}
+						this->reorderBuffer.size.store(frames.size());
+
+						if (readyFrames.empty()) {
+							this->reorderBuffer.draining = false;
+							return;
+						}
+
+						lock.unlock();
+						for (auto & readyFrame : readyFrames) {
+							if (!readyFrame.dropped) {
+								auto now = Clock::now();
+								this->latencies.reorder.add(millisecondsBetween(readyFrame.completeTime, now));
+								this->latencies.total.add(millisecondsBetween(readyFrame.arrivalTime, now));
+							}
+							for (auto & outgoingFrame : readyFrame.outgoingFrames) {
+								try {
+									this->onNewFrame.notifyListeners(outgoingFrame);
+								}
+								RULR_CATCH_ALL_TO_ERROR;
+							}
+						}
+						readyFrames.clear();
+						lock.lock();
+					}
+				}
 			protected:
 				virtual void processFrame(shared_ptr<IncomingFrameType> incomingFrame) = 0;
 				virtual size_t getThreadPoolSize() const { return 2; }
 				virtual size_t getThreadPoolQueueSize() const { return 3; }
 
-				// For performEveryAppFrame
+				// For performEveryAppFrame. The input thread hands frames over through lastFrameIncoming.
+				// The upstream node may emit from several workers at once, so the producer side is serialised
+				// by lastFrameIncomingMutex (which update() never takes)
+				Utils::LatestValue<shared_ptr<IncomingFrameType>> lastFrameIncoming;
+				mutex lastFrameIncomingMutex;
+
+				// update() may run on a worker whilst the inspector reads this, so use getLastFrame()
 				shared_ptr<IncomingFrameType> lastFrame;
+				mutable mutex lastFrameMutex;
 				ofxCvGui::ElementPtr reprocessLastFrameButton;
 
+				shared_ptr<IncomingFrameType> getLastFrame() const {
+					unique_lock<mutex> lock(this->lastFrameMutex);
+					return this->lastFrame;
+				}
+
+				// Outgoing frames are recycled once all downstream nodes have released them
+				FramePool<OutgoingFrameType> outgoingFramePool;
+
+				shared_ptr<OutgoingFrameType> acquireOutgoingFrame() {
+					return this->outgoingFramePool.acquire();
+				}
+
+				// For heap allocations made whilst processing which the frame pool doesn't know about (e.g. a cv::Mat resizing)
+				void notifyAllocations(int count) {
+					this->allocationsSinceLastAppFrame += count;
+				}
+
+				// Subclasses announce their output with this rather than calling onNewFrame directly,
+				// so that in pipeline mode it can wait in the reorder buffer
+				void emitFrame(shared_ptr<OutgoingFrameType> outgoingFrame) {
+					auto context = currentActionContext();
+					if (context && context->owner == this) {
+						context->emittedFrames.push_back(outgoingFrame);
+					}
+					else {
+						this->onNewFrame.notifyListeners(outgoingFrame);
+					}
+				}
+
 				function<void()> constructAction(shared_ptr<IncomingFrameType> incomingFrame) {
-					return [this, incomingFrame]() {
-						auto timeStart = chrono::high_resolution_clock::now();
+					auto arrivalTime = Clock::now();
+					return [this, incomingFrame, arrivalTime]() {
+						auto timeStart = Clock::now();
+						this->latencies.queue.add(millisecondsBetween(arrivalTime, timeStart));
+
 						this->processFrame(incomingFrame);
-						chrono::duration<float, ratio<1, 1000>> duration = chrono::high_resolution_clock::now() - timeStart;
-						this->processingTime.store(duration.count());
+
+						auto timeEnd = Clock::now();
+						auto duration = millisecondsBetween(timeStart, timeEnd);
+						this->latencies.process.add(duration);
+						this->latencies.total.add(millisecondsBetween(arrivalTime, timeEnd));
+						this->processingTime.store(duration);
 						this->processedFramesSinceLastAppFrame++;
 					};
 				}
+
+				// Send a frame for processing according to the current mode.
+				// mayBlock : whether the Block backpressure policy may wait for space (never on the app thread)
+				void submitFrame(shared_ptr<IncomingFrameType> incomingFrame, bool mayBlock = false) {
+					if (this->parameters.performInParentThread) {
+						this->constructAction(incomingFrame)();
+					}
+					else if (this->parameters.pipeline.enabled) {
+						this->submitToPipeline(incomingFrame, mayBlock);
+					}
+					else {
+						if (!this->threadPool->performAsync(this->constructAction(incomingFrame))) {
+							this->droppedFramesSinceLastAppFrame++;
+						}
+					}
+				}
 			public:
 				ThreadedProcessNode() {
 					RULR_NODE_INIT_LISTENER;
 				}
 
+				virtual ~ThreadedProcessNode() {
+					// Release anything blocked on backpressure and stop the workers
+					this->closing.store(true);
+					this->pipelineInput.spaceAvailable.notify_all();
+					this->threadPool.reset();
+				}
+
 				void init() {
 					RULR_NODE_INSPECTOR_LISTENER;
 					RULR_NODE_UPDATE_LISTENER;
@@ -62,19 +350,12 @@ namespace ofxRulr {
 					auto input = this->addInput<IncomingNodeType>();
 					input->onNewConnection += [this](shared_ptr<IncomingNodeType> inputNode) {
 						inputNode->onNewFrame.addListener([this](shared_ptr<IncomingFrameType> incomingFrame) {
-							auto action = this->constructAction(incomingFrame);
-
-							if (this->parameters.performInParentThread) {
-								action();
-							}
-							else {
-								if (!this->threadPool->performAsync(action)) {
-									this->droppedFramesSinceLastAppFrame++;
-								}
-							}
+							// Upstream can emit on the app thread too (e.g. its own 'Perform every app frame')
+							this->submitFrame(incomingFrame, !ofThread::isMainThread());
 
 							if (this->parameters.debug.keepLastFrame) {
-								this->lastFrame = incomingFrame;
+								unique_lock<mutex> lock(this->lastFrameIncomingMutex);
+								this->lastFrameIncoming.set(incomingFrame);
 							}
 						}, this);
 					};
@@ -88,15 +369,6 @@ namespace ofxRulr {
 				}
 
 				void update() {
-					if (this->reprocessLastFrameButton) {
-						if (this->lastFrame) {
-							this->reprocessLastFrameButton->setEnabled(true);
-						}
-						else {
-							this->reprocessLastFrameButton->setEnabled(false);
-						}
-					}
-
 					auto processedFramesPerSecond = (float)processedFramesSinceLastAppFrame.load() / ofGetLastFrameTime();
 					this->processedFramesPerSecond = ofLerp(this->processedFramesPerSecond, processedFramesPerSecond, 0.1f);
 					this->processedFramesSinceLastAppFrame.store(0);
@@ -105,21 +377,32 @@ namespace ofxRulr {
 					this->droppedFramesPerSecond = ofLerp(this->droppedFramesPerSecond, droppedFramesPerSecond, 0.1f);
 					this->droppedFramesSinceLastAppFrame.store(0);
 
+					{
+						auto framePoolAllocationCount = this->outgoingFramePool.getAllocationCount();
+						auto allocations = (float)(framePoolAllocationCount - this->lastFramePoolAllocationCount)
+							+ (float)this->allocationsSinceLastAppFrame.exchange(0);
+						this->lastFramePoolAllocationCount = framePoolAllocationCount;
+						this->allocationsPerSecond = ofLerp(this->allocationsPerSecond, allocations / ofGetLastFrameTime(), 0.1f);
+					}
+
 					// Perform in app frame
 					{
-						auto lastFrame = this->lastFrame; // Take a copy so thread can't change
-						if (lastFrame) {
-							if (this->parameters.debug.performEveryAppFrame) {
-								auto action = this->constructAction(lastFrame);
-								if (!this->threadPool->performAsync(action)) {
-									this->droppedFramesSinceLastAppFrame++;
-								}
+						shared_ptr<IncomingFrameType> lastFrame;
+						{
+							unique_lock<mutex> lock(this->lastFrameMutex);
+							shared_ptr<IncomingFrameType> newFrame;
+							if (this->lastFrameIncoming.tryGet(newFrame)) {
+								this->lastFrame = newFrame;
 							}
-
+							lastFrame = this->lastFrame;
 							if (!this->parameters.debug.keepLastFrame) {
 								this->lastFrame.reset();
 							}
 						}
+
+						if (lastFrame && this->parameters.debug.performEveryAppFrame) {
+							this->submitFrame(lastFrame);
+						}
 					}
 				}
 
@@ -127,18 +410,18 @@ namespace ofxRulr {
 					auto inspector = inspectArgs.inspector;
 
 					inspector->addIndicatorBool("Last frame available", [this]() {
-						return (bool) this->lastFrame;
+						return (bool) this->getLastFrame();
 					});
 
 					this->reprocessLastFrameButton = inspector->addButton("Reprocess last frame", [this]() {
-						auto lastFrame = this->lastFrame;
+						auto lastFrame = this->getLastFrame();
 						if (lastFrame) {
-							auto action = this->constructAction(lastFrame);
-							if (!this->threadPool->performAsync(action)) {
-								this->droppedFramesSinceLastAppFrame++;
-							}
+							this->submitFrame(lastFrame);
 						}
 					}, ' ');
+					this->reprocessLastFrameButton->onUpdate += [this](ofxCvGui::UpdateArguments &) {
+						this->reprocessLastFrameButton->setEnabled((bool) this->getLastFrame());
+					};
 
 					inspector->addLiveValueHistory("Processing time [ms]", [this]() {
 						return this->processingTime.load();
@@ -147,6 +430,12 @@ namespace ofxRulr {
 					inspector->addLiveValueHistory("Queue size", [this]() {
 						return this->threadPool->getQueueSize();
 					});
+					inspector->addLiveValueHistory("Queue wait time [ms]", [this]() {
+						return this->threadPool->getStatistics().waitTime;
+					});
+					inspector->addLiveValue<size_t>("Thread pool steals", [this]() {
+						return (size_t) this->threadPool->getStatistics().steals;
+					});
 
 					inspector->addLiveValueHistory("Frames processed [Hz]", [this]() {
 						return this->processedFramesPerSecond;
@@ -154,6 +443,36 @@ namespace ofxRulr {
 					inspector->addLiveValueHistory("Dropped frames [Hz]", [this]() {
 						return this->droppedFramesPerSecond;
 					});
+					inspector->addLiveValueHistory("Allocations [Hz]", [this]() {
+						return this->allocationsPerSecond;
+					});
+					inspector->addLiveValue<string>("Frame pool in use", [this]() {
+						return ofToString(this->outgoingFramePool.getInUseCount()) + " / " + ofToString(this->outgoingFramePool.getSize());
+					});
+
+					inspector->addLiveValue<size_t>("Reorder buffer", [this]() {
+						return this->reorderBuffer.size.load();
+					});
+
+					inspector->addTitle("Latency [ms]", ofxCvGui::Widgets::Title::Level::H3);
+					inspector->addLiveValue<string>("Queue", [this]() {
+						return this->latencies.queue.toString();
+					});
+					inspector->addLiveValue<string>("Process", [this]() {
+						return this->latencies.process.toString();
+					});
+					inspector->addLiveValue<string>("Reorder", [this]() {
+						return this->latencies.reorder.toString();
+					});
+					inspector->addLiveValue<string>("Total", [this]() {
+						return this->latencies.total.toString();
+					});
+					inspector->addButton("Clear latencies", [this]() {
+						this->latencies.queue.clear();
+						this->latencies.process.clear();
+						this->latencies.reorder.clear();
+						this->latencies.total.clear();
+					});
 				}
 
 				//happens in 'our thread'
@@ -33,9 +33,7 @@ namespace ofxRulr {
 					auto rigidBodyNode = this->getInput<Item::RigidBody>();
 					if (rigidBodyNode) {
 						shared_ptr<UpdateTrackingFrame> updateTrackingFrame;
-						while (this->trackingUpdateToMainThread.tryReceive(updateTrackingFrame)) {}
-
-						if (updateTrackingFrame) {
+						if (this->trackingUpdateToMainThread.tryGet(updateTrackingFrame)) {
 							rigidBodyNode->setTransform(updateTrackingFrame->transform);
 						}
 					}
@@ -52,14 +50,26 @@ namespace ofxRulr {
 
 			//----------
 			void UpdateTracking::processFrame(shared_ptr<MatchMarkersFrame> incomingFrame) {
+				//this lets FindMarkerCentroids search only around where we expect the markers to be
+				shared_ptr<TrackingFeedback> trackingFeedback;
+				if (this->parameters.feedbackSearchRegions && incomingFrame->incomingFrame) {
+					trackingFeedback = incomingFrame->incomingFrame->trackingFeedback;
+				}
+
 				//ignore if less than 3
 				if (!(incomingFrame->result.success || incomingFrame->result.forceTakeTransform)) {
-					//do nothing
+					//tracking is lost, so the next frame needs a full search
+					if (trackingFeedback) {
+						trackingFeedback->notifyTrackingLost();
+					}
+					if (incomingFrame->posePredictor) {
+						incomingFrame->posePredictor->notifyTrackingLost();
+					}
 					return;
 				}
 				
 				//construct output
-				auto outgoingFrame = make_shared<UpdateTrackingFrame>();
+				auto outgoingFrame = this->acquireOutgoingFrame();
 				outgoingFrame->incomingFrame = incomingFrame;
 				outgoingFrame->updateTarget = this->parameters.updateTarget;
 				outgoingFrame->bodyModelViewRotationVector = incomingFrame->modelViewRotationVector;
@@ -98,10 +108,39 @@ namespace ofxRulr {
 					auto reprojectionThreshold = this->parameters.reprojectionThreshold.get();
 					if (reprojectionError > reprojectionThreshold && !incomingFrame->result.forceTakeTransform) {
 						//reprojection error is too high
+						if (trackingFeedback) {
+							trackingFeedback->notifyTrackingLost();
+						}
+						if (incomingFrame->posePredictor) {
+							incomingFrame->posePredictor->notifyTrackingLost();
+						}
 						return;
 					}
 				}
 
+				//update the motion model which MatchMarkers uses to predict the next pose
+				if (incomingFrame->posePredictor) {
+					if (incomingFrame->result.forceTakeTransform || incomingFrame->result.trackingWasLost) {
+						//we've jumped, so don't take a velocity from this
+						incomingFrame->posePredictor->notifyTrackingLost();
+					}
+					incomingFrame->posePredictor->addMeasurement(outgoingFrame->bodyModelViewRotationVector
+						, outgoingFrame->bodyModelViewTranslation
+						, incomingFrame->incomingFrame->receivedTime
+						, incomingFrame->bodyDescription->posePredictorSettings);
+				}
+
+				//predict where all the markers in view will be in the next frame
+				if (trackingFeedback && !incomingFrame->search.objectSpacePoints.empty()) {
+					cv::projectPoints(incomingFrame->search.objectSpacePoints
+						, outgoingFrame->bodyModelViewRotationVector
+						, outgoingFrame->bodyModelViewTranslation
+						, incomingFrame->cameraDescription->cameraMatrix
+						, incomingFrame->cameraDescription->distortionCoefficients
+						, outgoingFrame->predictedImagePoints);
+					trackingFeedback->setPrediction(outgoingFrame->predictedImagePoints);
+				}
+
 				//apply the inverse of the camera transform
 				{
 					auto cameraTransform = ofxCv::makeMatrix(incomingFrame->cameraDescription->inverseRotationVector
@@ -140,8 +179,11 @@ namespace ofxRulr {
 						break;
 				}
 
-				this->onNewFrame.notifyListeners(outgoingFrame);
-				this->trackingUpdateToMainThread.send(outgoingFrame);
+				this->emitFrame(outgoingFrame);
+				{
+					unique_lock<mutex> lock(this->trackingUpdateSendMutex);
+					this->trackingUpdateToMainThread.set(outgoingFrame);
+				}
 			}
 		}
 	}
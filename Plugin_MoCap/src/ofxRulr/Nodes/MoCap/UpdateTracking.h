@@ -20,10 +20,20 @@ namespace ofxRulr {
 				cv::Mat bodyModelViewTranslation;
 
 				vector<cv::Point2f> reprojectedAfterTracking;
+				vector<cv::Point2f> predictedImagePoints; // all markers in view, fed back to FindMarkerCentroids
 
 				cv::Mat modelRotationVector;
 				cv::Mat modelTranslation;
 				ofMatrix4x4 transform;
+
+				// Clear for reuse by the frame pool
+				void reset() {
+					this->incomingFrame.reset();
+
+					// These share storage with the incoming frame
+					this->bodyModelViewRotationVector.release();
+					this->bodyModelViewTranslation.release();
+				}
 			};
 
 			class UpdateTracking : public ThreadedProcessNode<MatchMarkers
@@ -41,10 +51,14 @@ namespace ofxRulr {
 				struct : ofParameterGroup {
 					ofParameter<UpdateTarget> updateTarget{ "Update target", UpdateTarget::Camera };
 					ofParameter<float> reprojectionThreshold{ "Reprojection threshold [px]", 5 };
-					PARAM_DECLARE("UpdateTracking", updateTarget, reprojectionThreshold);
+					ofParameter<bool> feedbackSearchRegions{ "Feedback search regions", true };
+					PARAM_DECLARE("UpdateTracking", updateTarget, reprojectionThreshold, feedbackSearchRegions);
 				} parameters;
 
-				ofThreadChannel<shared_ptr<UpdateTrackingFrame>> trackingUpdateToMainThread;
+				// Workers may process frames concurrently, so sending to the main thread is serialised by a mutex
+				// (the main thread never takes it)
+				Utils::LatestValue<shared_ptr<UpdateTrackingFrame>> trackingUpdateToMainThread;
+				mutex trackingUpdateSendMutex;
 				atomic<float> reprojectionError;
 			};
 		}
@@ -0,0 +1,327 @@
+#include "pch_Plugin_MoCap.h"
+#include "UpdateTrackingFused.h"
+
+namespace ofxRulr {
+	namespace Nodes {
+		namespace MoCap {
+			//----------
+			UpdateTrackingFused::UpdateTrackingFused() {
+				RULR_NODE_INIT_LISTENER;
+			}
+
+			//----------
+			std::string UpdateTrackingFused::getTypeName() const {
+				return "MoCap::UpdateTrackingFused";
+			}
+
+			//----------
+			void UpdateTrackingFused::init() {
+				RULR_NODE_INSPECTOR_LISTENER;
+				RULR_NODE_UPDATE_LISTENER;
+
+				this->addInput<Item::RigidBody>();
+
+				for (size_t i = 0; i < MaxCameraCount; i++) {
+					auto input = this->addInput<MatchMarkers>("MatchMarkers " + ofToString(i + 1));
+					input->onNewConnection += [this, i](shared_ptr<MatchMarkers> inputNode) {
+						{
+							unique_lock<mutex> lock(this->pending.lock);
+							this->pending.connected[i] = true;
+						}
+						inputNode->onNewFrame.addListener([this, i](shared_ptr<MatchMarkersFrame> incomingFrame) {
+							try {
+								this->receiveFrame(i, incomingFrame);
+							}
+							RULR_CATCH_ALL_TO_ERROR;
+						}, this);
+					};
+					input->onDeleteConnection += [this, i](shared_ptr<MatchMarkers> inputNode) {
+						if (inputNode) {
+							inputNode->onNewFrame.removeListeners(this);
+						}
+						unique_lock<mutex> lock(this->pending.lock);
+						this->pending.connected[i] = false;
+						this->pending.frames[i].reset();
+					};
+				}
+
+				this->manageParameters(this->parameters);
+			}
+
+			//----------
+			void UpdateTrackingFused::update() {
+				{
+					shared_ptr<UpdateTrackingFusedFrame> frame;
+					if (this->trackingUpdateToMainThread.tryGet(frame)) {
+						auto rigidBodyNode = this->getInput<Item::RigidBody>();
+						if (rigidBodyNode) {
+							rigidBodyNode->setTransform(frame->transform);
+						}
+					}
+				}
+
+				auto updateRate = [](atomic<int> & count, float & rate) {
+					auto currentRate = (float)count.exchange(0) / ofGetLastFrameTime();
+					rate = ofLerp(rate, currentRate, 0.1f);
+				};
+				updateRate(this->setsSinceLastAppFrame, this->setsPerSecond);
+				updateRate(this->incompleteSetsSinceLastAppFrame, this->incompleteSetsPerSecond);
+				updateRate(this->failuresSinceLastAppFrame, this->failuresPerSecond);
+			}
+
+			//----------
+			void UpdateTrackingFused::populateInspector(ofxCvGui::InspectArguments & inspectArgs) {
+				auto inspector = inspectArgs.inspector;
+				inspector->addLiveValueHistory("Camera sets [Hz]", [this]() {
+					return this->setsPerSecond;
+				});
+				inspector->addLiveValueHistory("Incomplete sets [Hz]", [this]() {
+					return this->incompleteSetsPerSecond;
+				});
+				inspector->addLiveValueHistory("Failed solves [Hz]", [this]() {
+					return this->failuresPerSecond;
+				});
+				inspector->addLiveValue<size_t>("Cameras in last set", [this]() {
+					return this->camerasInLastSet.load();
+				});
+				inspector->addLiveValue<size_t>("Inliers in last set", [this]() {
+					return this->observationsInLastSet.load();
+				});
+				inspector->addLiveValue<float>("Reprojection error (RMS) [px]", [this]() {
+					return this->reprojectionError.load();
+				});
+				inspector->addLiveValueHistory("Solve time [ms]", [this]() {
+					return this->solveTime.load();
+				});
+
+				inspector->addTitle("Latency [ms]", ofxCvGui::Widgets::Title::Level::H3);
+				inspector->addLiveValue<string>("Solve", [this]() {
+					return this->latencies.solve.toString();
+				});
+				inspector->addLiveValue<string>("Image received to pose", [this]() {
+					return this->latencies.total.toString();
+				});
+				inspector->addButton("Clear latencies", [this]() {
+					this->latencies.solve.clear();
+					this->latencies.total.clear();
+				});
+			}
+
+			//----------
+			void UpdateTrackingFused::receiveFrame(size_t cameraIndex, shared_ptr<MatchMarkersFrame> incomingFrame) {
+				if (!incomingFrame->incomingFrame || !incomingFrame->cameraDescription) {
+					return;
+				}
+
+				const auto receivedTime = incomingFrame->incomingFrame->receivedTime;
+				const auto window = chrono::duration_cast<Clock::duration>(chrono::duration<float, milli>(this->parameters.synchronisationWindow.get()));
+
+				// Sets which are ready to solve (at most the previous time step and this one)
+				vector<CameraSet> readySets;
+				bool previousSetIncomplete = false;
+
+				{
+					unique_lock<mutex> lock(this->pending.lock);
+					auto & frames = this->pending.frames;
+
+					// A second frame from the same camera, or a frame outside the window, means the pending time step is over
+					bool pendingSetIsOver = (bool)frames[cameraIndex];
+					bool anyPending = false;
+					for (const auto & frame : frames) {
+						if (frame) {
+							anyPending = true;
+							if (receivedTime - frame->incomingFrame->receivedTime > window) {
+								pendingSetIsOver = true;
+							}
+						}
+					}
+					if (pendingSetIsOver && anyPending) {
+						CameraSet set;
+						for (auto & frame : frames) {
+							if (frame) {
+								set.push_back(move(frame));
+								frame.reset();
+							}
+						}
+						readySets.push_back(move(set));
+						previousSetIncomplete = true;
+					}
+
+					frames[cameraIndex] = incomingFrame;
+
+					// Complete when every connected camera has a frame
+					bool complete = true;
+					for (size_t i = 0; i < MaxCameraCount; i++) {
+						if (this->pending.connected[i] && !frames[i]) {
+							complete = false;
+							break;
+						}
+					}
+					if (complete) {
+						CameraSet set;
+						for (auto & frame : frames) {
+							if (frame) {
+								set.push_back(move(frame));
+								frame.reset();
+							}
+						}
+						readySets.push_back(move(set));
+					}
+				}
+
+				if (previousSetIncomplete) {
+					this->incompleteSetsSinceLastAppFrame++;
+				}
+
+				for (const auto & set : readySets) {
+					this->processCameraSet(set);
+				}
+			}
+
+			//----------
+			void UpdateTrackingFused::processCameraSet(const CameraSet & cameraSet) {
+				auto startTime = Clock::now();
+
+				auto outgoingFrame = make_shared<UpdateTrackingFusedFrame>();
+				outgoingFrame->receivedTime = Clock::time_point::max();
+				for (const auto & frame : cameraSet) {
+					outgoingFrame->receivedTime = min(outgoingFrame->receivedTime, frame->incomingFrame->receivedTime);
+				}
+
+				unique_lock<mutex> lock(this->solveMutex);
+
+				// Don't publish anything older than what we already have
+				if (outgoingFrame->receivedTime < this->lastPublishedTime) {
+					return;
+				}
+
+				// Use the pose which the best-covered camera's MatchMarkers matched with as our initial guess
+				shared_ptr<MatchMarkersFrame> guessFrame;
+				for (const auto & frame : cameraSet) {
+					if (frame->result.count > 0
+						&& !frame->modelViewRotationVector.empty()
+						&& (!guessFrame || frame->result.count > guessFrame->result.count)) {
+						guessFrame = frame;
+					}
+				}
+				if (!guessFrame) {
+					this->notifyTrackingLost(cameraSet);
+					this->failuresSinceLastAppFrame++;
+					return;
+				}
+
+				cv::Vec3d rotationVector, translation;
+				{
+					// body = inverse(view) * modelView
+					cv::Mat viewRotationVector, viewTranslation, modelViewRotationVector, modelViewTranslation;
+					guessFrame->cameraDescription->inverseRotationVector.convertTo(viewRotationVector, CV_64F);
+					guessFrame->cameraDescription->inverseTranslation.convertTo(viewTranslation, CV_64F);
+					guessFrame->modelViewRotationVector.convertTo(modelViewRotationVector, CV_64F);
+					guessFrame->modelViewTranslation.convertTo(modelViewTranslation, CV_64F);
+
+					cv::Matx33d viewRotation, modelViewRotation;
+					cv::Rodrigues(viewRotationVector, viewRotation);
+					cv::Rodrigues(modelViewRotationVector, modelViewRotation);
+					cv::Rodrigues(viewRotation.t() * modelViewRotation, rotationVector);
+					translation = viewRotation.t() * (cv::Vec3d(modelViewTranslation.reshape(1, 3)) - cv::Vec3d(viewTranslation.reshape(1, 3)));
+				}
+
+				// Gather the observations from every camera
+				this->views.resize(cameraSet.size());
+				for (size_t i = 0; i < cameraSet.size(); i++) {
+					const auto & frame = cameraSet[i];
+					MultiViewSolvePnP::setView(this->views[i]
+						, frame->cameraDescription->cameraMatrix
+						, frame->cameraDescription->distortionCoefficients
+						, frame->cameraDescription->inverseRotationVector
+						, frame->cameraDescription->inverseTranslation
+						, frame->result.centroids
+						, frame->result.objectSpacePoints);
+				}
+
+				MultiViewSolvePnP::Settings settings;
+				settings.maxIterations = this->parameters.maxIterations;
+				settings.huberThreshold = this->parameters.huberThreshold;
+				outgoingFrame->solveResult = MultiViewSolvePnP::solve(this->views, rotationVector, translation, settings);
+
+				auto solveEndTime = Clock::now();
+				outgoingFrame->solveTime = chrono::duration<float, milli>(solveEndTime - startTime).count();
+				this->solveTime.store(outgoingFrame->solveTime);
+				this->latencies.solve.add(outgoingFrame->solveTime);
+				this->camerasInLastSet.store(cameraSet.size());
+				this->observationsInLastSet.store(outgoingFrame->solveResult.inlierCount);
+				this->reprojectionError.store(outgoingFrame->solveResult.reprojectionError);
+				this->setsSinceLastAppFrame++;
+
+				if (!outgoingFrame->solveResult.success
+					|| outgoingFrame->solveResult.inlierCount < (size_t) max(this->parameters.minimumObservations.get(), 3)
+					|| outgoingFrame->solveResult.reprojectionError > this->parameters.reprojectionThreshold.get()) {
+					this->notifyTrackingLost(cameraSet);
+					this->failuresSinceLastAppFrame++;
+					return;
+				}
+
+				outgoingFrame->incomingFrames = cameraSet;
+				outgoingFrame->modelRotationVector = cv::Mat(rotationVector, true);
+				outgoingFrame->modelTranslation = cv::Mat(translation, true);
+				outgoingFrame->transform = ofxCv::makeMatrix(outgoingFrame->modelRotationVector
+					, outgoingFrame->modelTranslation);
+
+				// Feed the result back to each camera's chain
+				for (const auto & frame : cameraSet) {
+					cv::Mat modelViewRotationVector, modelViewTranslation;
+					cv::composeRT(outgoingFrame->modelRotationVector
+						, outgoingFrame->modelTranslation
+						, frame->cameraDescription->inverseRotationVector
+						, frame->cameraDescription->inverseTranslation
+						, modelViewRotationVector
+						, modelViewTranslation);
+
+					if (frame->posePredictor) {
+						if (frame->result.forceTakeTransform || frame->result.trackingWasLost) {
+							//we've jumped, so don't take a velocity from this
+							frame->posePredictor->notifyTrackingLost();
+						}
+						frame->posePredictor->addMeasurement(modelViewRotationVector
+							, modelViewTranslation
+							, frame->incomingFrame->receivedTime
+							, frame->bodyDescription->posePredictorSettings);
+					}
+
+					auto trackingFeedback = frame->incomingFrame->trackingFeedback;
+					if (this->parameters.feedbackSearchRegions && trackingFeedback && !frame->search.objectSpacePoints.empty()) {
+						vector<cv::Point2f> predictedImagePoints;
+						cv::projectPoints(frame->search.objectSpacePoints
+							, modelViewRotationVector
+							, modelViewTranslation
+							, frame->cameraDescription->cameraMatrix
+							, frame->cameraDescription->distortionCoefficients
+							, predictedImagePoints);
+						trackingFeedback->setPrediction(predictedImagePoints);
+					}
+				}
+
+				auto publishTime = Clock::now();
+				outgoingFrame->latency = chrono::duration<float, milli>(publishTime - outgoingFrame->receivedTime).count();
+				this->latencies.total.add(outgoingFrame->latency);
+				this->lastPublishedTime = outgoingFrame->receivedTime;
+
+				// Publish whilst locked so that listeners see the time steps in order
+				this->onNewFrame.notifyListeners(outgoingFrame);
+				this->trackingUpdateToMainThread.set(outgoingFrame);
+			}
+
+			//----------
+			void UpdateTrackingFused::notifyTrackingLost(const CameraSet & cameraSet) {
+				for (const auto & frame : cameraSet) {
+					if (frame->posePredictor) {
+						frame->posePredictor->notifyTrackingLost();
+					}
+					if (this->parameters.feedbackSearchRegions && frame->incomingFrame->trackingFeedback) {
+						frame->incomingFrame->trackingFeedback->notifyTrackingLost();
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "ofxRulr/Nodes/Base.h"
+#include "ofxRulr/Utils/LatencyHistogram.h"
+#include "ofxRulr/Utils/LatestValue.h"
+
+#include "MatchMarkers.h"
+#include "MultiViewSolvePnP.h"
+
+namespace ofxRulr {
+	namespace Nodes {
+		namespace MoCap {
+			struct UpdateTrackingFusedFrame {
+				vector<shared_ptr<MatchMarkersFrame>> incomingFrames; // one per camera which contributed
+
+				cv::Mat modelRotationVector;
+				cv::Mat modelTranslation;
+				ofMatrix4x4 transform;
+
+				MultiViewSolvePnP::Result solveResult;
+
+				chrono::high_resolution_clock::time_point receivedTime; // earliest image in the set
+				float solveTime = 0.0f; // [ms]
+				float latency = 0.0f; // [ms] image received -> pose published
+			};
+
+			/// Tracks one body with several cameras : groups the MatchMarkers frames which arrive within a
+			/// time window and solves a single body pose from all their observations together.
+			class UpdateTrackingFused : public Nodes::Base {
+			public:
+				static const size_t MaxCameraCount = 6;
+
+				UpdateTrackingFused();
+				string getTypeName() const override;
+				void init();
+				void update();
+				void populateInspector(ofxCvGui::InspectArguments &);
+
+				//happens in 'our thread'
+				ofxLiquidEvent<shared_ptr<UpdateTrackingFusedFrame>> onNewFrame;
+			protected:
+				typedef chrono::high_resolution_clock Clock;
+				typedef vector<shared_ptr<MatchMarkersFrame>> CameraSet;
+
+				void receiveFrame(size_t cameraIndex, shared_ptr<MatchMarkersFrame>);
+				void processCameraSet(const CameraSet &);
+				void notifyTrackingLost(const CameraSet &);
+
+				struct : ofParameterGroup {
+					ofParameter<float> synchronisationWindow{ "Synchronisation window [ms]", 8, 0, 100 };
+					ofParameter<int> minimumObservations{ "Minimum observations", 4 };
+					ofParameter<int> maxIterations{ "Max iterations", 10 };
+					ofParameter<float> huberThreshold{ "Huber threshold [px]", 2 };
+					ofParameter<float> reprojectionThreshold{ "Reprojection threshold (RMS) [px]", 3 };
+					ofParameter<bool> feedbackSearchRegions{ "Feedback search regions", true };
+					PARAM_DECLARE("UpdateTrackingFused", synchronisationWindow, minimumObservations, maxIterations, huberThreshold, reprojectionThreshold, feedbackSearchRegions);
+				} parameters;
+
+				// Frames waiting for the rest of their time step
+				struct {
+					mutex lock;
+					CameraSet frames{ MaxCameraCount };
+					bool connected[MaxCameraCount] = { false };
+				} pending;
+
+				// Working data for the solve, and the time of the last published set (so we never go backwards)
+				mutex solveMutex;
+				vector<MultiViewSolvePnP::View> views;
+				Clock::time_point lastPublishedTime;
+
+				Utils::LatestValue<shared_ptr<UpdateTrackingFusedFrame>> trackingUpdateToMainThread; // set under solveMutex
+
+				struct {
+					Utils::LatencyHistogram solve;
+					Utils::LatencyHistogram total;
+				} latencies;
+
+				atomic<float> solveTime{ 0.0f };
+				atomic<float> reprojectionError{ 0.0f };
+				atomic<size_t> camerasInLastSet{ 0 };
+				atomic<size_t> observationsInLastSet{ 0 };
+				atomic<int> setsSinceLastAppFrame{ 0 };
+				atomic<int> incompleteSetsSinceLastAppFrame{ 0 };
+				atomic<int> failuresSinceLastAppFrame{ 0 };
+				float setsPerSecond = 0.0f;
+				float incompleteSetsPerSecond = 0.0f;
+				float failuresPerSecond = 0.0f;
+			};
+		}
+	}
+}
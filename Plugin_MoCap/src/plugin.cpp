@@ -11,10 +11,14 @@
 #include "ofxRulr/Nodes/MoCap/OSCRelay.h"
 #include "ofxRulr/Nodes/MoCap/StereoSolvePnP.h"
 #include "ofxRulr/Nodes/MoCap/UpdateTrackingStereo.h"
+#include "ofxRulr/Nodes/MoCap/UpdateTrackingFused.h"
 #include "ofxRulr/Nodes/MoCap/RecordMarkerImages.h"
 #include "ofxRulr/Nodes/MoCap/PreviewRecordMarkerImageFrame.h"
 #include "ofxRulr/Nodes/MoCap/MarkerTagger.h"
 #include "ofxRulr/Nodes/MoCap/AddMarkerFromStereo.h"
+#include "ofxRulr/Nodes/MoCap/RecordFrameStream.h"
+#include "ofxRulr/Nodes/MoCap/ReplayFrameStream.h"
+#include "ofxRulr/Nodes/MoCap/Benchmark.h"
 
 OFXPLUGIN_PLUGIN_MODULES_BEGIN(ofxRulr::Nodes::Base)
 	OFXPLUGIN_PLUGIN_REGISTER_MODULE(ofxRulr::Nodes::MoCap::FindMarkerCentroids);
@@ -26,8 +30,12 @@ OFXPLUGIN_PLUGIN_MODULES_BEGIN(ofxRulr::Nodes::Base)
 	OFXPLUGIN_PLUGIN_REGISTER_MODULE(ofxRulr::Nodes::MoCap::OSCRelay);
 	OFXPLUGIN_PLUGIN_REGISTER_MODULE(ofxRulr::Nodes::MoCap::StereoSolvePnP);
 	OFXPLUGIN_PLUGIN_REGISTER_MODULE(ofxRulr::Nodes::MoCap::UpdateTrackingStereo);
+	OFXPLUGIN_PLUGIN_REGISTER_MODULE(ofxRulr::Nodes::MoCap::UpdateTrackingFused);
 	OFXPLUGIN_PLUGIN_REGISTER_MODULE(ofxRulr::Nodes::MoCap::RecordMarkerImages);
 	OFXPLUGIN_PLUGIN_REGISTER_MODULE(ofxRulr::Nodes::MoCap::PreviewRecordMarkerImagesFrame);
 	OFXPLUGIN_PLUGIN_REGISTER_MODULE(ofxRulr::Nodes::MoCap::MarkerTagger);
 	OFXPLUGIN_PLUGIN_REGISTER_MODULE(ofxRulr::Nodes::MoCap::AddMarkerFromStereo);
+	OFXPLUGIN_PLUGIN_REGISTER_MODULE(ofxRulr::Nodes::MoCap::RecordFrameStream);
+	OFXPLUGIN_PLUGIN_REGISTER_MODULE(ofxRulr::Nodes::MoCap::ReplayFrameStream);
+	OFXPLUGIN_PLUGIN_REGISTER_MODULE(ofxRulr::Nodes::MoCap::Benchmark);
 OFXPLUGIN_PLUGIN_MODULES_END
\ No newline at end of file